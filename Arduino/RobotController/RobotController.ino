@@ -6,10 +6,18 @@
 #include "config.h"
 #include "piezo.h"
 #include "wheel.h"
+#include "driver.h"
+#include "motion.h"
+#include "odometry.h"
 #include "i2c_handler.h"
+#include "logger.h"
+#if IMU_ENABLED
+#include "minimu9.h"
+#endif
+#include "scheduler.h"
+#include "profiler.h"
 
 unsigned long debounceTime = 0UL;
-unsigned long nextSensorTime = 0UL;
 unsigned long stopTime = 0UL;
 unsigned long reportTime = 0UL;
 
@@ -17,25 +25,47 @@ boolean motorsOn = false;
 
 int speed = 10;
 
-char sbuf[100];
-
 Wheel* leftWheel;
 Wheel* rightWheel;
+Driver* driver;
+MotionQueue* motion;
+
+#if IMU_ENABLED
+MinIMU9 imu;                    // its sample ring alone is 392 bytes of RAM at IMU_RING_SIZE 16
+#endif
+
+Odometry odometry(TICKS_PER_METRE, WHEEL_BASE_MM);
+
+Scheduler<TASK_COUNT> scheduler;
+
+void startMotors(int s);
+void stopMotors();
+void controlTask();
+void sensorTask();
+void uiTask();
+void telemetryTask();
 
 
 void setup() {
   // set timer 1 (pins 9 & 10) divisor to 1 for PWM frequency of 31372.55 Hz
-  TCCR1B = TCCR1B & B11111000 | B00000001;
+  TCCR1B = (TCCR1B & B11111000) | B00000001;
 
   // don't mess with timer 0, it is used by delay(), millis(), etc.
   // don't mess with timer 2, it is used by tone()
 
   Serial.begin(9600);
 
-  leftWheel = new Wheel("Left", LEFT_PWM, LEFT_DIR1, LEFT_DIR2, 0, WHEEL_DEBUG);
-  rightWheel = new Wheel("Right", RIGHT_PWM, RIGHT_DIR1, RIGHT_DIR2, 0, WHEEL_DEBUG);
+  leftWheel = new Wheel("Left", LEFT_PWM, LEFT_DIR1, LEFT_DIR2, WHEEL_DEBUG);
+  rightWheel = new Wheel("Right", RIGHT_PWM, RIGHT_DIR1, RIGHT_DIR2, WHEEL_DEBUG);
+  driver = new Driver(leftWheel, rightWheel);
+  motion = new MotionQueue(driver, leftWheel, rightWheel);
 
-  I2C_Slave(leftWheel, rightWheel)
+  odometry.setSlipThreshold(ODOM_SLIP_DPS);
+  I2C_Slave.begin(leftWheel, rightWheel, driver, motion, &odometry);
+
+#if IMU_ENABLED
+  if (!imu.setup()) LOG_ERROR("Failed to setup IMU!");
+#endif
 
   pinMode(A_BTN, INPUT_PULLUP);
   pinMode(PLUS_BTN, INPUT_PULLUP);
@@ -44,27 +74,87 @@ void setup() {
   pinMode(LED, OUTPUT);
   digitalWrite(LED, LOW);
 
+  scheduler.add(controlTask, 1000000UL / CONTROL_HZ, F("control"));
+  scheduler.add(sensorTask, 1000000UL / SENSOR_HZ, F("sensors"));
+  scheduler.add(uiTask, 1000000UL / UI_HZ, F("ui"));
+  scheduler.add(telemetryTask, 1000000UL / TELEMETRY_HZ, F("telemetry"));
+  scheduler.start();
+
   playTaDa(PIEZO);
 }
 
 
+// One task per pass. In the time left over the I2C commands run, so a
+// master streaming at 400 kHz never waits on the control task's rate,
+// and the log drains.
 void loop() {
+  PROFILE_SCOPE(PROBE_LOOP);
+  if (!scheduler.run()) {
+    I2C_Slave.processCommands();
+    Log.drain();
+  }
+}
+
+
+void controlTask() {
+  PROFILE_SCOPE(PROBE_CONTROL);
+  Profile.record(PROBE_CONTROL_JITTER, scheduler.lateness());
+  I2C_Slave.processCommands();
+  motion->update();
+  driver->control();
+  I2C_Slave.publishWheels();
+  I2C_Slave.publishMotion();
+
+#if IMU_ENABLED
+  const ImuRing<IMU_RING_SIZE>& s = imu.samples();
+  if (ODOM_GYRO && imu.ok() && s.size()) {
+    odometry.update(leftWheel->encoder(), rightWheel->encoder(), s.last(IMU_GZ));
+  } else {
+    odometry.update(leftWheel->encoder(), rightWheel->encoder());
+  }
+#else
+  odometry.update(leftWheel->encoder(), rightWheel->encoder());
+#endif
+  I2C_Slave.publishOdometry();
+}
+
+
+void sensorTask() {
+  PROFILE_SCOPE(PROBE_SENSORS);
+#if IMU_ENABLED
+  if (imu.ok()) imu.sample();
+#endif
+}
+
+
+void uiTask() {
+  PROFILE_SCOPE(PROBE_UI);
   unsigned long m = millis();
 
-  if (m > debounceTime) {
+  updatePiezo();
+
+  // 'p' on the serial console reports the profiler, 'r' clears it
+  int c = Serial.read();
+  if (c == 'p') Profile.report();
+  else if (c == 'r') Profile.reset();
+
+  if (motorsOn && (long)(m - stopTime) >= 0) {
+    stopMotors();
+  }
+
+  if ((long)(m - debounceTime) > 0) {
     if (!digitalRead(A_BTN)) {
       debounceTime = m + DEBOUNCE_DELAY;
       if (motorsOn) {
-      	stopMotors();
+        stopMotors();
       } else {
         startMotors(speed);
-        stopTime = millis() + 5000UL;  // 5 seconds
+        stopTime = m + RUN_TIME;
       }
     } else if (!digitalRead(PLUS_BTN)) {
       debounceTime = m + DEBOUNCE_DELAY;
       if (speed < Wheel::MAX_FWD_SPEED) {
-        Serial.print("Speed increased to ");
-        Serial.println(++speed);
+        LOG_INFO("Speed increased to %d", ++speed);
         playPlus(PIEZO);
       } else {
         playBonk(PIEZO);
@@ -72,8 +162,7 @@ void loop() {
     } else if (!digitalRead(MINUS_BTN)) {
       debounceTime = m + DEBOUNCE_DELAY;
       if (speed > 1) {
-        Serial.print("Speed decreased to ");
-        Serial.println(--speed);
+        LOG_INFO("Speed decreased to %d", --speed);
         playMinus(PIEZO);
       } else {
         playBonk(PIEZO);
@@ -82,18 +171,47 @@ void loop() {
   }
 }
 
+
+void telemetryTask() {
+  PROFILE_SCOPE(PROBE_TELEMETRY);
+  unsigned long m = millis();
+
+  Profile.updateReport();
+
+  if (scheduler.task(0).overruns) I2C_Slave.setStatus(STATUS_OVERRUN);
+
+  if ((long)(m - reportTime) >= 0) {
+    reportTime = m + SENSOR_REPORT_FREQ;
+    if (motorsOn) {
+      LOG_DEBUG("Speed L %d/%d R %d/%d", leftWheel->encoder().velocity(), driver->leftTPS(),
+        rightWheel->encoder().velocity(), driver->rightTPS());
+    }
+#if IMU_ENABLED
+    const ImuRing<IMU_RING_SIZE>& s = imu.samples();
+    if (imu.ok() && s.size()) {
+      LOG_INFO("A: %d %d %d", s.last(IMU_AX), s.last(IMU_AY), s.last(IMU_AZ));
+      LOG_INFO("G: %d %d %d", s.last(IMU_GX), s.last(IMU_GY), s.last(IMU_GZ));
+      LOG_INFO("M: %d %d %d", s.last(IMU_MX), s.last(IMU_MY), s.last(IMU_MZ));
+      LOG_INFO("G mean %d %d %d", (int)s.mean(IMU_GX), (int)s.mean(IMU_GY), (int)s.mean(IMU_GZ));
+    }
+#endif
+  }
+}
+
+
+// s is in the wheels' speed steps, straight ahead
 void startMotors(int s) {
   playCharge(PIEZO);
-  Serial.println("Motors on");
-  leftWheel->setSpeed(s);
-  rightWheel->setSpeed(s);
+  LOG_INFO("Motors on");
+  motion->clear();
+  driver->move((long)s * Wheel::TPS_PER_SPEED * 1000 / TICKS_PER_METRE, 0);
   motorsOn = true;
 }
 
 void stopMotors() {
-  Serial.println("Motors off");
-  leftWheel->setSpeed(0);
-  rightWheel->setSpeed(0);
+  LOG_INFO("Motors off");
+  motion->clear();
+  driver->stop();
   motorsOn = false;
   playDaTa(PIEZO);
 }
@@ -0,0 +1,87 @@
+// command_queue.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#ifndef COMMAND_QUEUE_H_
+#define COMMAND_QUEUE_H_
+
+#include <Arduino.h>
+#include "sync.h"
+
+// Single-producer/single-consumer ring of length-framed commands. The Wire
+// receive ISR pushes, loop() pops, and neither side ever disables
+// interrupts: each index is a single byte written by only one side, so
+// loads and stores of it are atomic on the AVR.
+//
+// Each entry is stored as [length][command byte][argument bytes...].
+// SIZE must be a power of two no larger than 128 so the free-running 8-bit
+// indexes wrap cleanly.
+
+template <uint8_t SIZE>
+class CommandQueue {
+
+  public:
+
+    CommandQueue() : _head(0), _tail(0), _overflows(0) {}
+
+    // Producer side (ISR). Returns false and counts an overflow when the
+    // whole command does not fit; partial commands are never queued.
+    bool push(const byte* cmd, uint8_t len) {
+      uint8_t h = _head;
+      if ((uint8_t)(len + 1) > (uint8_t)(SIZE - (uint8_t)(h - _tail))) {
+        _overflows++;
+        return false;
+      }
+      _buf[h++ & MASK] = len;
+      for (uint8_t i = 0; i < len; i++) _buf[h++ & MASK] = cmd[i];
+      memoryBarrier();                          // entry bytes land before it is published
+      _head = h;
+      return true;
+    }
+
+    // Consumer side (loop). Copies the next command into cmd and returns
+    // its length, or 0 if the queue is empty. Commands longer than maxLen
+    // are truncated.
+    uint8_t pop(byte* cmd, uint8_t maxLen) {
+      uint8_t t = _tail;
+      if (t == _head) return 0;
+      memoryBarrier();                          // read the entry only after seeing it published
+      uint8_t len = _buf[t++ & MASK];
+      for (uint8_t i = 0; i < len; i++, t++) {
+        if (i < maxLen) cmd[i] = _buf[t & MASK];
+      }
+      memoryBarrier();                          // done reading before the space is handed back
+      _tail = t;
+      return len < maxLen ? len : maxLen;
+    }
+
+    uint8_t used() { return (uint8_t)(_head - _tail); }
+
+    boolean empty() { return _head == _tail; }
+
+    // Commands dropped because the queue was full. Read without blocking
+    // interrupts by retrying until two reads agree.
+    uint16_t overflows() {
+      uint16_t a, b;
+      do {
+        a = _overflows;
+        b = _overflows;
+      } while (a != b);
+      return a;
+    }
+
+  private:
+
+    static_assert(SIZE <= 128 && (SIZE & (SIZE - 1)) == 0, "CommandQueue SIZE must be a power of two <= 128");
+
+    static const uint8_t MASK = SIZE - 1;
+
+    byte _buf[SIZE];
+
+    volatile uint8_t _head;                     // next free byte, written only by the producer
+    volatile uint8_t _tail;                     // oldest queued byte, written only by the consumer
+    volatile uint16_t _overflows;               // written only by the producer
+};
+
+#endif // COMMAND_QUEUE_H_
@@ -17,9 +17,12 @@
 #define RIGHT_DIR2  17  // A3
 #define RIGHT_PWM   10  // OC1B
 #define RIGHT_ENC   3   // INT1
+// D2-D13 and A0-A3 are taken, A4/A5 are I2C and A6/A7 analog only, so
+// quadrature takes the C button's pin 7: unwire the button to fit them.
+#define LEFT_ENC_B  8   // second encoder channels, read when ENC_QUADRATURE
+#define RIGHT_ENC_B 7   // was C_BTN
 #define A_BTN       5
 #define B_BTN       6
-#define B_BTN       7
 #define PLUS_BTN    11
 #define MINUS_BTN   12
 #define PIEZO       4
@@ -27,7 +30,40 @@
 
 #define DEBOUNCE_DELAY      300UL  // milliseconds
 #define SENSOR_REPORT_FREQ 1000UL  // milliseconds
+#define RUN_TIME           5000UL  // milliseconds the motors run after the A button starts them
+
+// Task rates (scheduler.h), highest priority first
+#define CONTROL_HZ      100     // commands, wheel speed control
+#define SENSOR_HZ       50      // IMU
+#define UI_HZ           20      // buttons, piezo
+#define TELEMETRY_HZ    10      // status register, reports
+#define TASK_COUNT      4
+
+#define ENC_QUADRATURE  false   // two-channel encoders: direction from the encoder, not the drive
+#define IMU_ENABLED     false   // MinIMU-9 on the I2C bus, read with the Nano as bus master
+#define IMU_RING_SIZE   16      // IMU samples kept for filtering and statistics, power of two
+
+// Odometry (odometry.h); measure both for the robot at hand
+#define TICKS_PER_METRE 940     // encoder edges per metre of wheel travel
+#define WHEEL_BASE_MM   140     // between the wheels' contact points
+#define ODOM_GYRO       IMU_ENABLED     // fuse the MinIMU-9's yaw rate into the heading
+#define ODOM_SLIP_DPS   3       // gyro and wheel yaw rates further apart than this: the gyro's is used
+
+// Driver (driver.h); the motor figures are for the feed-forward
+#define DRIVE_ACCEL     1000    // mm/s/s
+#define DRIVE_YAW_ACCEL 8000    // mrad/s/s
+#define DRIVE_JERK      8000    // mm/s/s/s: 125 ms to full acceleration
+#define DRIVE_YAW_JERK  64000   // mrad/s/s/s
+#define DRIVE_START_PWM 40      // PWM at which a wheel starts to turn
+#define DRIVE_FULL_TPS  1200    // ticks per second at PWM 255
+#define DRIVE_MAX_TPS   1000    // most either wheel is asked for, short of the weaker motor's top speed
 
 #define WHEEL_DEBUG     true
 
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED false   // timing probes, see profiler.h; the host build turns them on
+#endif
+
+#define LOG_LEVEL       LOG_LEVEL_DEBUG   // see logger.h; anything above it is compiled out
+
 #endif // CONFIG_H_
@@ -0,0 +1,321 @@
+// driver.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#include "driver.h"
+#include "config.h"
+
+// Gains, Q8, tuned on the host simulation (DriverTest) at CONTROL_HZ = 100
+const int32_t KP = 96;                          // 3/8 PWM per edge/s of speed error
+const int32_t KL = 1024;                        // 4 PWM per edge a wheel lags its reference
+const int32_t KI = 32;                          // 1/8 PWM per edge of lag, added up each update
+const int16_t KC = 6144;                        // 24 PWM per edge of lag between the wheels; twice this oscillates
+
+// Neither wheel lags or leads its reference by more than this many edges:
+// past it both references are moved together, so the robot waits for a
+// wheel held back (stalled or saturated) instead of the wheel having to
+// catch up, and the difference between them -- the heading -- is kept
+const int32_t MAX_LAG = 16L << 8;
+
+// The difference alone is held to this, for a wheel that is stuck
+const int32_t MAX_SYNC = 3 * MAX_LAG;
+
+const int32_t PWM_MAX = 255L << 8;
+
+// A late control update is taken as no longer than this
+const uint32_t MAX_DT_US = 50000UL;
+
+// Commands are limited to these so the fixed point can't overflow
+const int16_t MAX_VELOCITY = 4000;              // mm/s
+const int16_t MAX_YAW_RATE = 20000;             // mrad/s
+
+
+// The control period's arithmetic is all 32 bits: avr-gcc's 64-bit
+// divide is a couple of thousand cycles and even a 32-bit one is several
+// hundred, so the period is taken as Q20 seconds once per update and the
+// rates are scaled by it with a multiply and a shift. Up to MAX_DT_US it
+// is under 2^16.
+
+// x * num / den, split at den so neither product passes 32 bits: the
+// quotient's is about the result, the remainder's under den * num, which
+// for the Q8 speeds here is well inside int32.
+static int32_t scale(int32_t x, uint16_t num, uint16_t den) {
+    return x / den * num + x % den * num / den;
+}
+
+
+// Q20 seconds from us: * 2^20 / 1e6, rounded
+static uint32_t seconds(uint32_t us) {
+    return ((us << 14) + 7812) / 15625;
+}
+
+
+// Q8: per second * dt
+static int32_t perPeriod(uint16_t perSecond, uint32_t dt) {
+    return (int32_t)((uint32_t)perSecond * dt >> 12);
+}
+
+
+// Q8: how far a Q8 rate per second goes in dt, rounded. The whole units
+// and the fraction are scaled separately so neither product passes 32
+// bits; the references add this up every period, and truncating it would
+// leave them behind.
+static int32_t travel(int32_t rate, uint32_t dt) {
+    uint32_t r = labs(rate);
+    int32_t d = (int32_t)(((r >> 8) * dt + ((r & 255) * dt >> 8) + 2048) >> 12);
+    return rate < 0 ? -d : d;
+}
+
+
+// Whether value, moving at rate (toward the target, Q8 per second) this
+// period and then easing it off a jerk step each update, stops within
+// left of where it is: rate^2 / 2 jerk, and half a period at the rate for
+// the steps. The rate is taken in whole units, rounded up, so its square
+// fits 32 bits; the distances are Q8.
+static boolean clears(int32_t rate, int32_t left, uint16_t jerk, uint32_t dt) {
+    uint32_t r = ((uint32_t)rate + 255) >> 8;
+    uint32_t rr = r * r;
+    uint32_t stop = rr / jerk;                  // twice the stopping distance, whole units
+    if (stop > (uint32_t)left >> 7) return false;
+    return stop * 128 + rr % jerk * 128 / jerk + (r * dt >> 13) <= (uint32_t)left;
+}
+
+
+Driver::Driver(Wheel* leftWheel, Wheel* rightWheel) :
+    _kc(KC),
+    _vTarget(0),
+    _wTarget(0),
+    _v(0),
+    _w(0),
+    _a(0),
+    _wa(0),
+    _lastUpdate(0),
+    _active(false)
+{
+    memset(&_left, 0, sizeof(_left));
+    memset(&_right, 0, sizeof(_right));
+    _left.wheel = leftWheel;
+    _right.wheel = rightWheel;
+    setGeometry(TICKS_PER_METRE, WHEEL_BASE_MM);
+    setLimits(DRIVE_ACCEL, DRIVE_YAW_ACCEL);
+    setJerk(DRIVE_JERK, DRIVE_YAW_JERK);
+    setMotor(DRIVE_START_PWM, DRIVE_FULL_TPS, DRIVE_MAX_TPS);
+}
+
+
+Driver::~Driver() {
+    release();
+}
+
+
+void Driver::setGeometry(uint16_t ticksPerMetre, uint16_t wheelBaseMm) {
+    _ticksPerMetre = ticksPerMetre;
+    _wheelBaseMm = wheelBaseMm;
+}
+
+
+void Driver::setLimits(uint16_t accel, uint16_t yawAccel) {
+    _accel = accel;
+    _yawAccel = yawAccel;
+}
+
+
+void Driver::setJerk(uint16_t jerk, uint16_t yawJerk) {
+    _jerk = jerk;
+    _yawJerk = yawJerk;
+}
+
+
+void Driver::setMotor(uint8_t startPWM, uint16_t fullTPS, uint16_t maxTPS) {
+    _startPWM = startPWM;
+    _fullTPS = fullTPS;
+    _maxTPS = maxTPS;
+}
+
+
+// Taking over starts the setpoint from rest, whatever the wheels were doing.
+void Driver::move(int16_t velocity, int16_t yawRate) {
+    _vTarget = constrain(velocity, -MAX_VELOCITY, MAX_VELOCITY);
+    _wTarget = constrain(yawRate, -MAX_YAW_RATE, MAX_YAW_RATE);
+    if (_active) return;
+
+    _v = 0;
+    _w = 0;
+    _a = 0;
+    _wa = 0;
+    _left.lag = 0;
+    _right.lag = 0;
+    _left.integral = 0;
+    _right.integral = 0;
+    _left.position = _left.wheel->encoder().position();
+    _right.position = _right.wheel->encoder().position();
+    _left.frac = 0;
+    _right.frac = 0;
+    _lastUpdate = micros();
+    _active = true;
+}
+
+
+void Driver::release() {
+    _active = false;
+    _vTarget = 0;
+    _wTarget = 0;
+    _v = 0;
+    _w = 0;
+    _a = 0;
+    _wa = 0;
+    _left.tps = 0;
+    _right.tps = 0;
+    _left.wheel->command(0);
+    _right.wheel->command(0);
+    _left.wheel->latch();
+    _right.wheel->latch();
+}
+
+
+// The wheels' control() first, for the encoders' update and the brake
+// state machine. Once the setpoint is back at rest the wheels are braked
+// and the references start again from where they stopped.
+void Driver::control() {
+    _left.wheel->control();
+    _right.wheel->control();
+    uint32_t now = micros();
+    uint32_t dt = now - _lastUpdate;
+    _lastUpdate = now;
+    if (!_active) return;
+    if (dt > MAX_DT_US) dt = MAX_DT_US;
+    dt = seconds(dt);
+
+    ramp(_v, _a, _vTarget, _accel, _jerk, dt);
+    ramp(_w, _wa, _wTarget, _yawAccel, _yawJerk, dt);
+
+    if (_v == 0 && _w == 0) {
+        track(_left, 0, now, dt);
+        track(_right, 0, now, dt);
+        _left.lag = 0;
+        _right.lag = 0;
+        _left.integral = 0;
+        _right.integral = 0;
+        _left.pwm = 0;
+        _right.pwm = 0;
+    } else {
+        int32_t d = (_w >> 2) * (int32_t)_wheelBaseMm / 500;   // Q8 mm/s each wheel adds to the turn
+        int32_t tl = scale(_v - d, _ticksPerMetre, 1000);
+        int32_t tr = scale(_v + d, _ticksPerMetre, 1000);
+        int32_t most = max(labs(tl), labs(tr));
+        if (most > (int32_t)_maxTPS << 8) {
+            uint16_t over = (most + 255) >> 8;  // rounded up, so neither passes maxTPS
+            tl = scale(tl, _maxTPS, over);
+            tr = scale(tr, _maxTPS, over);
+        }
+        track(_left, tl, now, dt);
+        track(_right, tr, now, dt);
+        hold();
+        int32_t sync = ((int32_t)_kc * (_left.lag - _right.lag)) >> 8;
+        _left.pwm = output(_left, sync);
+        _right.pwm = output(_right, -sync);
+    }
+
+    _left.wheel->command(_left.pwm);
+    _right.wheel->command(_right.pwm);
+    noInterrupts();
+    _left.wheel->latch();
+    _right.wheel->latch();
+    interrupts();
+}
+
+
+// value moves toward target at a rate of no more than limit (per second),
+// and the rate changes by no more than jerk. Each update the rate goes up
+// a step if value could still stop at target from there, holds if it
+// could at the rate it has, and otherwise eases off; a rate away from a
+// target that has moved turns round. value lands on target when it would
+// pass it, or when it is within the last step of a rate that has all but
+// eased off; what is left of the rate then eases off with value held there.
+void Driver::ramp(int32_t& value, int32_t& rate, int16_t target, uint16_t limit, uint16_t jerk, uint32_t dt) {
+    int32_t t = (int32_t)target << 8;
+    if (jerk == 0) {
+        int32_t step = perPeriod(limit, dt);
+        if (value < t) value = min(value + step, t);
+        else if (value > t) value = max(value - step, t);
+        rate = 0;
+        return;
+    }
+
+    int32_t e = t - value;
+    int32_t step = perPeriod(jerk, dt);
+    if (e == 0) {
+        rate = rate > 0 ? max(rate - step, 0L) : min(rate + step, 0L);
+        return;
+    }
+    int32_t r = e < 0 ? -rate : rate;           // toward the target
+    int32_t left = labs(e);
+    int32_t next = min(r + step, (int32_t)limit << 8);
+    if (r >= 0 && !clears(next, left, jerk, dt)) next = clears(r, left, jerk, dt) ? r : max(r - step, 0L);
+    rate = e < 0 ? -next : next;
+
+    value += travel(rate, dt);
+    left = t - value;
+    if ((e > 0 && left <= 0) || (e < 0 && left >= 0) ||
+        (labs(rate) <= step && labs(left) <= travel(step, dt) + 1)) {
+        value = t;
+    }
+}
+
+
+// The reference moves on by the setpoint over dt, the wheel by its edges
+// and the part of an edge it has turned since the last one, from its
+// speed. Without that part the lag would move in whole edges, and the
+// gains on it would put a step of several PWM in the output at each.
+void Driver::track(Side& s, int32_t tps, uint32_t now, uint32_t dt) {
+    Encoder& enc = s.wheel->encoder();
+    int32_t p = enc.position();
+    int32_t v = enc.velocity();
+    int32_t frac = 0;
+    uint32_t since = now - enc.lastEdge();
+    if (v && since < 1000000UL) {
+        // Q8 edges, under one: v * since is only worked out below the
+        // time a whole edge takes, so it stays inside 32 bits at any speed
+        uint32_t av = labs(v);
+        frac = since >= (255UL * 3906 + av - 1) / av ? 255 : (int32_t)(av * since / 3906);
+        if (v < 0) frac = -frac;
+    }
+    int32_t lag = s.lag + travel(tps, dt) - ((p - s.position) << 8) - (frac - s.frac);
+    s.position = p;
+    s.frac = frac;
+    s.tps = tps;
+    s.lag = constrain(lag, -MAX_SYNC, MAX_SYNC);
+}
+
+
+void Driver::hold() {
+    int32_t over = max(_left.lag, _right.lag) - MAX_LAG;
+    int32_t under = min(_left.lag, _right.lag) + MAX_LAG;
+    int32_t shift = over > 0 ? over : (under < 0 ? under : 0);
+    _left.lag -= shift;
+    _right.lag -= shift;
+}
+
+
+// Q8 throughout, rounded to the signed PWM at the end. The integral takes
+// up what the feed-forward gets wrong, so the lag settles at 0; it only
+// moves while the output is not saturated in the direction of the lag. A
+// wheel still turning the other way is braked (PWM 0 while driven) until
+// it is slow enough to reverse without the wheel's timed brake.
+int Driver::output(Side& s, int32_t sync) {
+    int32_t ff = 0;
+    if (s.tps) {
+        ff = ((int32_t)_startPWM << 8) + labs(s.tps) * (255 - _startPWM) / _fullTPS;
+        if (s.tps < 0) ff = -ff;
+    }
+    int32_t v = s.wheel->encoder().velocity();
+    int32_t integral = constrain(s.integral + ((KI * s.lag) >> 8), -PWM_MAX, PWM_MAX);
+    int32_t u = ff + KP * ((s.tps >> 8) - v) + ((KL * s.lag) >> 8) + sync;
+    if (!((u + integral > PWM_MAX && s.lag > 0) || (u + integral < -PWM_MAX && s.lag < 0))) {
+        s.integral = integral;
+    }
+    u += s.integral;
+    if ((u > 0 && v <= -(int32_t)Wheel::REVERSE_TPS) || (u < 0 && v >= (int32_t)Wheel::REVERSE_TPS)) return 0;
+    return (int)constrain((u + 128) >> 8, -255L, 255L);
+}
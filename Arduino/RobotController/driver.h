@@ -9,6 +9,29 @@
 #include <Arduino.h>
 #include "wheel.h"
 
+// Drives the two wheels together from a forward speed and a yaw rate.
+//
+// move() sets the target; each control period the setpoint moves toward
+// it within the acceleration limits, and the acceleration itself changes
+// by no more than the jerk limits, so a step in the command becomes an
+// S-shaped speed profile and a new command part way through a ramp blends
+// in without a jolt. With a jerk of 0 the profile is trapezoidal. The
+// setpoint is split into the wheels' speeds, and scaled back as a whole if
+// either would pass maxTPS, which keeps the curvature.
+//
+// Each wheel tracks the position its speed integrates to, not just the
+// speed: its PWM is a feed-forward for the target speed, a proportional
+// term on the speed error, and a term and an integral on the edges it lags
+// its reference by. Cross-coupling adds the difference between the two
+// wheels' lags to one and takes it from the other, with a gain well above
+// their own, so a wheel that falls behind slows its partner until they are
+// level again and the robot keeps its heading. A wheel that can't keep up
+// at all holds both references back together.
+//
+// Both PWMs are worked out before either is written, and then written
+// back to back with interrupts off, a few cycles apart. This is the
+// sketch's only speed loop; release() hands the wheels back to
+// setPower().
 class Driver {
 
     public:
@@ -17,7 +40,88 @@ class Driver {
 
         ~Driver();
 
+        void setGeometry(uint16_t ticksPerMetre, uint16_t wheelBaseMm);
 
-}
+        void setLimits(uint16_t accel, uint16_t yawAccel);     // mm/s/s and mrad/s/s
+
+        void setJerk(uint16_t jerk, uint16_t yawJerk);         // mm/s/s/s and mrad/s/s/s, 0 for none
+
+        // The PWM that just starts a wheel turning and the speed it reaches
+        // at 255, for the feed-forward; maxTPS is the most either wheel is
+        // asked for
+        void setMotor(uint8_t startPWM, uint16_t fullTPS, uint16_t maxTPS);
+
+        void setCoupling(int16_t kc) { _kc = kc; }             // Q8 PWM per edge of lag between the wheels, 0 for none
+        int16_t coupling() { return _kc; }
+
+        void move(int16_t velocity, int16_t yawRate);         // mm/s forward, mrad/s counter-clockwise
+        void stop() { move(0, 0); }                            // ramps down; the wheels brake once the setpoint is 0
+
+        void release();                                        // stops driving the wheels at once
+
+        boolean active() { return _active; }
+
+        void control();                                        // call this method CONTROL_HZ times a second, in place of the wheels' control()
+
+        int16_t velocity() { return (int16_t)(_v >> 8); }      // the ramped setpoint, mm/s
+        int16_t yawRate() { return (int16_t)(_w >> 8); }       // mrad/s
+        int16_t targetVelocity() { return _vTarget; }
+        int16_t targetYawRate() { return _wTarget; }
+        int16_t acceleration() { return (int16_t)(_a >> 8); }  // of the setpoint, mm/s/s
+        int16_t yawAcceleration() { return (int16_t)(_wa >> 8); }
+
+        uint16_t ticksPerMetre() { return _ticksPerMetre; }
+        uint16_t accel() { return _accel; }
+
+        int32_t leftTPS() { return _left.tps >> 8; }           // the wheels' signed setpoints, edges per second
+        int32_t rightTPS() { return _right.tps >> 8; }
+        int32_t leftLag() { return _left.lag; }                // Q8 edges behind the reference
+        int32_t rightLag() { return _right.lag; }
+
+    private:
+
+        struct Side {
+            Wheel* wheel;
+            int32_t tps;                        // Q8 edges per second, signed
+            int32_t lag;                        // Q8 edges the wheel is behind its reference
+            int32_t integral;                   // Q8 PWM
+            int32_t position;                   // encoder position at the last update
+            int32_t frac;                       // Q8 edges turned past it
+            int pwm;                            // signed output
+        };
+
+        // dt in Q20 seconds (see driver.cpp)
+        void ramp(int32_t& value, int32_t& rate, int16_t target, uint16_t limit, uint16_t jerk, uint32_t dt);
+
+        void track(Side& s, int32_t tps, uint32_t now, uint32_t dt);
+
+        void hold();
+
+        int output(Side& s, int32_t sync);          // sync is the coupling's Q8 PWM
+
+        Side _left;
+        Side _right;
+
+        uint16_t _ticksPerMetre;
+        uint16_t _wheelBaseMm;
+        uint16_t _accel;
+        uint16_t _yawAccel;
+        uint16_t _jerk;
+        uint16_t _yawJerk;
+        uint8_t _startPWM;
+        uint16_t _fullTPS;
+        uint16_t _maxTPS;
+        int16_t _kc;
+
+        int16_t _vTarget;
+        int16_t _wTarget;
+        int32_t _v;                             // Q8 mm/s
+        int32_t _w;                             // Q8 mrad/s
+        int32_t _a;                             // Q8 mm/s/s
+        int32_t _wa;                            // Q8 mrad/s/s
+
+        uint32_t _lastUpdate;                   // micros()
+        boolean _active;
+};
 
 #endif // DRIVER_H_
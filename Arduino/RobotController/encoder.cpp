@@ -0,0 +1,95 @@
+// encoder.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#include "encoder.h"
+
+Encoder::Encoder() :
+  _head(0),
+  _position(0),
+  _dir(1),
+  _quadrature(false),
+  _seen(0),
+  _seenPosition(0),
+  _replay(0),
+  _edges(0),
+  _position32(0),
+  _lastEdge(0),
+  _ctlEdge(0),
+  _tps(0),
+  _velocity(0)
+{
+  for (uint8_t i = 0; i < EDGE_RING; i++) _times[i] = 0;
+}
+
+
+void Encoder::begin(uint8_t pinA, uint8_t pinB, void (*isr)()) {
+  pinMode(pinA, INPUT);
+  _a.begin(pinA);
+  _quadrature = pinB != NO_PIN;
+  if (_quadrature) {
+    pinMode(pinB, INPUT);
+    _b.begin(pinB);
+  }
+  _ctlEdge = micros();
+  attachInterrupt(digitalPinToInterrupt(pinA), isr, CHANGE);
+}
+
+
+void Encoder::update() {
+  noInterrupts();
+  uint16_t head = _head;
+  int16_t position = _position;
+  uint32_t edge = _times[(uint16_t)(head - 1) & (EDGE_RING - 1)];
+  interrupts();
+
+  uint16_t n = head - _seen;
+  int16_t moved = position - _seenPosition;
+  _seen = head;
+  _seenPosition = position;
+  _edges += n;
+  _position32 += moved;
+
+  if (n > 0) {
+    // an edge from before a restart() has no measured span
+    long dt = (long)(edge - _ctlEdge);
+    _lastEdge = edge;
+    _ctlEdge = edge;
+    if (dt > 0) {
+      long half = dt / 2;
+      _tps = (uint16_t)min((1000000UL * n + half) / (unsigned long)dt, 65535UL);
+      _velocity = (int16_t)constrain((1000000L * moved + (moved < 0 ? -half : half)) / dt, -32767L, 32767L);
+    }
+  } else {
+    unsigned long since = micros() - _ctlEdge;
+    unsigned long bound = since > 0 ? 1000000UL / since : 65535UL;
+    if (_tps > bound) {
+      _tps = (uint16_t)bound;
+      _velocity = _velocity < 0 ? -(int16_t)_tps : (int16_t)_tps;
+    }
+  }
+}
+
+
+void Encoder::restart() {
+  update();
+  _ctlEdge = micros();
+}
+
+
+boolean Encoder::nextEdge(uint32_t& t) {
+  if (_replay == _seen) return false;
+  noInterrupts();
+  uint16_t head = _head;
+  if ((uint16_t)(head - _replay) > EDGE_RING) _replay = head - EDGE_RING;
+  boolean ok = (int16_t)(_seen - _replay) > 0;
+  if (ok) t = _times[_replay & (EDGE_RING - 1)];
+  interrupts();
+  if (!ok) {
+    _replay = _seen;
+    return false;
+  }
+  _replay++;
+  return true;
+}
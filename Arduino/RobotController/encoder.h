@@ -0,0 +1,116 @@
+// encoder.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#ifndef ENCODER_H_
+#define ENCODER_H_
+
+#include <Arduino.h>
+
+// One wheel encoder. Channel A is on an external interrupt pin and its
+// handler calls edge(), which only takes a micros() timestamp, counts the
+// edge and, with a second channel on pinB, reads the direction from it: at
+// an edge of A, A and B differ when the wheel turns forward. With a single
+// channel the direction is whatever the wheel last drove (setDirection()).
+// There is no divide and nothing else shared in the handler.
+//
+// The speed is estimated in the control task by update(), from the edges
+// since the last update: their count over the time from the last edge
+// before them to the last of them. At speed that is many edges over an
+// exactly measured span; at a crawl, one edge gives the exact period; with
+// no edge at all the speed can be at most one edge over the time since the
+// last one, which brings the estimate down to zero as the wheel stops.
+//
+// The handler keeps its counts in 16 bits, cheap on the AVR, and update()
+// widens them, so it must run before 32768 edges go by. The last EDGE_RING
+// timestamps are kept for nextEdge().
+class Encoder {
+
+  public:
+
+    static const uint8_t NO_PIN = 0xFF;
+    static const uint8_t EDGE_RING = 16;        // timestamps kept, power of two
+
+    Encoder();
+
+    // Inputs on pinA and, unless it is NO_PIN, pinB; isr is attached to
+    // pinA's interrupt on both edges and must call edge().
+    void begin(uint8_t pinA, uint8_t pinB, void (*isr)());
+
+    boolean quadrature() { return _quadrature; }
+
+    // From the pin interrupt
+    void edge() {
+      uint32_t t = micros();
+      int8_t d = _dir;
+      if (_quadrature) d = _a.read() != _b.read() ? 1 : -1;
+      uint16_t h = _head;
+      _times[h & (EDGE_RING - 1)] = t;
+      _head = h + 1;
+      _position += d;
+    }
+
+    // Single channel: the sign edges count with, from the drive direction
+    void setDirection(int8_t dir) { _dir = dir < 0 ? -1 : 1; }
+
+    void update();                              // call every control period
+
+    // Starts the next speed measurement now, so the first update after a
+    // change of speed doesn't average over the time the wheel was idle. The
+    // counts are kept.
+    void restart();
+
+    // The timestamps of the edges update() took, oldest first, one a call;
+    // false when there are none left. Any the handler has overwritten since
+    // are skipped.
+    boolean nextEdge(uint32_t& t);
+
+    uint16_t tps() { return _tps; }             // edges per second, at the last update
+    int16_t velocity() { return _velocity; }    // signed edges per second, at the last update
+    uint32_t edges() { return _edges; }         // edges since reset, either way, wraps
+    int32_t position() { return _position32; }  // forward edges less reverse edges since reset
+    uint32_t lastEdge() { return _lastEdge; }   // micros() of the last edge, at the last update
+
+  private:
+
+    // A digital input read straight from its port register
+    struct Input {
+#ifdef HOST_SIM
+      uint8_t pin;
+      void begin(uint8_t p) { pin = p; }
+      uint8_t read() { return digitalRead(pin); }
+#else
+      volatile uint8_t* reg;
+      uint8_t mask;
+      void begin(uint8_t p) {
+        reg = portInputRegister(digitalPinToPort(p));
+        mask = digitalPinToBitMask(p);
+      }
+      uint8_t read() { return (*reg & mask) != 0; }
+#endif
+    };
+
+    // Written by edge()
+    volatile uint32_t _times[EDGE_RING];
+    volatile uint16_t _head;                    // edges, wraps
+    volatile int16_t _position;                 // signed edges, wraps
+    volatile int8_t _dir;
+
+    Input _a;
+    Input _b;
+    boolean _quadrature;
+
+    // Control task
+    uint16_t _seen;                             // _head at the last update
+    int16_t _seenPosition;                      // _position at the last update
+    uint16_t _replay;                           // next edge for nextEdge()
+    uint32_t _edges;
+    int32_t _position32;
+    uint32_t _lastEdge;
+    uint32_t _ctlEdge;                          // the edge (or restart) the next measurement starts from
+    uint16_t _tps;
+    int16_t _velocity;
+};
+
+#endif // ENCODER_H_
@@ -8,64 +8,303 @@
 #include "i2c_handler.h"
 #include "config.h"
 #include "wheel.h"
+#include "piezo.h"
 
-#define MPS 1000000
-
-
-unsigned int calcTPS(lastTick, currentTick) {
-    if (lastTick > 0) {
-        if (currentTick > lastTick) {
-           return (MPS / (currentTick - lastTick);
-        } else {
-            return (MPS / (currentTick + (MPS - lastTick)));
-        }
-    }
-    return 0;
-}
+_I2C_Slave I2C_Slave;
 
 
+// The speeds are worked out in the control task (see encoder.h); the
+// handlers only record the edge.
 void leftWheelEncoderInterrupt() {
-    static unsigned long lastTick = 0;
-    unsigned long currentTick = micros();
-    I2C_Slave.leftWheelTPS(calcTPS(lastTick, currentTick));
-    lastTick = currentTick;
+    I2C_Slave.leftWheel()->encoder().edge();
 }
 
 
 void rightWheelEncoderInterrupt() {
-    static unsigned long lastTick = 0;
-    unsigned long currentTick = micros();
-    I2C_Slave.rightWheelTPS(calcTPS(lastTick, currentTick));
-    lastTick = currentTick;
+    I2C_Slave.rightWheel()->encoder().edge();
 }
 
 
 void i2cRequest() {
-    Wire.send(I2C_Slave.registerBuf(), REG_SIZE);
+    PROFILE_SCOPE(PROBE_I2C_REQUEST);
+    Wire.write(I2C_Slave.request(), REG_SIZE);
 }
 
 
 void i2cReceive(int bytesReceived) {
-    for (int a = 0; a < bytesReceived; a++) {
-        // TODO circular command queue?
+    PROFILE_SCOPE(PROBE_I2C_RECEIVE);
+    I2C_Slave.receive(bytesReceived);
+}
+
+
+byte commandSize(byte cmd) {
+    switch (cmd) {
+        case CMD_STOP_BOTH:
+        case CMD_STOP_LEFT:
+        case CMD_STOP_RIGHT:
+        case CMD_CLEAR_STATUS:
+        case CMD_PROFILE_RESET:
+        case CMD_ODOM_RESET:
+        case CMD_PLAY_CHARGE:
+        case CMD_PLAY_TADA:
+        case CMD_PLAY_DATA:
+        case CMD_PLAY_PLUS:
+        case CMD_PLAY_MINUS:
+        case CMD_PLAY_BONK:
+            return 1;
+        case CMD_FWD_BOTH:
+        case CMD_FWD_LEFT:
+        case CMD_FWD_RIGHT:
+        case CMD_REV_BOTH:
+        case CMD_REV_LEFT:
+        case CMD_REV_RIGHT:
+        case CMD_SELECT_PAGE:
+            return 2;
+        case CMD_DRIVE:
+        case CMD_SEG_DISTANCE:
+            return 5;
+        case CMD_SEG_TIMED:
+            return 7;
     }
+    return 0;
 }
 
 
-_I2C_Slave::_I2C_Slave() : _leftWheel(0), _rightWheel(0), _leftLastTick(0), _rightLastTick(0) {}
+_I2C_Slave::_I2C_Slave() :
+    _cur(0),
+    _writing(0),
+    _version(0),
+    _page(PAGE_REGISTERS),
+    _leftWheel(0),
+    _rightWheel(0),
+    _driver(0),
+    _motion(0),
+    _odometry(0),
+    _executed(0),
+    _errors(0)
+{
+    _regs.registers.version = REG_MAP_VERSION;
+    memset(&_pose, 0, sizeof(_pose));
+    memset(&_poseSent, 0, sizeof(_poseSent));
+    memset(&_motionPage, 0, sizeof(_motionPage));
+    memset(&_motionSent, 0, sizeof(_motionSent));
+}
 
 
-void _I2C_Slave::begin(Wheel* left, Wheel* right) {
+void _I2C_Slave::begin(Wheel* left, Wheel* right, Driver* driver, MotionQueue* motion, Odometry* odometry) {
   _leftWheel = left;
   _rightWheel = right;
+  _driver = driver;
+  _motion = motion;
+  _odometry = odometry;
 
-  pinMode(LEFT_ENC, INPUT);
-  pinMode(RIGHT_ENC, INPUT);
-
-  attachInterrupt(digitalPinToInterrupt(LEFT_ENC), leftWheelEncoderInterrupt, CHANGE);
-  attachInterrupt(digitalPinToInterrupt(RIGHT_ENC), rightWheelEncoderInterrupt, CHANGE);
+  left->encoder().begin(LEFT_ENC, ENC_QUADRATURE ? LEFT_ENC_B : Encoder::NO_PIN, leftWheelEncoderInterrupt);
+  right->encoder().begin(RIGHT_ENC, ENC_QUADRATURE ? RIGHT_ENC_B : Encoder::NO_PIN, rightWheelEncoderInterrupt);
 
   Wire.begin(I2C_ADDR); // as slave
   Wire.onRequest(i2cRequest);
   Wire.onReceive(i2cReceive);
 }
+
+
+// The wheel speeds and encoder counts as of the last control update.
+void _I2C_Slave::publishWheels() {
+    Encoder& l = _leftWheel->encoder();
+    Encoder& r = _rightWheel->encoder();
+    beginUpdate();
+    _regs.registers.left.tps = l.tps();
+    _regs.registers.leftTelemetry.ticks = l.edges();
+    _regs.registers.leftTelemetry.lastEdge = l.lastEdge();
+    _regs.registers.right.tps = r.tps();
+    _regs.registers.rightTelemetry.ticks = r.edges();
+    _regs.registers.rightTelemetry.lastEdge = r.lastEdge();
+    endUpdate();
+}
+
+
+void _I2C_Slave::publishOdometry() {
+    beginUpdate();
+    _odometry->page(&_pose);
+    endUpdate();
+}
+
+
+void _I2C_Slave::publishMotion() {
+    beginUpdate();
+    _motion->page(&_motionPage);
+    _regs.registers.motionDepth = _motionPage.depth;
+    endUpdate();
+}
+
+
+// A profile, odometry or motion page is built in the spare snapshot buffer:
+// publish() only runs from here, and it rebuilds that buffer in full when
+// the registers are selected again.
+byte* _I2C_Slave::request() {
+    byte page = _page;
+    if (page == PAGE_REGISTERS) return publish();
+    if (page == PAGE_ODOMETRY) return livePage(&_pose, &_poseSent, sizeof(_pose));
+    if (page == PAGE_MOTION) return livePage(&_motionPage, &_motionSent, sizeof(_motionPage));
+    byte* buf = _snap[_cur ^ 1].buffer;
+    memset(buf, 0, REG_SIZE);
+    Profile.page(page - PAGE_PROFILE, (struct ProfilePage*)buf);
+    return buf;
+}
+
+
+// Seqlock read of the live registers into the spare snapshot buffer. The
+// copy is only published if no update was open before or during it; when
+// the request interrupts loop() mid-update the retries cannot succeed, and
+// the previous snapshot (with its unchanged seq) is sent again instead.
+byte* _I2C_Slave::publish() {
+    byte next = _cur ^ 1;
+    if (copyUnchanged(_snap[next].buffer, _regs.buffer, REG_SIZE)) {
+        _snap[next].registers.seq = _snap[_cur].registers.seq + 1;
+        _snap[next].registers.micros = micros();
+        memoryBarrier();
+        _cur = next;
+    }
+    return _snap[_cur].buffer;
+}
+
+
+// The same seqlock read for the odometry and motion pages; when it cannot
+// get a whole copy the last page sent goes again, with its unchanged seq.
+byte* _I2C_Slave::livePage(const void* live, void* sent, uint8_t len) {
+    byte* buf = _snap[_cur ^ 1].buffer;
+    memset(buf, 0, REG_SIZE);
+    if (copyUnchanged(buf, (const byte*)live, len)) {
+        memcpy(sent, buf, len);
+    } else {
+        memcpy(buf, sent, len);
+    }
+    return buf;
+}
+
+
+// Copies src unless an update was open before or during the copy, trying
+// up to three times.
+boolean _I2C_Slave::copyUnchanged(byte* dst, const byte* src, uint8_t len) {
+    for (int tries = 0; tries < 3; tries++) {
+        byte v = _version;
+        if (_writing) continue;
+        memoryBarrier();
+        memcpy(dst, src, len);
+        memoryBarrier();
+        if (_writing == 0 && _version == v) return true;
+    }
+    return false;
+}
+
+
+// A master write may carry several commands back to back. Each complete
+// command is queued on its own; an unknown command byte or a command cut
+// short by the end of the transaction discards the rest of it.
+void _I2C_Slave::receive(int bytesReceived) {
+    byte buf[CMD_MAX_SIZE];
+    int n = 0;
+    while (n < bytesReceived && n < CMD_MAX_SIZE) buf[n++] = Wire.read();
+    while (Wire.available()) Wire.read();
+
+    int i = 0;
+    while (i < n) {
+        byte size = commandSize(buf[i]);
+        if (size == 0 || i + size > n) {
+            _errors++;
+            setStatus(STATUS_CMD_ERROR);
+            return;
+        }
+        if (!_cmdq.push(&buf[i], size)) setStatus(STATUS_CMD_OVERFLOW);
+        i += size;
+    }
+}
+
+
+// Runs at most CMD_PER_PASS commands so a master streaming faster than
+// they execute cannot starve the rest of loop().
+void _I2C_Slave::processCommands() {
+    byte cmd[CMD_MAX_SIZE];
+    uint8_t len;
+    for (int n = 0; n < CMD_PER_PASS && (len = _cmdq.pop(cmd, sizeof(cmd))) > 0; n++) {
+        execute(cmd, len);
+        _executed++;
+    }
+}
+
+
+void _I2C_Slave::execute(const byte* cmd, uint8_t len) {
+    byte pwm = len > 1 ? cmd[1] : 0;
+    switch (cmd[0]) {
+        case CMD_STOP_BOTH:   driveLeft(DIR_STOP, 0); driveRight(DIR_STOP, 0); break;
+        case CMD_STOP_LEFT:   driveLeft(DIR_STOP, 0); break;
+        case CMD_STOP_RIGHT:  driveRight(DIR_STOP, 0); break;
+        case CMD_FWD_BOTH:    driveLeft(DIR_FORWARD, pwm); driveRight(DIR_FORWARD, pwm); break;
+        case CMD_FWD_LEFT:    driveLeft(DIR_FORWARD, pwm); break;
+        case CMD_FWD_RIGHT:   driveRight(DIR_FORWARD, pwm); break;
+        case CMD_REV_BOTH:    driveLeft(DIR_REVERSE, pwm); driveRight(DIR_REVERSE, pwm); break;
+        case CMD_REV_LEFT:    driveLeft(DIR_REVERSE, pwm); break;
+        case CMD_REV_RIGHT:   driveRight(DIR_REVERSE, pwm); break;
+        case CMD_CLEAR_STATUS: clearStatus(); break;
+        case CMD_SELECT_PAGE: selectPage(cmd[1]); break;
+        case CMD_PROFILE_RESET: Profile.reset(); break;
+        case CMD_ODOM_RESET:  _odometry->reset(); break;
+        case CMD_DRIVE:       _motion->clear(); _driver->move((int16_t)(cmd[1] | cmd[2] << 8), (int16_t)(cmd[3] | cmd[4] << 8)); break;
+        case CMD_SEG_TIMED:
+        case CMD_SEG_DISTANCE: queueSegment(cmd); break;
+        case CMD_PLAY_CHARGE: playCharge(PIEZO); break;
+        case CMD_PLAY_TADA:   playTaDa(PIEZO); break;
+        case CMD_PLAY_DATA:   playDaTa(PIEZO); break;
+        case CMD_PLAY_PLUS:   playPlus(PIEZO); break;
+        case CMD_PLAY_MINUS:  playMinus(PIEZO); break;
+        case CMD_PLAY_BONK:   playBonk(PIEZO); break;
+    }
+}
+
+
+// A command for one wheel takes both back from the driver, stopped, and
+// drops the motion queue.
+void _I2C_Slave::driveLeft(byte dir, byte pwm) {
+    _motion->clear();
+    if (_driver->active()) _driver->release();
+    if (dir == DIR_STOP) pwm = 0;
+    _leftWheel->setPower(dir == DIR_REVERSE ? -pwm : pwm);
+    leftWheelDir(dir);
+    leftWheelPWM(pwm);
+}
+
+
+void _I2C_Slave::driveRight(byte dir, byte pwm) {
+    _motion->clear();
+    if (_driver->active()) _driver->release();
+    if (dir == DIR_STOP) pwm = 0;
+    _rightWheel->setPower(dir == DIR_REVERSE ? -pwm : pwm);
+    rightWheelDir(dir);
+    rightWheelPWM(pwm);
+}
+
+
+// A segment of no length, or a distance at no speed, is an error; one
+// that finds the queue full is an overflow, as a command would be.
+void _I2C_Slave::queueSegment(const byte* cmd) {
+    uint16_t length = cmd[1] | cmd[2] << 8;
+    int16_t velocity = (int16_t)(cmd[3] | cmd[4] << 8);
+    if (length == 0 || (cmd[0] == CMD_SEG_DISTANCE && velocity == 0)) {
+        setStatus(STATUS_CMD_ERROR);
+        return;
+    }
+    boolean queued;
+    if (cmd[0] == CMD_SEG_TIMED) queued = _motion->timed(length, velocity, (int16_t)(cmd[5] | cmd[6] << 8));
+    else queued = _motion->distance(length, velocity);
+    if (!queued) setStatus(STATUS_CMD_OVERFLOW);
+}
+
+
+// An unknown page is an error and leaves the selection as it was.
+void _I2C_Slave::selectPage(byte page) {
+    if (page == PAGE_REGISTERS || page == PAGE_ODOMETRY || page == PAGE_MOTION ||
+        (page >= PAGE_PROFILE && page < PAGE_PROFILE + PROBE_COUNT)) {
+        _page = page;
+    } else {
+        setStatus(STATUS_CMD_ERROR);
+    }
+}
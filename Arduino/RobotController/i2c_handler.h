@@ -8,6 +8,12 @@
 
 #include <Arduino.h>
 #include "wheel.h"
+#include "driver.h"
+#include "motion.h"
+#include "odometry.h"
+#include "command_queue.h"
+#include "sync.h"
+#include "profiler.h"
 
 
 // Direction Constants
@@ -26,6 +32,13 @@
 #define CMD_REV_BOTH    0x07    // next byte is PWM
 #define CMD_REV_LEFT    0x08    // next byte is PWM
 #define CMD_REV_RIGHT   0x09    // next byte is PWM
+#define CMD_CLEAR_STATUS 0x0A   // clear the sticky status bits
+#define CMD_SELECT_PAGE 0x0B    // next byte is the PAGE_* that later reads return
+#define CMD_PROFILE_RESET 0x0C  // clear the profiler stats
+#define CMD_ODOM_RESET  0x0D    // put the odometry pose back at the origin
+#define CMD_DRIVE       0x0E    // next 4 bytes are int16 mm/s and mrad/s, little endian (see driver.h)
+#define CMD_SEG_TIMED   0x0F    // next 6 bytes are uint16 ms, int16 mm/s and mrad/s (see motion.h)
+#define CMD_SEG_DISTANCE 0x10   // next 4 bytes are uint16 mm, int16 mm/s
 #define CMD_PLAY_CHARGE 0xF0
 #define CMD_PLAY_TADA   0xF1
 #define CMD_PLAY_DATA   0xF2
@@ -33,28 +46,75 @@
 #define CMD_PLAY_MINUS  0xF4
 #define CMD_PLAY_BONK   0xF5
 
-#define CMD_BUF_SIZE    2
+#define CMD_QUEUE_SIZE  128     // bytes of queued commands, power of two
+#define CMD_MAX_SIZE    32      // largest command, one Wire transaction
+#define CMD_PER_PASS    8       // commands run per call to processCommands()
+
+
+// Register map version, bumped whenever fields are added past the 8-byte
+// legacy block at offset 0, or pages are added or change layout.
+#define REG_MAP_VERSION 4
+
+// Pages a read can return. The register map is the default; the odometry
+// page (struct OdometryPage in odometry.h) is the pose as of the last
+// control update, 16 bytes, the motion page (struct MotionPage in
+// motion.h) the segment queue's, and a profile page (struct ProfilePage
+// in profiler.h) holds the stats of one probe.
+#define PAGE_REGISTERS  0x00
+#define PAGE_ODOMETRY   0x01
+#define PAGE_MOTION     0x02
+#define PAGE_PROFILE    0x10    // + ProbeId
+
+// Status bits, sticky until CMD_CLEAR_STATUS
+#define STATUS_CMD_OVERFLOW 0x01    // a command, or a segment, was dropped because its queue was full
+#define STATUS_CMD_ERROR    0x02    // an unknown, truncated or invalid command was dropped
+#define STATUS_OVERRUN      0x04    // the control task missed a release
+
+
+// Total length of a command including the command byte, 0 if unknown.
+byte commandSize(byte cmd);
 
 struct WheelRegisters {
     byte dir;
     byte pwm;
-    unsigned int tps;
-}
+    uint16_t tps;               // measured by the last control update
+};
+
 
+// As of the last control update
+struct WheelTelemetry {
+    uint32_t ticks;             // encoder edges since reset, wraps at 2^32
+    uint32_t lastEdge;          // micros() of the most recent edge
+};
 
+
+// Offsets 0-7 are the original layout; a master reading only those bytes
+// sees no change. Multi-byte fields are little endian, as on the AVR.
 struct Registers {
-    struct WheelRegisters left;
-    struct WheelRegisters right;
+    struct WheelRegisters left;             //  0
+    struct WheelRegisters right;            //  4
+    byte seq;                               //  8 snapshot number, bumped each time a new coherent snapshot is published
+    byte version;                           //  9 REG_MAP_VERSION
+    byte status;                            // 10 STATUS_* bits
+    byte motionDepth;                       // 11 segments left in the motion queue, the running one included
+    uint32_t micros;                        // 12 micros() when the snapshot was taken
+    struct WheelTelemetry leftTelemetry;    // 16
+    struct WheelTelemetry rightTelemetry;   // 24
 };
 
 
 const int REG_SIZE = sizeof(struct Registers);
 
+static_assert(REG_SIZE <= 32, "register map must fit one Wire transaction");
+static_assert(sizeof(struct ProfilePage) <= REG_SIZE, "a profile page is read in place of the registers");
+static_assert(sizeof(struct OdometryPage) <= REG_SIZE, "the odometry page is read in place of the registers");
+static_assert(sizeof(struct MotionPage) <= REG_SIZE, "the motion page is read in place of the registers");
+
 
 union RegBuf {
     struct Registers registers;
     byte buffer[REG_SIZE];
-}
+};
 
 
 class _I2C_Slave {
@@ -65,73 +125,176 @@ class _I2C_Slave {
 
         ~_I2C_Slave() {}
 
-        void begin(Wheel* left, Wheel* right);
+        void begin(Wheel* left, Wheel* right, Driver* driver, MotionQueue* motion, Odometry* odometry);
+
+        void receive(int bytesReceived);        // Wire receive ISR: frame the transaction into queued commands
+
+        void processCommands();                 // call from loop() to run the queued commands
+
+        Wheel* leftWheel() { return _leftWheel; }
+
+        Wheel* rightWheel() { return _rightWheel; }
+
+        uint16_t commandOverflows() { return _cmdq.overflows(); }
+
+        unsigned long commandsExecuted() { return _executed; }
+
+        uint16_t commandErrors() { return _errors; }
 
         byte leftWheelDir() {
-            return _regbuf.registers.left.dir;
+            return _regs.registers.left.dir;
         }
 
         void leftWheelDir(byte dir) {
-            _regbuf.registers.left.dir = dir;
+            beginUpdate();
+            _regs.registers.left.dir = dir;
+            endUpdate();
         }
 
         byte leftWheelPWM() {
-            return _regbuf.registers.left.pwm;
+            return _regs.registers.left.pwm;
         }
 
         void leftWheelPWM(byte pwm) {
-            _regbuf.registers.left.pwm = pwm;
+            beginUpdate();
+            _regs.registers.left.pwm = pwm;
+            endUpdate();
         }
 
-        unsigned int leftWheelTPS() {
-            return _regbuf.registers.left.tps;
+        uint16_t leftWheelTPS() {
+            return _regs.registers.left.tps;
         }
 
-        void leftWheelTPS(unsigned int tps) {
-            _regbuf.registers.left.tps = tps;
+        void leftWheelTPS(uint16_t tps) {
+            beginUpdate();
+            _regs.registers.left.tps = tps;
+            endUpdate();
         }
 
         byte rightWheelDir() {
-            return _regbuf.registers.right.dir;
+            return _regs.registers.right.dir;
         }
 
         void rightWheelDir(byte dir) {
-            _regbuf.registers.right.dir = dir;
+            beginUpdate();
+            _regs.registers.right.dir = dir;
+            endUpdate();
         }
 
         byte rightWheelPWM() {
-            return _regbuf.registers.right.pwm;
+            return _regs.registers.right.pwm;
         }
 
         void rightWheelPWM(byte pwm) {
-            _regbuf.registers.left.pwm = pwm;
+            beginUpdate();
+            _regs.registers.right.pwm = pwm;
+            endUpdate();
+        }
+
+        uint16_t rightWheelTPS() {
+            return _regs.registers.right.tps;
+        }
+
+        void rightWheelTPS(uint16_t tps) {
+            beginUpdate();
+            _regs.registers.right.tps = tps;
+            endUpdate();
+        }
+
+        void publishWheels();                   // call from the control task after the wheels' control()
+
+        void publishOdometry();                 // call from the control task after the odometry update()
+
+        void publishMotion();                   // call from the control task after the motion queue's update()
+
+        byte status() {
+            return _regs.registers.status;
         }
 
-        unsigned int rightWheelTPS() {
-            return _regbuf.registers.right.tps;
+        // Set from the receive handler as well as loop(), so the
+        // read-modify-write runs with interrupts off: a bit the handler
+        // sets between loop()'s load and store would otherwise be lost.
+        void setStatus(byte bits) {
+            uint8_t sreg = SREG;
+            cli();
+            beginUpdate();
+            _regs.registers.status |= bits;
+            endUpdate();
+            SREG = sreg;
         }
 
-        void rightWheelTPS(unsigned int tps) {
-            _regbuf.registers.right.tps = tps;
+        void clearStatus() {
+            uint8_t sreg = SREG;
+            cli();
+            beginUpdate();
+            _regs.registers.status = 0;
+            endUpdate();
+            SREG = sreg;
         }
 
-        byte* registerBuf() {
-            return _regbuf.buffer;
+        // Writers (ISRs, loop()) bracket changes that belong together
+        // with beginUpdate()/endUpdate(); the brackets nest, so an ISR may
+        // update while loop() is part way through its own update.
+        void beginUpdate() {
+            _writing++;
+            memoryBarrier();
+        }
+
+        void endUpdate() {
+            memoryBarrier();
+            _version++;
+            _writing--;
+        }
+
+        byte* request();                        // Wire request ISR: the REG_SIZE bytes of the selected page
+
+        byte* publish();                        // take a coherent snapshot of the registers for the master
+
+        byte* registerBuf() {                   // the last published snapshot
+            return _snap[_cur].buffer;
         }
 
     private:
 
-        struct RegBuf _regbuf;
+        void execute(const byte* cmd, uint8_t len);
+
+        void driveLeft(byte dir, byte pwm);
+
+        void driveRight(byte dir, byte pwm);
+
+        void queueSegment(const byte* cmd);
+
+        void selectPage(byte page);
+
+        boolean copyUnchanged(byte* dst, const byte* src, uint8_t len);
+
+        byte* livePage(const void* live, void* sent, uint8_t len);
+
+        union RegBuf _regs;                     // live registers, written by the setters
+        struct OdometryPage _pose;              // live odometry page, written by publishOdometry()
+        struct OdometryPage _poseSent;          // the last odometry page request() sent
+        struct MotionPage _motionPage;          // live motion page, written by publishMotion()
+        struct MotionPage _motionSent;          // the last motion page request() sent
+        union RegBuf _snap[2];                  // published snapshot and the one being assembled
+        volatile uint8_t _cur;                  // index of the published snapshot
+
+        volatile uint8_t _writing;              // open beginUpdate() brackets
+        volatile uint8_t _version;              // bumped by every endUpdate()
+
+        volatile byte _page;                    // PAGE_* returned by request()
 
         Wheel* _leftWheel;
         Wheel* _rightWheel;
+        Driver* _driver;
+        MotionQueue* _motion;
+        Odometry* _odometry;
 
-        unsigned long _leftLastTick;
-        unsigned long _rightLastTick;
+        CommandQueue<CMD_QUEUE_SIZE> _cmdq;
 
-        byte _cmdbuf[CMD_BUF_SIZE];
-}
+        unsigned long _executed;                // commands run by processCommands()
+        volatile uint16_t _errors;              // unknown or truncated commands dropped by receive()
+};
 
-_I2C_Slave I2C_Slave;
+extern _I2C_Slave I2C_Slave;
 
 #endif // I2C_HANDLER_H_
@@ -0,0 +1,164 @@
+// imu_ring.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#ifndef IMU_RING_H_
+#define IMU_RING_H_
+
+#include <Arduino.h>
+
+// Channels of an ImuRing sample, in the order of Readings a, g, m
+#define IMU_AX  0
+#define IMU_AY  1
+#define IMU_AZ  2
+#define IMU_GX  3
+#define IMU_GY  4
+#define IMU_GZ  5
+#define IMU_MX  6
+#define IMU_MY  7
+#define IMU_MZ  8
+#define IMU_CHANNELS 9
+
+
+// A run of consecutive ring slots, oldest sample first: channel(c)[start]
+// through channel(c)[start + count - 1], and the same slots of times().
+struct ImuSpan {
+  uint16_t start;
+  uint16_t count;
+};
+
+
+// The last N IMU samples, stored as struct-of-arrays: one contiguous
+// int16_t array per channel and one of timestamps, so filtering,
+// calibration and telemetry can walk a channel in a tight loop with no
+// per-sample objects. Consumers read the arrays in place through the
+// spans since() and latest() return; a window wraps the end of the arrays
+// at most once, so it is at most two spans.
+//
+// push() overwrites the oldest sample once the ring is full. The sum of
+// each channel over the samples held is kept up to date as samples come
+// and go, so mean() of the window costs the same whatever N is; variance()
+// walks the window instead, as a running sum of squares would need 64 bits
+// a channel (N full-scale squares overflow 32). Both are exact integer
+// sums; only the final division is floating point.
+//
+// Filled and read from loop(), not from interrupt handlers.
+template <uint16_t N>
+class ImuRing {
+
+  public:
+
+    ImuRing() { clear(); }
+
+    void clear() {
+      _head = 0;
+      _count = 0;
+      for (uint8_t c = 0; c < IMU_CHANNELS; c++) {
+        _sum[c] = 0;
+      }
+    }
+
+    // Adds a sample, values in IMU_* channel order, and t its time in us
+    // (the low 32 bits, so differences wrap like micros()).
+    void push(const int16_t v[IMU_CHANNELS], uint32_t t) {
+      uint16_t i = _head & MASK;
+      boolean full = _count == N;
+      for (uint8_t c = 0; c < IMU_CHANNELS; c++) {
+        int16_t x = v[c];
+        if (full) _sum[c] -= _ch[c][i];
+        _ch[c][i] = x;
+        _sum[c] += x;
+      }
+      _t[i] = t;
+      _head++;
+      if (!full) _count++;
+    }
+
+    uint16_t size() const { return _count; }
+
+    static uint16_t capacity() { return N; }
+
+    // Samples pushed since clear(), modulo 65536: a consumer's cursor
+    uint16_t sequence() const { return _head; }
+
+    const int16_t* channel(uint8_t c) const { return _ch[c]; }
+
+    const uint32_t* times() const { return _t; }
+
+    // Value of channel c in the newest sample; the ring must not be empty
+    int16_t last(uint8_t c) const { return _ch[c][(_head - 1) & MASK]; }
+
+    uint32_t lastTime() const { return _t[(_head - 1) & MASK]; }
+
+    // The newest n samples (at most size()), oldest first, as one or two
+    // spans. Returns how many spans were filled.
+    uint8_t latest(uint16_t n, ImuSpan spans[2]) const {
+      if (n > _count) n = _count;
+      return span((uint16_t)(_head - n), n, spans);
+    }
+
+    // The samples pushed since cursor, oldest first, as one or two spans,
+    // and moves cursor up to date. Samples already overwritten are skipped
+    // and their number returned in lost, if it is given.
+    uint8_t since(uint16_t& cursor, ImuSpan spans[2], uint16_t* lost = 0) const {
+      uint16_t n = _head - cursor;
+      uint16_t skipped = 0;
+      if (n > _count) {
+        skipped = n - _count;
+        n = _count;
+      }
+      if (lost) *lost = skipped;
+      cursor = _head;
+      return span((uint16_t)(_head - n), n, spans);
+    }
+
+    // Statistics of channel c over the samples held
+    int32_t sum(uint8_t c) const { return _sum[c]; }
+
+    float mean(uint8_t c) const {
+      return _count ? (float)_sum[c] / _count : 0.0f;
+    }
+
+    // Population variance; n * sumSq - sum^2 is formed in 64 bits before
+    // dividing, so it loses nothing to cancellation. Until the ring first
+    // fills, the samples held are slots 0 to size() - 1.
+    float variance(uint8_t c) const {
+      if (!_count) return 0.0f;
+      const int16_t* v = _ch[c];
+      uint64_t sumSq = 0;
+      for (uint16_t i = 0; i < _count; i++) sumSq += (uint32_t)((int32_t)v[i] * v[i]);
+      int64_t n = _count;
+      int64_t d = n * (int64_t)sumSq - (int64_t)_sum[c] * _sum[c];
+      return (float)d / (float)(n * n);
+    }
+
+  private:
+
+    static_assert(N > 0 && N <= 32768 && (N & (N - 1)) == 0, "ImuRing N must be a power of two <= 32768");
+
+    static const uint16_t MASK = N - 1;
+
+    uint8_t span(uint16_t first, uint16_t n, ImuSpan spans[2]) const {
+      if (!n) return 0;
+      uint16_t start = first & MASK;
+      uint16_t run = N - start;
+      spans[0].start = start;
+      if (n <= run) {
+        spans[0].count = n;
+        return 1;
+      }
+      spans[0].count = run;
+      spans[1].start = 0;
+      spans[1].count = n - run;
+      return 2;
+    }
+
+    int16_t _ch[IMU_CHANNELS][N];
+    uint32_t _t[N];
+    uint16_t _head;                             // free-running; slot _head & MASK is written next
+    uint16_t _count;
+    int32_t _sum[IMU_CHANNELS];
+};
+
+#endif // IMU_RING_H_
@@ -0,0 +1,159 @@
+// logger.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#include <Arduino.h>
+#include "logger.h"
+
+static const uint8_t MASK = LOG_BUFFER_SIZE - 1;
+
+static_assert((LOG_BUFFER_SIZE & MASK) == 0 && LOG_BUFFER_SIZE <= 128,
+    "LOG_BUFFER_SIZE must be a power of two no larger than 128");
+
+
+Logger Log;
+
+
+Logger::Logger() :
+    _head(0),
+    _tail(0),
+    _linePos(0),
+    _lineLen(0),
+    _dropped(0),
+    _reported(0)
+{
+}
+
+
+// Record layout: [argc][format pointer][argc longs]
+void Logger::put(const __FlashStringHelper* fmt, uint8_t argc, const long* args) {
+    uint8_t size = 1 + sizeof(fmt) + argc * sizeof(long);
+    if (size > (uint8_t)(LOG_BUFFER_SIZE - (uint8_t)(_head - _tail))) {
+        _dropped++;
+        return;
+    }
+    uint8_t h = _head;
+    _buf[h++ & MASK] = argc;
+    const byte* p = (const byte*)&fmt;
+    for (uint8_t i = 0; i < sizeof(fmt); i++) _buf[h++ & MASK] = p[i];
+    p = (const byte*)args;
+    for (uint8_t i = 0; i < argc * sizeof(long); i++) _buf[h++ & MASK] = p[i];
+    _head = h;
+}
+
+
+namespace {
+
+// Appends to a line buffer, silently stopping at its end.
+struct LineWriter {
+    char* buf;
+    uint8_t len;
+    uint8_t cap;
+
+    void put(char c) {
+        if (len < cap) buf[len++] = c;
+    }
+
+    void puts(const char* s) {
+        while (s && *s) put(*s++);
+    }
+
+    void putsP(const char* s) {
+        char c;
+        while (s && (c = pgm_read_byte(s++)) != '\0') put(c);
+    }
+
+    void number(unsigned long n, uint8_t base) {
+        char digits[8 * sizeof(long)];
+        uint8_t i = 0;
+        do {
+            uint8_t d = n % base;
+            digits[i++] = d < 10 ? '0' + d : 'a' + d - 10;
+            n /= base;
+        } while (n);
+        while (i) put(digits[--i]);
+    }
+};
+
+
+// fmt is in flash
+uint8_t build(char* line, const char* fmt, uint8_t argc, const long* args) {
+    LineWriter w = { line, 0, LOG_LINE_SIZE - 2 };
+    uint8_t arg = 0;
+    char c;
+    while ((c = pgm_read_byte(fmt++)) != '\0') {
+        if (c != '%') {
+            w.put(c);
+            continue;
+        }
+        c = pgm_read_byte(fmt++);
+        if (c == '\0') break;
+        if (c == '%') {
+            w.put('%');
+            continue;
+        }
+        long v = arg < argc ? args[arg++] : 0;
+        switch (c) {
+            case 'd':
+                if (v < 0) {
+                    w.put('-');
+                    w.number(-(unsigned long)v, 10);
+                } else {
+                    w.number(v, 10);
+                }
+                break;
+            case 'u': w.number((unsigned long)v, 10); break;
+            case 'x': w.number((unsigned long)v, 16); break;
+            case 'c': w.put((char)v); break;
+            case 's': w.puts((const char*)v); break;
+            case 'S': w.putsP((const char*)v); break;
+            default:  w.put('%'); w.put(c); break;
+        }
+    }
+    line[w.len++] = '\r';
+    line[w.len++] = '\n';
+    return w.len;
+}
+
+} // namespace
+
+
+void Logger::format() {
+    uint8_t t = _tail;
+    uint8_t argc = _buf[t++ & MASK];
+    const __FlashStringHelper* fmt;
+    byte* p = (byte*)&fmt;
+    for (uint8_t i = 0; i < sizeof(fmt); i++) p[i] = _buf[t++ & MASK];
+    long args[LOG_MAX_ARGS];
+    p = (byte*)args;
+    for (uint8_t i = 0; i < argc * sizeof(long); i++) p[i] = _buf[t++ & MASK];
+    _tail = t;
+
+    _lineLen = build(_line, reinterpret_cast<const char*>(fmt), argc, args);
+    _linePos = 0;
+}
+
+
+void Logger::drain() {
+    int room = Serial.availableForWrite();
+    while (room > 0) {
+        if (_linePos == _lineLen) {
+            if (_head != _tail) {
+                format();
+            } else if (_dropped != _reported) {
+                long n = (uint16_t)(_dropped - _reported);
+                _reported = _dropped;
+                _lineLen = build(_line, PSTR("[%u log records dropped]"), 1, &n);
+                _linePos = 0;
+            } else {
+                return;
+            }
+        }
+        uint8_t n = _lineLen - _linePos;
+        if (n > room) n = room;
+        Serial.write((const uint8_t*)&_line[_linePos], n);
+        _linePos += n;
+        room -= n;
+    }
+}
@@ -0,0 +1,90 @@
+// logger.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include <Arduino.h>
+#include "config.h"
+
+// Log levels. LOG_LEVEL (config.h) is fixed at compile time; a statement
+// above it compiles to nothing, format string included.
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_BUFFER_SIZE 128     // bytes of queued records, power of two no larger than 128
+#define LOG_LINE_SIZE   80      // longest formatted line, longer ones are cut short
+#define LOG_MAX_ARGS    6
+
+constexpr bool logEnabled(uint8_t level) {
+    return level != LOG_LEVEL_NONE && level <= LOG_LEVEL;
+}
+
+// LOG_INFO("Speed increased to %d", speed);
+//
+// The format string stays in flash and only the pointer to it and the
+// arguments are queued; the text is built when Log.drain() sends it.
+// Formats take %d, %u, %x (long), %c, %s (a string in RAM), %S (a string
+// in flash, such as F("...")) and %%.
+#define LOG_AT(level, fmt, ...) \
+    do { if (logEnabled(level)) Log.record(F(fmt), ##__VA_ARGS__); } while (0)
+
+#define LOG_ERROR(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...)  LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...)  LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOG_DEBUG(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+
+// Queue of log records, written from loop() and drained to Serial only as
+// fast as its transmit buffer empties, so logging never waits on the
+// port. A record that does not fit is dropped and counted, and the count
+// is reported in the output once the queue has drained.
+class Logger {
+
+    public:
+
+        Logger();
+
+        template <typename... Args>
+        void record(const __FlashStringHelper* fmt, Args... args) {
+            static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+            long a[sizeof...(Args) + 1] = { (long)args... };
+            put(fmt, sizeof...(Args), a);
+        }
+
+        void drain();                           // call from loop(): sends what fits in the Serial transmit buffer
+
+        uint16_t dropped() { return _dropped; } // records dropped because the queue was full
+
+        boolean idle() { return _head == _tail && _linePos == _lineLen; }
+
+    private:
+
+        void put(const __FlashStringHelper* fmt, uint8_t argc, const long* args);
+
+        void format();                          // pops the oldest record into _line
+
+        byte _buf[LOG_BUFFER_SIZE];
+        uint8_t _head;                          // free-running, masked on use
+        uint8_t _tail;
+
+        char _line[LOG_LINE_SIZE];
+        uint8_t _linePos;                       // next character of _line to send
+        uint8_t _lineLen;
+
+        uint16_t _dropped;
+        uint16_t _reported;                     // _dropped when the last drop notice was sent
+};
+
+extern Logger Log;
+
+#endif // LOGGER_H_
@@ -10,6 +10,9 @@
 #include <Wire.h>
 #include <LSM6.h>
 #include <LIS3MDL.h>
+#include "sync.h"
+#include "imu_ring.h"
+#include "orientation.h"
 
 
 struct Xyz {
@@ -25,26 +28,108 @@ struct Readings {
   Xyz a;
   Xyz g;
   Xyz m;
+  uint64_t t;                                   // LSM6 hardware time of a and g in us, 0 if unknown
 
-  Readings(Xyz _a, Xyz _g, Xyz _m) : a(_a), g(_g), m(_m) { }
-  Readings(int ax, int ay, int az, int gx, int gy, int gz, int mx, int my, int mz) : 
-    a(Xyz(ax, ay, az)), g(Xyz(gx, gy, gz)), m(Xyz(mx, my, mz)) { }
+  Readings(Xyz _a, Xyz _g, Xyz _m, uint64_t _t = 0) : a(_a), g(_g), m(_m), t(_t) { }
+  Readings(int ax, int ay, int az, int gx, int gy, int gz, int mx, int my, int mz, uint64_t _t = 0) : 
+    a(Xyz(ax, ay, az)), g(Xyz(gx, gy, gz)), m(Xyz(mx, my, mz)), t(_t) { }
 };
 
-const int DEFAULT_SENSOR_SIGNS[] = {1, 1, 1, 1, 1, 1, 1, 1, 1};
 
+// Sources of the data-ready events MinIMU9::service() returns
+#define IMU_EVENT_NONE  0
+#define IMU_EVENT_IMU   1       // new LSM6 sample, read into Readings a, g and t
+#define IMU_EVENT_MAG   2       // new LIS3MDL sample, read into Readings m
+#define IMU_EVENT_FIFO  3       // LSM6 FIFO at its watermark or overrun, drain it with readStream()
 
-class MinIMU9 {
+#define IMU_EVENT_QUEUE_SIZE 8  // power of two
+
+#ifndef IMU_RING_SIZE
+#define IMU_RING_SIZE 16        // samples MinIMU9 keeps, power of two
+#endif
+
+
+struct ImuEvent {
+  uint8_t source;               // IMU_EVENT_*
+  uint32_t micros;              // micros() at the data-ready edge
+};
+
+
+// Single-producer/single-consumer ring of data-ready events. The pin
+// interrupts push and loop() pops. Both pin handlers are producers, but AVR
+// handlers do not nest, so only one of them runs at a time. As in
+// CommandQueue each index is a single byte written by only one side.
+template <uint8_t SIZE>
+class ImuEventQueue {
 
   public:
 
-    MinIMU9(const int sensorSigns[]) : _ok(false), _ss(sensorSigns) { }
-    MinIMU9() : MinIMU9(DEFAULT_SENSOR_SIGNS) { }
+    ImuEventQueue() : _head(0), _tail(0), _overflows(0) {}
+
+    // Producer side (ISR)
+    void push(uint8_t source, uint32_t t) {
+      uint8_t h = _head;
+      if ((uint8_t)(h - _tail) >= SIZE) {
+        _overflows++;
+        return;
+      }
+      _buf[h & MASK].source = source;
+      _buf[h & MASK].micros = t;
+      memoryBarrier();
+      _head = h + 1;
+    }
+
+    // Consumer side (loop). Returns false if the queue is empty.
+    boolean pop(ImuEvent& e) {
+      uint8_t t = _tail;
+      if (t == _head) return false;
+      memoryBarrier();
+      e = _buf[t & MASK];
+      memoryBarrier();
+      _tail = t + 1;
+      return true;
+    }
+
+    boolean empty() { return _head == _tail; }
+
+    uint16_t overflows() {
+      uint16_t a, b;
+      do {
+        a = _overflows;
+        b = _overflows;
+      } while (a != b);
+      return a;
+    }
+
+  private:
+
+    static_assert(SIZE <= 128 && (SIZE & (SIZE - 1)) == 0, "ImuEventQueue SIZE must be a power of two <= 128");
+
+    static const uint8_t MASK = SIZE - 1;
+
+    ImuEvent _buf[SIZE];
+
+    volatile uint8_t _head;
+    volatile uint8_t _tail;
+    volatile uint16_t _overflows;
+};
+
+
+// The MinIMU-9's LSM6 (gyro and accelerometer) and LIS3MDL (magnetometer)
+// read in robot axes: ImuMount and MagMount give how each chip is mounted
+// (see orientation.h), and are applied at compile time to every read.
+template <class ImuMount = IdentityOrientation, class MagMount = ImuMount>
+class OrientedMinIMU9 {
+
+  public:
+
+    OrientedMinIMU9() : _ok(false), _streaming(false), _imuPin(0), _magPin(0), _attached(false) { }
 
     boolean setup() {
       _ok = _imu.init() && _mag.init();
       if (_ok) {
         _imu.enableDefault();
+        _imu.enableTimestamp();
         _mag.enableDefault();
       }
       return _ok;
@@ -52,26 +137,172 @@ class MinIMU9 {
 
     Xyz readAccelerometer() {
       _imu.read();
-      return Xyz(_imu.a.x * _ss[0], _imu.a.y * _ss[1], _imu.a.z * _ss[2]);
+      return oriented<ImuMount>(_imu.a.x, _imu.a.y, _imu.a.z);
     }
 
     Xyz readGyroscope() {
       _imu.read();
-      return Xyz(_imu.g.x * _ss[3], _imu.g.y * _ss[4], _imu.g.z * _ss[5]);
+      return oriented<ImuMount>(_imu.g.x, _imu.g.y, _imu.g.z);
     }
 
     Xyz readMagnetometer() {
       _mag.read();
-      return Xyz(_mag.m.x * _ss[6], _mag.m.y * _ss[7], _mag.m.z * _ss[8]);
+      return oriented<MagMount>(_mag.m.x, _mag.m.y, _mag.m.z);
     }
 
     Readings readAll() {
+      sample();
+      return Readings(
+        _samples.last(IMU_AX), _samples.last(IMU_AY), _samples.last(IMU_AZ),
+        _samples.last(IMU_GX), _samples.last(IMU_GY), _samples.last(IMU_GZ),
+        _samples.last(IMU_MX), _samples.last(IMU_MY), _samples.last(IMU_MZ),
+        _imu.timestamp);
+    }
+
+    // Reads both sensors into samples(), in robot axes, without building a
+    // Readings.
+    void sample() {
       _imu.read();
       _mag.read();
-      return Readings(
-        _imu.a.x * _ss[0], _imu.a.y * _ss[1], _imu.a.z * _ss[1],
-        _imu.g.x * _ss[3], _imu.g.y * _ss[4], _imu.g.z * _ss[5],
-        _mag.m.x * _ss[6], _mag.m.y * _ss[7], _mag.m.z * _ss[8]);
+      pushSample(_imu.timestamp);
+    }
+
+    // The latest samples from every acquisition path -- sample(),
+    // readAll(), service() and readStream() -- each with the newest
+    // magnetometer reading.
+    const ImuRing<IMU_RING_SIZE>& samples() const {
+      return _samples;
+    }
+
+    // Streams every gyro/accelerometer sample through the LSM6 FIFO (see
+    // LSM6::enableFifo()) instead of polling the latest one.
+    void enableStreaming(uint16_t watermark, uint8_t decimation = 1) {
+      _imu.enableFifo(watermark, decimation);
+      _streaming = true;
+      if (_attached) _imu.enableFifoInterrupt();
+    }
+
+    // Drains the samples queued since the last call into buf, in robot
+    // axes, copies them to samples() and returns how many there were. The
+    // axes are permuted by handing the LSM6 buf's arrays in sensor order,
+    // so only reversed axes cost a pass.
+    uint16_t readStream(LSM6::fifoBuffer* buf) {
+      int16_t* a[3] = { buf->ax, buf->ay, buf->az };
+      int16_t* g[3] = { buf->gx, buf->gy, buf->gz };
+      LSM6::fifoBuffer raw = {
+        g[ImuMount::target(0)], g[ImuMount::target(1)], g[ImuMount::target(2)],
+        a[ImuMount::target(0)], a[ImuMount::target(1)], a[ImuMount::target(2)],
+        buf->capacity, buf->t
+      };
+      uint16_t n = _imu.readFifo(&raw);
+      for (uint8_t r = 0; r < 3; r++) {
+        if (ImuMount::reversed(r)) {
+          for (uint16_t i = 0; i < n; i++) {
+            a[r][i] = -a[r][i];
+            g[r][i] = -g[r][i];
+          }
+        }
+      }
+      int16_t v[IMU_CHANNELS];
+      magValues(v);
+      for (uint16_t i = 0; i < n; i++) {
+        v[IMU_AX] = buf->ax[i];
+        v[IMU_AY] = buf->ay[i];
+        v[IMU_AZ] = buf->az[i];
+        v[IMU_GX] = buf->gx[i];
+        v[IMU_GY] = buf->gy[i];
+        v[IMU_GZ] = buf->gz[i];
+        _samples.push(v, buf->t ? (uint32_t)buf->t[i] : 0);
+      }
+      // INT1 only rises on crossing the watermark: if this drain left it
+      // there, no new edge comes, so queue the event the edge would have
+      if (_attached && digitalRead(_imuPin)) {
+        noInterrupts();
+        _events.push(IMU_EVENT_FIFO, micros());
+        interrupts();
+      }
+      return n;
+    }
+
+    boolean streamOverrun() {
+      return _imu.fifo_overrun;
+    }
+
+    // Interrupt-driven acquisition: the LSM6 INT1 pin (data ready, or the
+    // FIFO watermark once streaming) and the LIS3MDL DRDY pin each raise an
+    // MCU interrupt on their rising edge, and the handler only queues the
+    // event with its micros() time. Nothing polls and nothing is read until
+    // a sensor has a new sample, so the sample rate follows the sensors'
+    // ODR instead of the speed of loop(). DRDY needs no setup on the
+    // LIS3MDL; its INT pin (INT_CFG) is the threshold interrupt and is not
+    // used.
+    //
+    // The stock Wire library blocks and needs interrupts enabled, so the
+    // reads themselves are made by service() from loop(). Returns false if
+    // the IMU is not set up or a pin has no external interrupt.
+    boolean attachInterrupts(uint8_t imuPin, uint8_t magPin) {
+      int imuIrq = digitalPinToInterrupt(imuPin);
+      int magIrq = digitalPinToInterrupt(magPin);
+      if (!_ok || imuIrq == NOT_AN_INTERRUPT || magIrq == NOT_AN_INTERRUPT) return false;
+      instance() = this;
+      _imuPin = imuPin;
+      _magPin = magPin;
+      pinMode(imuPin, INPUT);
+      pinMode(magPin, INPUT);
+      if (_streaming) _imu.enableFifoInterrupt();
+      else _imu.enableDataReadyInterrupt();
+      attachInterrupt(imuIrq, imuReady, RISING);
+      attachInterrupt(magIrq, magReady, RISING);
+      _attached = true;
+      // both lines are latched: one already high gives no edge until read
+      if (_streaming && digitalRead(imuPin)) {
+        noInterrupts();
+        _events.push(IMU_EVENT_FIFO, micros());
+        interrupts();
+      } else if (!_streaming) {
+        _imu.read();
+      }
+      _mag.read();
+      return true;
+    }
+
+    void detachInterrupts() {
+      if (!_attached) return;
+      detachInterrupt(digitalPinToInterrupt(_imuPin));
+      detachInterrupt(digitalPinToInterrupt(_magPin));
+      _imu.disableInterrupts();
+      _attached = false;
+    }
+
+    // Takes the next queued data-ready event and reads the sensor that
+    // raised it into r, in robot axes; only that sensor's fields change.
+    // Each LSM6 sample is also pushed to samples().
+    // An IMU_EVENT_FIFO event is returned without reading, for the caller
+    // to drain with readStream(). Returns an IMU_EVENT_NONE event when
+    // nothing is waiting.
+    ImuEvent service(Readings& r) {
+      ImuEvent e;
+      if (!_events.pop(e)) {
+        e.source = IMU_EVENT_NONE;
+        e.micros = 0;
+        return e;
+      }
+      if (e.source == IMU_EVENT_IMU) {
+        _imu.read();
+        pushSample(_imu.timestamp);
+        r.a = Xyz(_samples.last(IMU_AX), _samples.last(IMU_AY), _samples.last(IMU_AZ));
+        r.g = Xyz(_samples.last(IMU_GX), _samples.last(IMU_GY), _samples.last(IMU_GZ));
+        r.t = _imu.timestamp;
+      } else if (e.source == IMU_EVENT_MAG) {
+        _mag.read();
+        r.m = readMagnetometerLast();
+      }
+      return e;
+    }
+
+    // Events dropped because loop() fell IMU_EVENT_QUEUE_SIZE behind
+    uint16_t eventOverflows() {
+      return _events.overflows();
     }
 
     boolean ok() {
@@ -80,11 +311,60 @@ class MinIMU9 {
 
 private:
 
+    // The pin handlers have no object of their own; there is one IMU.
+    static OrientedMinIMU9*& instance() {
+      static OrientedMinIMU9* imu = 0;
+      return imu;
+    }
+
+    static void imuReady() {
+      OrientedMinIMU9* imu = instance();
+      imu->_events.push(imu->_streaming ? IMU_EVENT_FIFO : IMU_EVENT_IMU, micros());
+    }
+
+    static void magReady() {
+      instance()->_events.push(IMU_EVENT_MAG, micros());
+    }
+
+    template <class Mount>
+    static Xyz oriented(int16_t x, int16_t y, int16_t z) {
+      Mount::apply(x, y, z);
+      return Xyz(x, y, z);
+    }
+
+    Xyz readMagnetometerLast() {
+      return oriented<MagMount>(_mag.m.x, _mag.m.y, _mag.m.z);
+    }
+
+    void magValues(int16_t v[IMU_CHANNELS]) {
+      v[IMU_MX] = _mag.m.x;
+      v[IMU_MY] = _mag.m.y;
+      v[IMU_MZ] = _mag.m.z;
+      MagMount::apply(v[IMU_MX], v[IMU_MY], v[IMU_MZ]);
+    }
+
+    // Pushes the last LSM6 read with the last LIS3MDL read
+    void pushSample(uint64_t t) {
+      int16_t v[IMU_CHANNELS] = { _imu.a.x, _imu.a.y, _imu.a.z, _imu.g.x, _imu.g.y, _imu.g.z };
+      ImuMount::apply(v[IMU_AX], v[IMU_AY], v[IMU_AZ]);
+      ImuMount::apply(v[IMU_GX], v[IMU_GY], v[IMU_GZ]);
+      magValues(v);
+      _samples.push(v, (uint32_t)t);
+    }
+
     boolean _ok;
     LSM6 _imu;
     LIS3MDL _mag;
-    const int* _ss;
+
+    boolean _streaming;
+    uint8_t _imuPin;
+    uint8_t _magPin;
+    boolean _attached;
+    ImuEventQueue<IMU_EVENT_QUEUE_SIZE> _events;
+    ImuRing<IMU_RING_SIZE> _samples;
 };
 
+typedef OrientedMinIMU9<> MinIMU9;
+
 #endif
 
@@ -0,0 +1,172 @@
+// motion.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#include "motion.h"
+
+// Segment types
+const uint8_t TIMED = 0;
+const uint8_t DISTANCE = 1;
+
+// A distance segment slows to no less than this on its approach, so it
+// does reach its end
+const int32_t MIN_APPROACH = 50;                // mm/s
+
+const uint8_t MASK = MOTION_QUEUE_SIZE - 1;
+
+
+static uint16_t isqrt(uint32_t n) {
+    uint32_t r = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > n) bit >>= 2;
+    while (bit) {
+        if (n >= r + bit) {
+            n -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t)r;
+}
+
+
+MotionQueue::MotionQueue(Driver* driver, Wheel* leftWheel, Wheel* rightWheel) :
+    _driver(driver),
+    _leftWheel(leftWheel),
+    _rightWheel(rightWheel),
+    _head(0),
+    _count(0),
+    _segment(0),
+    _queued(0),
+    _running(false),
+    _started(0),
+    _leftStart(0),
+    _rightStart(0),
+    _mmPerEdge(0),
+    _progress(0),
+    _seq(0)
+{
+}
+
+
+boolean MotionQueue::timed(uint16_t ms, int16_t velocity, int16_t yawRate) {
+    return push(TIMED, ms, velocity, yawRate);
+}
+
+
+boolean MotionQueue::distance(uint16_t mm, int16_t speed) {
+    return push(DISTANCE, mm, speed, 0);
+}
+
+
+boolean MotionQueue::push(uint8_t type, uint16_t length, int16_t velocity, int16_t yawRate) {
+    if (_count == MOTION_QUEUE_SIZE) return false;
+    Segment& s = _segs[(_head + _count) & MASK];
+    s.type = type;
+    s.length = length;
+    s.velocity = velocity;
+    s.yawRate = yawRate;
+    _count++;
+    _queued++;
+    return true;
+}
+
+
+void MotionQueue::clear() {
+    _count = 0;
+    _running = false;
+    _segment = 0;
+    _queued = 0;
+    _progress = 0;
+}
+
+
+// A segment that is done hands over to the next in the same update; a
+// timed one ends at its start plus its length, however late the update
+// that sees it, and the next starts from there.
+void MotionQueue::update() {
+    if (!_running && !_count) return;
+    uint32_t now = micros();
+    if (!_running) start(now);
+
+    const Segment& s = _segs[_head];
+    boolean done;
+    if (s.type == TIMED) {
+        uint32_t ms = (now - _started) / 1000;
+        done = ms >= s.length;
+        _progress = done ? s.length : ms;
+    } else {
+        int32_t moved = (_leftWheel->encoder().position() - _leftStart) +
+                        (_rightWheel->encoder().position() - _rightStart);
+        uint32_t mm = (uint32_t)(labs(moved) / 2) * _mmPerEdge >> 14;
+        done = mm >= s.length;
+        _progress = done ? s.length : mm;
+        if (!done) _driver->move(approach(s, s.length - mm), 0);
+    }
+
+    if (done) {
+        uint32_t end = s.type == TIMED ? _started + (uint32_t)s.length * 1000 : now;
+        _head = (_head + 1) & MASK;
+        _count--;
+        _segment++;
+        if (_count) {
+            start(end);
+        } else {
+            _running = false;
+            _driver->stop();
+        }
+    }
+    _seq++;
+}
+
+
+void MotionQueue::start(uint32_t now) {
+    const Segment& s = _segs[_head];
+    _started = now;
+    _leftStart = _leftWheel->encoder().position();
+    _rightStart = _rightWheel->encoder().position();
+    uint16_t tpm = _driver->ticksPerMetre();
+    _mmPerEdge = ((1000UL << 14) + tpm / 2) / tpm;
+    _progress = 0;
+    _running = true;
+    if (s.type == TIMED) _driver->move(s.velocity, s.yawRate);
+    else _driver->move(approach(s, s.length), 0);
+}
+
+
+// The segment's speed, or less within reach of its end: the speed that
+// comes down to the next segment's over the mm left at half the driver's
+// acceleration, v^2 = next^2 + accel * left. The next segment's speed
+// counts only if it goes the same way; one that turns back or spins, or
+// the end of the queue, is taken as a stop. The test is on the squares,
+// so only the approach itself takes a root.
+int16_t MotionQueue::approach(const Segment& s, uint16_t left) {
+    int32_t v = abs(s.velocity);
+    int32_t next = 0;
+    if (_count > 1) {
+        const Segment& n = _segs[(_head + 1) & MASK];
+        if (n.velocity && (n.velocity > 0) == (s.velocity > 0)) next = min((int32_t)abs(n.velocity), v);
+    }
+    uint16_t accel = _driver->accel();
+    uint32_t reach = (uint32_t)left * accel;    // what v^2 can come down by over left
+    if (accel && v > MIN_APPROACH && reach < (uint32_t)(v * v - next * next)) {
+        v = constrain((int32_t)isqrt(next * next + reach), MIN_APPROACH, v);
+    }
+    return s.velocity < 0 ? -v : v;
+}
+
+
+void MotionQueue::page(struct MotionPage* p) {
+    memset(p, 0, sizeof(*p));
+    p->segment = _segment;
+    p->queued = _queued;
+    p->depth = _count;
+    p->flags = _running ? MOTION_FLAG_RUNNING : 0;
+    p->progress = _progress;
+    p->velocity = _driver->velocity();
+    p->yawRate = _driver->yawRate();
+    p->seq = _seq;
+}
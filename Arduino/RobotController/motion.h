@@ -0,0 +1,111 @@
+// motion.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#ifndef MOTION_H_
+#define MOTION_H_
+
+#include <Arduino.h>
+#include "wheel.h"
+#include "driver.h"
+
+#define MOTION_QUEUE_SIZE   16      // segments, power of two
+
+// Bits of MotionPage.flags
+#define MOTION_FLAG_RUNNING 0x01    // a segment is being driven
+
+// The queue as the master reads it, in place of the register map (see
+// PAGE_MOTION in i2c_handler.h). Segments are numbered in the order they
+// were queued, from 0 after the last clear; once the queue has run dry
+// segment equals queued.
+struct MotionPage {
+    uint16_t segment;                           //  0 number of the running segment
+    uint16_t queued;                            //  2 segments queued since the last clear
+    uint8_t depth;                              //  4 segments left, the running one included
+    uint8_t flags;                              //  5 MOTION_FLAG_*
+    uint16_t progress;                          //  6 ms or mm into the running segment
+    int16_t velocity;                           //  8 the driver's setpoint, mm/s
+    int16_t yawRate;                            // 10 mrad/s
+    uint8_t seq;                                // 12 bumped by every update
+    uint8_t reserved[3];                        // 13
+};
+
+static_assert(sizeof(struct MotionPage) == 16, "motion page is one 16-byte read");
+
+
+// A queue of motion segments the master uploads ahead of time, driven back
+// to back by the Driver (driver.h) so the master is out of the real-time
+// path. A timed segment holds a speed and yaw rate for so many ms; a
+// distance segment drives straight at a speed until the wheels have
+// covered so many mm between them.
+//
+// Each segment's speeds are handed to the driver as it starts, and the
+// driver's jerk-limited ramps blend one into the next. Timed segments
+// follow on from each other's end times, so a run of them keeps its
+// schedule whatever the control period. A distance segment slows on its
+// approach to the end -- to the next segment's speed if that goes the same
+// way, or to a crawl -- at half the driver's acceleration, which leaves
+// room for the jerk limit's rounding of the ramp. When the queue runs dry
+// the driver ramps to a stop.
+//
+// Segments are queued and cleared from loop() (the I2C commands run there,
+// between and in the control task), so nothing here is shared with an
+// interrupt. An update is 32-bit: a timed segment's ms is its only
+// divide, and the one by the geometry is done as each segment starts.
+class MotionQueue {
+
+    public:
+
+        MotionQueue(Driver* driver, Wheel* leftWheel, Wheel* rightWheel);
+
+        // Each returns false, queueing nothing, when the queue is full
+        boolean timed(uint16_t ms, int16_t velocity, int16_t yawRate);
+        boolean distance(uint16_t mm, int16_t speed);
+
+        void clear();                           // drops every segment; the driver is left as it is
+
+        void update();                          // call this method CONTROL_HZ times a second, before the driver's control()
+
+        boolean running() { return _running; }
+        uint8_t depth() { return _count; }
+        uint16_t segment() { return _segment; }
+
+        void page(struct MotionPage* p);
+
+    private:
+
+        struct Segment {
+            uint8_t type;
+            uint16_t length;                    // ms or mm
+            int16_t velocity;                   // mm/s
+            int16_t yawRate;                    // mrad/s, timed segments only
+        };
+
+        boolean push(uint8_t type, uint16_t length, int16_t velocity, int16_t yawRate);
+
+        void start(uint32_t now);
+
+        int16_t approach(const Segment& s, uint16_t left);
+
+        Driver* _driver;
+        Wheel* _leftWheel;
+        Wheel* _rightWheel;
+
+        Segment _segs[MOTION_QUEUE_SIZE];
+        uint8_t _head;                          // the running segment, or the next to run
+        uint8_t _count;
+
+        uint16_t _segment;
+        uint16_t _queued;
+        boolean _running;
+
+        uint32_t _started;                      // micros() the running segment started
+        int32_t _leftStart;                     // encoder positions it started from
+        int32_t _rightStart;
+        uint32_t _mmPerEdge;                    // Q14, from the driver's geometry as the segment started
+        uint16_t _progress;
+        uint8_t _seq;
+};
+
+#endif // MOTION_H_
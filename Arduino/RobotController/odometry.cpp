@@ -0,0 +1,169 @@
+// odometry.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#include "odometry.h"
+
+// Heading units (2^32 to the turn) in a radian, times 1000
+const uint64_t TURN_PER_RAD_X1000 = 683565275576ULL;
+
+// Heading units per gyro count per microsecond, Q16: 8.75 mdps a count
+const int32_t GYRO_TURN_PER_COUNT_US_Q16 = 6841;
+
+// mrad/s per gyro count, Q16
+const int32_t GYRO_MRAD_PER_COUNT_Q16 = 10008;
+
+// mrad in a degree, Q8
+const uint16_t MRAD_PER_DEGREE_Q8 = 4468;
+
+// A reading this far out is the gyro at its limit, not the robot's rate
+const int16_t GYRO_SATURATED = 32000;
+
+// No edge from either wheel for this long and the robot is standing still
+const uint32_t STILL_US = 250000UL;
+
+// A quarter wave of sine, Q15, every 1/256 of a turn
+static const uint16_t SINE[65] PROGMEM = {
+  0, 804, 1608, 2411, 3212, 4011, 4808, 5602,
+  6393, 7180, 7962, 8740, 9512, 10279, 11039, 11793,
+  12540, 13279, 14010, 14733, 15447, 16151, 16846, 17531,
+  18205, 18868, 19520, 20160, 20788, 21403, 22006, 22595,
+  23170, 23732, 24279, 24812, 25330, 25833, 26320, 26791,
+  27246, 27684, 28106, 28511, 28899, 29269, 29622, 29957,
+  30274, 30572, 30853, 31114, 31357, 31581, 31786, 31972,
+  32138, 32286, 32413, 32522, 32610, 32679, 32729, 32758,
+  32768
+};
+
+
+Odometry::Odometry(uint16_t ticksPerMetre, uint16_t wheelBaseMm) :
+  _umPerTick(0),
+  _turnPerTick(0),
+  _wheelBaseMm(0),
+  _slipRate(0),
+  _gyroBias(0),
+  _seq(0)
+{
+  setGeometry(ticksPerMetre, wheelBaseMm);
+  setSlipThreshold(3);
+  reset();
+}
+
+
+void Odometry::setGeometry(uint16_t ticksPerMetre, uint16_t wheelBaseMm) {
+  _umPerTick = (256000000UL + ticksPerMetre / 2) / ticksPerMetre;
+  uint32_t tb = (uint32_t)ticksPerMetre * wheelBaseMm;
+  _turnPerTick = (uint32_t)((TURN_PER_RAD_X1000 + tb / 2) / tb);
+  _wheelBaseMm = wheelBaseMm;
+}
+
+
+void Odometry::setSlipThreshold(uint8_t degPerSec) {
+  _slipRate = (int16_t)(((uint32_t)degPerSec * MRAD_PER_DEGREE_Q8 + 128) >> 8);
+}
+
+
+void Odometry::reset() {
+  _x = 0;
+  _y = 0;
+  _heading = 0;
+  _velocity = 0;
+  _yawRate = 0;
+  _flags = 0;
+  _started = false;
+}
+
+
+void Odometry::update(Encoder& left, Encoder& right) {
+  step(left, right, false, 0);
+}
+
+
+void Odometry::update(Encoder& left, Encoder& right, int16_t gyroZ) {
+  step(left, right, true, gyroZ);
+}
+
+
+// The first update after a reset only takes the encoder positions to count
+// from. The gyro is compared with the yaw rate from the encoders' speed
+// estimates rather than with the period's edges: at CONTROL_HZ one edge of
+// difference between the wheels is tens of degrees a second. A wheel moving
+// slowly can go a period without an edge, so the gyro bias is only learned
+// once neither has moved for STILL_US. A saturated gyro reading is no use
+// and the update goes by the wheels alone.
+void Odometry::step(Encoder& left, Encoder& right, boolean gyro, int16_t gyroZ) {
+  uint32_t now = micros();
+  int32_t l = left.position();
+  int32_t r = right.position();
+  if (!_started) {
+    _lastLeft = l;
+    _lastRight = r;
+    _lastUpdate = now;
+    _lastMoved = now;
+    _started = true;
+    return;
+  }
+  int32_t dl = l - _lastLeft;
+  int32_t dr = r - _lastRight;
+  uint32_t dt = now - _lastUpdate;
+  _lastLeft = l;
+  _lastRight = r;
+  _lastUpdate = now;
+
+  int32_t ds = (dl + dr) * (int32_t)_umPerTick / 2;           // Q8 um
+  int32_t turn = (dr - dl) * (int32_t)_turnPerTick;
+  int32_t umPerTick = _umPerTick >> 4;                        // Q4, for the rates
+  int16_t wheelYaw = (int16_t)constrain(((int32_t)right.velocity() - left.velocity()) * umPerTick /
+                                        (16L * _wheelBaseMm), -32767L, 32767L);
+  _yawRate = wheelYaw;
+  _flags = 0;
+
+  if (gyro && gyroZ > -GYRO_SATURATED && gyroZ < GYRO_SATURATED) {
+    _flags = ODOM_FLAG_GYRO;
+    int32_t rate = ((int32_t)gyroZ << 4) - _gyroBias;         // Q4 counts
+    if (dl || dr) _lastMoved = now;
+    if (now - _lastMoved >= STILL_US) {
+      _gyroBias += rate >> 4;                                 // standing still: all of it is bias
+      _yawRate = 0;
+    } else {
+      int32_t gyroYaw = ((rate >> 4) * GYRO_MRAD_PER_COUNT_Q16) >> 16;
+      if (labs(gyroYaw - wheelYaw) > _slipRate) {
+        turn = (int32_t)(((int64_t)rate * dt * GYRO_TURN_PER_COUNT_US_Q16) >> 20);
+        _yawRate = (int16_t)constrain(gyroYaw, -32767L, 32767L);
+        _flags |= ODOM_FLAG_SLIP;
+      }
+    }
+  }
+
+  uint16_t mid = (_heading + (uint32_t)(turn / 2)) >> 16;
+  _x += ((int64_t)ds * cosQ15(mid)) >> 15;
+  _y += ((int64_t)ds * sinQ15(mid)) >> 15;
+  _heading += (uint32_t)turn;
+
+  _velocity = (int16_t)constrain(((int32_t)left.velocity() + right.velocity()) * umPerTick / 32000L,
+                                 -32767L, 32767L);
+  _seq++;
+}
+
+
+void Odometry::page(struct OdometryPage* p) {
+  p->x = x();
+  p->y = y();
+  p->heading = heading();
+  p->velocity = _velocity;
+  p->yawRate = _yawRate;
+  p->seq = _seq;
+  p->flags = _flags;
+}
+
+
+// Linear between the table's points: within 1/13000 of the true value.
+int32_t Odometry::sinQ15(uint16_t angle) {
+  uint16_t r = angle & 0x3FFF;
+  if (angle & 0x4000) r = 0x4000 - r;
+  uint8_t i = r >> 8;
+  int32_t s = pgm_read_word(&SINE[i]);
+  if (i < 64) s += (((int32_t)pgm_read_word(&SINE[i + 1]) - s) * (r & 0xFF) + 128) >> 8;
+  return angle & 0x8000 ? -s : s;
+}
@@ -0,0 +1,108 @@
+// odometry.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#ifndef ODOMETRY_H_
+#define ODOMETRY_H_
+
+#include <Arduino.h>
+#include "encoder.h"
+
+// Bits of OdometryPage.flags
+#define ODOM_FLAG_GYRO  0x01    // the last update had a gyro rate, not saturated
+#define ODOM_FLAG_SLIP  0x02    // ... and took its heading from the gyro, not the wheels
+
+// The pose as the master reads it, in place of the register map (see
+// PAGE_ODOMETRY in i2c_handler.h). x is along the heading at the last
+// reset, y to its left; the heading counts counter-clockwise.
+struct OdometryPage {
+  int32_t x;                                    //  0 um
+  int32_t y;                                    //  4 um
+  uint16_t heading;                             //  8 65536 to the turn
+  int16_t velocity;                             // 10 mm/s, forward
+  int16_t yawRate;                              // 12 mrad/s, counter-clockwise
+  uint8_t seq;                                  // 14 bumped by every update
+  uint8_t flags;                                // 15 ODOM_FLAG_*
+};
+
+static_assert(sizeof(struct OdometryPage) == 16, "odometry page is one 16-byte read");
+
+
+// Differential-drive dead reckoning from the wheel encoders, in fixed
+// point. Each control period update() takes the edges each wheel moved
+// since the last: their mean is the distance travelled, their difference
+// over the wheel base the turn, and the distance is laid along the heading
+// half way through the turn. The heading is a binary angle, 2^32 to the
+// turn, so it wraps for free; x and y are kept in 1/256 um so a slow wheel
+// loses nothing to rounding.
+//
+// With the gyro rate as well (the MinIMU-9's LSM6 at its default 245 dps,
+// 8.75 mdps a count) the heading is gyrodometry: the wheels' turn is used
+// while the gyro's rate agrees with theirs to within the slip threshold,
+// and the gyro's turn when they disagree -- a wheel slipping or the robot
+// knocked. The gyro's bias is learned while the robot stands still.
+//
+// The velocity is the mean of the encoders' speed estimates (see
+// encoder.h), and the yaw rate the gyro's when the heading came from it,
+// the encoders' otherwise.
+class Odometry {
+
+  public:
+
+    // ticksPerMetre is encoder edges per metre of wheel travel, wheelBaseMm
+    // the distance between the wheels' contact points
+    Odometry(uint16_t ticksPerMetre, uint16_t wheelBaseMm);
+
+    void setGeometry(uint16_t ticksPerMetre, uint16_t wheelBaseMm);
+
+    void setSlipThreshold(uint8_t degPerSec);   // gyro and wheel yaw rates further apart use the gyro
+
+    void reset();                               // back to the origin, heading 0; the gyro bias is kept
+
+    // Call once per control period after the encoders' update()
+    void update(Encoder& left, Encoder& right);
+    void update(Encoder& left, Encoder& right, int16_t gyroZ);   // raw LSM6 counts, robot z up
+
+    int32_t x() { return (int32_t)(_x >> 8); }  // um
+    int32_t y() { return (int32_t)(_y >> 8); }
+    uint32_t heading32() { return _heading; }   // 2^32 to the turn
+    uint16_t heading() { return _heading >> 16; }
+    int16_t velocity() { return _velocity; }    // mm/s
+    int16_t yawRate() { return _yawRate; }      // mrad/s
+    uint8_t flags() { return _flags; }
+    int16_t gyroBias() { return (int16_t)(_gyroBias >> 4); }   // raw counts
+
+    void page(struct OdometryPage* p);
+
+    static int32_t sinQ15(uint16_t angle);      // 65536 to the turn, result in [-32768, 32768]
+    static int32_t cosQ15(uint16_t angle) { return sinQ15(angle + 0x4000); }
+
+  private:
+
+    void step(Encoder& left, Encoder& right, boolean gyro, int16_t gyroZ);
+
+    uint32_t _umPerTick;                        // Q8
+    uint32_t _turnPerTick;                      // heading units for one edge of difference between the wheels
+    uint16_t _wheelBaseMm;
+    int16_t _slipRate;                          // mrad/s
+
+    int64_t _x;                                 // Q8 um
+    int64_t _y;
+    uint32_t _heading;
+
+    int32_t _lastLeft;                          // encoder positions at the last update
+    int32_t _lastRight;
+    uint32_t _lastUpdate;                       // micros()
+    uint32_t _lastMoved;                        // micros() of the last update with an edge
+    boolean _started;
+
+    int32_t _gyroBias;                          // Q4 raw counts
+
+    int16_t _velocity;
+    int16_t _yawRate;
+    uint8_t _seq;
+    uint8_t _flags;
+};
+
+#endif // ODOMETRY_H_
@@ -0,0 +1,77 @@
+// orientation.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#ifndef ORIENTATION_H_
+#define ORIENTATION_H_
+
+#include <Arduino.h>
+
+// Sensor axes, for naming them in an Orientation; negate one to reverse it
+#define SENSOR_X  1
+#define SENSOR_Y  2
+#define SENSOR_Z  3
+
+
+// How a sensor is mounted, as the sensor axis that lies along each robot
+// axis: Orientation<SENSOR_Y, -SENSOR_X, SENSOR_Z> is a board turned 90°
+// clockwise seen from above, so the robot's x is the sensor's y and the
+// robot's y is the sensor's -x. Any 90° mount is one of the 24 rotations;
+// the 24 mirror images (rotation() is false) are accepted too, for a
+// sensor whose axes are left-handed.
+//
+// Everything is a compile-time constant, so apply() and the pick<>()
+// behind it fold down to plain moves and negations: no multiplies and no
+// table lookups in the read path.
+template <int8_t X, int8_t Y, int8_t Z>
+struct Orientation {
+
+  static_assert(X != 0 && Y != 0 && Z != 0 && X >= -3 && X <= 3 && Y >= -3 && Y <= 3 && Z >= -3 && Z <= 3,
+    "Orientation axes must be SENSOR_X, SENSOR_Y or SENSOR_Z, optionally negated");
+  static_assert((X < 0 ? -X : X) != (Y < 0 ? -Y : Y) && (Y < 0 ? -Y : Y) != (Z < 0 ? -Z : Z)
+    && (X < 0 ? -X : X) != (Z < 0 ? -Z : Z), "Orientation must use each sensor axis once");
+
+  // Sensor axis (0-2) along robot axis r (0-2), and whether it is reversed
+  static constexpr uint8_t source(uint8_t r) {
+    return (uint8_t)((r == 0 ? (X < 0 ? -X : X) : r == 1 ? (Y < 0 ? -Y : Y) : (Z < 0 ? -Z : Z)) - 1);
+  }
+
+  static constexpr bool reversed(uint8_t r) {
+    return (r == 0 ? X : r == 1 ? Y : Z) < 0;
+  }
+
+  // Robot axis that sensor axis s lies along
+  static constexpr uint8_t target(uint8_t s) {
+    return source(0) == s ? 0 : source(1) == s ? 1 : 2;
+  }
+
+  // True for a rotation, false for a mirror image: an even (cyclic)
+  // permutation with an even number of reversed axes, or an odd one with
+  // an odd number.
+  static constexpr bool rotation() {
+    return ((source(0) + 1) % 3 == source(1)) == !(reversed(0) ^ reversed(1) ^ reversed(2));
+  }
+
+  // Robot axis R of sensor reading (x, y, z)
+  template <uint8_t R, typename T>
+  static inline T pick(T x, T y, T z) {
+    return source(R) == 0 ? (reversed(R) ? (T)-x : x)
+         : source(R) == 1 ? (reversed(R) ? (T)-y : y)
+         :                  (reversed(R) ? (T)-z : z);
+  }
+
+  // Turns a sensor reading into robot axes in place
+  template <typename T>
+  static inline void apply(T& x, T& y, T& z) {
+    T sx = x, sy = y, sz = z;
+    x = pick<0>(sx, sy, sz);
+    y = pick<1>(sx, sy, sz);
+    z = pick<2>(sx, sy, sz);
+  }
+};
+
+// The sensor's axes are the robot's
+typedef Orientation<SENSOR_X, SENSOR_Y, SENSOR_Z> IdentityOrientation;
+
+#endif // ORIENTATION_H_
@@ -7,55 +7,136 @@
 #include "piezo.h"
 
 
+// One step of a tune: play frequency (0 for a rest) for toneMs, and start
+// the next step stepMs after this one. A step with stepMs 0 ends the tune.
+struct Step {
+  uint16_t frequency;
+  uint16_t toneMs;
+  uint16_t stepMs;
+};
+
+static const Step TUNE_CHARGE[] PROGMEM = {
+  { NOTE_C5, 150, 150 },
+  { NOTE_E5, 150, 150 },
+  { NOTE_F5, 150, 200 },
+  { NOTE_G5, 300, 400 },
+  { NOTE_E5, 150, 150 },
+  { NOTE_G5, 500, 500 },
+  { 0, 0, 0 }
+};
+
+static const Step TUNE_TADA[] PROGMEM = {
+  { NOTE_C5, 200, 200 },
+  { NOTE_G5, 500, 500 },
+  { 0, 0, 0 }
+};
+
+static const Step TUNE_DATA[] PROGMEM = {
+  { NOTE_G5, 200, 200 },
+  { NOTE_C5, 500, 500 },
+  { 0, 0, 0 }
+};
+
+static const Step TUNE_PLUS[] PROGMEM = {
+  { NOTE_G5, 500, 500 },
+  { 0, 0, 0 }
+};
+
+static const Step TUNE_MINUS[] PROGMEM = {
+  { NOTE_C5, 500, 500 },
+  { 0, 0, 0 }
+};
+
+static const Step TUNE_BONK[] PROGMEM = {
+  { NOTE_C3, 500, 500 },
+  { 0, 0, 0 }
+};
+
+
+struct Tune {
+  const Step* steps;
+  uint8_t pin;
+};
+
+static Tune tuneQueue[PIEZO_QUEUE_SIZE];
+static uint8_t tuneHead = 0;                    // free-running, masked on use
+static uint8_t tuneTail = 0;
+static uint8_t tunesDropped = 0;
+
+static const Step* step = 0;                    // next step of the current tune, 0 when idle
+static uint8_t stepPin = 0;
+static unsigned long stepTime = 0UL;            // millis() when the next step starts
+
+
+static void play(int piezo, const Step* steps) {
+  if ((uint8_t)(tuneHead - tuneTail) >= PIEZO_QUEUE_SIZE) {
+    tunesDropped++;
+    return;
+  }
+  Tune& t = tuneQueue[tuneHead++ & (PIEZO_QUEUE_SIZE - 1)];
+  t.steps = steps;
+  t.pin = piezo;
+}
+
+
+void updatePiezo() {
+  unsigned long m = millis();
+  if (!step) {
+    if (tuneHead == tuneTail) return;
+    Tune& t = tuneQueue[tuneTail++ & (PIEZO_QUEUE_SIZE - 1)];
+    step = t.steps;
+    stepPin = t.pin;
+    stepTime = m;
+  }
+  if ((long)(m - stepTime) < 0) return;
+
+  uint16_t frequency = pgm_read_word(&step->frequency);
+  uint16_t toneMs = pgm_read_word(&step->toneMs);
+  uint16_t stepMs = pgm_read_word(&step->stepMs);
+  if (stepMs == 0) {
+    noTone(stepPin);
+    step = 0;
+    return;
+  }
+  if (frequency) tone(stepPin, frequency, toneMs);
+  else noTone(stepPin);
+  stepTime += stepMs;
+  step++;
+}
+
+
+boolean piezoBusy() {
+  return step != 0 || tuneHead != tuneTail;
+}
+
+
+uint8_t piezoDropped() {
+  return tunesDropped;
+}
+
+
 void playCharge(int piezo) {
-  tone(piezo, NOTE_C5, 150);
-  delay(150);
-  tone(piezo, NOTE_E5, 150);
-  delay(150);
-  tone(piezo, NOTE_F5, 150);
-  delay(200);
-  tone(piezo, NOTE_G5, 300);
-  delay(400);
-  tone(piezo, NOTE_E5, 150);
-  delay(150);
-  tone(piezo, NOTE_G5, 500);
-  delay(500);
-  noTone(piezo);
+  play(piezo, TUNE_CHARGE);
 }
 
 
 void playTaDa(int piezo) {
-  tone(piezo, NOTE_C5, 200);
-  delay(200);
-  tone(piezo, NOTE_G5, 500);
-  delay(500);
-  noTone(piezo);
+  play(piezo, TUNE_TADA);
 }
 
 
 void playDaTa(int piezo) {
-  tone(piezo, NOTE_G5, 200);
-  delay(200);
-  tone(piezo, NOTE_C5, 500);
-  delay(500);
-  noTone(piezo);
+  play(piezo, TUNE_DATA);
 }
 
 void playPlus(int piezo) {
-  tone(piezo, NOTE_G5, 500);
-  delay(500);
-  noTone(piezo);
+  play(piezo, TUNE_PLUS);
 }
 
 void playMinus(int piezo) {
-  tone(piezo, NOTE_C5, 500);
-  delay(500);
-  noTone(piezo);
+  play(piezo, TUNE_MINUS);
 }
 
 void playBonk(int piezo) {
-  tone(piezo, NOTE_C3, 500);
-  delay(500);
-  noTone(piezo);
+  play(piezo, TUNE_BONK);
 }
-
@@ -6,6 +6,8 @@
 #ifndef PIEZO_H_
 #define PIEZO_H_
 
+#include <Arduino.h>
+
 #define NOTE_B0  31
 #define NOTE_C1  33
 #define NOTE_CS1 35
@@ -96,6 +98,20 @@
 #define NOTE_D8  4699
 #define NOTE_DS8 4978
 
+// The play functions queue a tune and return at once; updatePiezo(), run
+// by the UI task (UI_HZ in config.h), starts each note. A note starts up
+// to one UI period late, 50 ms at 20 Hz, but the schedule doesn't drift:
+// each step is timed from when the last was due, and tone() times its
+// length. Steps must be at least one UI period apart. Tunes queued while
+// one is playing follow it in order; a tune that doesn't fit in the queue
+// is dropped.
+
+#define PIEZO_QUEUE_SIZE 4      // tunes, power of two
+
+void updatePiezo();
+boolean piezoBusy();            // a tune is playing or queued
+uint8_t piezoDropped();         // tunes dropped because the queue was full
+
 void playCharge(int piezo);
 void playTaDa(int piezo);
 void playDaTa(int piezo);
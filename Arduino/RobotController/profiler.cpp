@@ -0,0 +1,109 @@
+// profiler.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#include <Arduino.h>
+#include "profiler.h"
+#include "logger.h"
+
+
+Profiler Profile;
+
+
+static const char NAME_LOOP[] PROGMEM = "loop";
+static const char NAME_CONTROL[] PROGMEM = "control";
+static const char NAME_SENSORS[] PROGMEM = "sensors";
+static const char NAME_UI[] PROGMEM = "ui";
+static const char NAME_TELEMETRY[] PROGMEM = "telemetry";
+static const char NAME_CONTROL_JITTER[] PROGMEM = "ctl jitter";
+static const char NAME_I2C_REQUEST[] PROGMEM = "i2c req";
+static const char NAME_I2C_RECEIVE[] PROGMEM = "i2c recv";
+
+static const char* const NAMES[PROBE_COUNT] PROGMEM = {
+    NAME_LOOP,
+    NAME_CONTROL,
+    NAME_SENSORS,
+    NAME_UI,
+    NAME_TELEMETRY,
+    NAME_CONTROL_JITTER,
+    NAME_I2C_REQUEST,
+    NAME_I2C_RECEIVE
+};
+
+
+Profiler::Profiler() :
+    _reportNext(PROBE_COUNT)
+{
+    reset();
+}
+
+
+void Profiler::add(ProbeStats& s, uint32_t value) {
+    uint16_t v = value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+    if (v < s.min) s.min = v;
+    if (v > s.max) s.max = v;
+    s.total += value;
+    s.count++;
+
+    uint8_t b = 0;
+    for (v >>= 1; v && b < PROFILE_BUCKETS - 1; v >>= 1) b++;
+    if (s.hist[b] == 0xFF) {
+        for (uint8_t i = 0; i < PROFILE_BUCKETS; i++) s.hist[i] >>= 1;
+    }
+    s.hist[b]++;
+}
+
+
+void Profiler::reset() {
+#if PROFILE_ENABLED
+    noInterrupts();
+    memset(_stats, 0, sizeof(_stats));
+    for (uint8_t i = 0; i < PROBE_COUNT; i++) _stats[i].min = 0xFFFF;
+    interrupts();
+#endif
+}
+
+
+ProbeStats Profiler::stats(uint8_t probe) {
+    ProbeStats s;
+#if PROFILE_ENABLED
+    noInterrupts();
+    s = _stats[probe];
+    interrupts();
+#else
+    memset(&s, 0, sizeof(s));
+#endif
+    return s;
+}
+
+
+void Profiler::page(uint8_t probe, struct ProfilePage* p) {
+#if PROFILE_ENABLED
+    const ProbeStats& s = _stats[probe];
+#else
+    ProbeStats s = stats(probe);
+#endif
+    p->probe = probe;
+    p->buckets = PROFILE_BUCKETS;
+    p->min = s.count ? s.min : 0;
+    p->max = s.max;
+    p->mean = s.count ? (uint16_t)min(s.total / s.count, 0xFFFFUL) : 0;
+    for (uint8_t i = 0; i < PROFILE_BUCKETS; i++) p->hist[i] = s.hist[i];
+}
+
+
+void Profiler::updateReport() {
+    if (_reportNext >= PROBE_COUNT || !Log.idle()) return;
+    uint8_t i = _reportNext++;
+    ProbeStats s = stats(i);
+    LOG_INFO("prof %S %s n=%u min=%u max=%u mean=%u", name(i), unit(i), s.count,
+        s.count ? s.min : 0, s.max, s.count ? s.total / s.count : 0);
+    LOG_INFO("  %u %u %u %u %u %u", s.hist[0], s.hist[1], s.hist[2], s.hist[3], s.hist[4], s.hist[5]);
+    LOG_INFO("  %u %u %u %u %u %u", s.hist[6], s.hist[7], s.hist[8], s.hist[9], s.hist[10], s.hist[11]);
+}
+
+
+const __FlashStringHelper* Profiler::name(uint8_t probe) {
+    return reinterpret_cast<const __FlashStringHelper*>(pgm_read_ptr(&NAMES[probe]));
+}
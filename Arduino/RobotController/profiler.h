@@ -0,0 +1,161 @@
+// profiler.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <Arduino.h>
+#include "config.h"
+
+// Timing probes for the scheduler tasks, loop() and the Wire handlers.
+// Each probe keeps the count, min, max and mean of its samples and a
+// histogram with one bucket per power of two:
+//
+//   bucket 0: 0-1, bucket b: 2^b to 2^(b+1)-1, last bucket: 2^11 and up
+//
+// The buckets are a byte each: when one would pass 255 every bucket is
+// halved, so the histogram keeps the shape of the distribution, weighted
+// to recent samples, rather than counts; count has the number of samples.
+// The profile page widens them to 16 bits.
+//
+// On the Nano a region is timed with micros() (4 us resolution). In the
+// host simulation micros() is simulated time, which stands still while
+// sketch code runs, so regions are timed in host nanoseconds instead;
+// jitter probes are always in micros(). A probe is two micros() calls,
+// several us on a 16 MHz AVR, so PROFILE_ENABLED (config.h) is false on
+// the board, which compiles every probe, and the stats' RAM, out; the
+// pages then read 0. The host build turns it on. The encoder handlers are
+// a timestamp and a count, cheaper than a probe, and have none; RobotSim
+// times every interrupt handler itself.
+//
+//   void controlTask() {
+//     PROFILE_SCOPE(PROBE_CONTROL);
+//     ...
+//   }
+//
+// The stats are read over Serial (see report()) or over I2C as a page of
+// the register map (see ProfilePage and CMD_SELECT_PAGE in i2c_handler.h).
+
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED true
+#endif
+
+#define PROFILE_BUCKETS 12
+
+#ifdef HOST_SIM
+#define PROFILE_CLOCK() hostNanos()
+#define PROFILE_UNIT    "ns"
+#else
+#define PROFILE_CLOCK() micros()
+#define PROFILE_UNIT    "us"
+#endif
+
+enum ProbeId {
+    PROBE_LOOP,                                 // one pass of loop()
+    PROBE_CONTROL,                              // scheduler tasks
+    PROBE_SENSORS,
+    PROBE_UI,
+    PROBE_TELEMETRY,
+    PROBE_CONTROL_JITTER,                       // how late the control task started, us
+    PROBE_I2C_REQUEST,                          // Wire handlers
+    PROBE_I2C_RECEIVE,
+    PROBE_COUNT
+};
+
+struct ProbeStats {
+    uint32_t count;
+    uint32_t total;                             // sum of the samples, wraps
+    uint16_t min;                               // samples are clamped to 65535
+    uint16_t max;
+    uint8_t hist[PROFILE_BUCKETS];              // halved together when one fills
+};
+
+// One probe as the master reads it, in place of the 32-byte register map.
+struct ProfilePage {
+    byte probe;                                 //  0 ProbeId
+    byte buckets;                               //  1 PROFILE_BUCKETS
+    uint16_t min;                               //  2
+    uint16_t max;                               //  4
+    uint16_t mean;                              //  6
+    uint16_t hist[PROFILE_BUCKETS];             //  8
+};
+
+static_assert(sizeof(struct ProfilePage) <= 32, "profile page must fit one Wire transaction");
+
+
+class Profiler {
+
+    public:
+
+        Profiler();
+
+        // Adds one sample. Each probe must only be fed from one context: loop()
+        // or a single interrupt handler.
+        void record(uint8_t probe, uint32_t value) {
+#if PROFILE_ENABLED
+            if (probe < PROBE_COUNT) add(_stats[probe], value);
+#endif
+        }
+
+        void reset();
+
+        ProbeStats stats(uint8_t probe);        // a copy, taken with interrupts off
+
+        // Fills a page for the master. Called from the I2C request handler,
+        // so a probe fed from loop() may be caught between fields; the page
+        // is diagnostic and the next read is whole.
+        void page(uint8_t probe, struct ProfilePage* p);
+
+        // Queues a log report of every probe, one probe per call to
+        // updateReport() so the log queue never fills.
+        void report() { _reportNext = 0; }
+
+        void updateReport();                    // call from a periodic task
+
+        static const __FlashStringHelper* name(uint8_t probe);
+
+        static const char* unit(uint8_t probe) {
+            return probe == PROBE_CONTROL_JITTER ? "us" : PROFILE_UNIT;
+        }
+
+    private:
+
+        static void add(ProbeStats& s, uint32_t value);
+
+#if PROFILE_ENABLED
+        ProbeStats _stats[PROBE_COUNT];
+#endif
+        uint8_t _reportNext;                    // next probe to report, PROBE_COUNT when idle
+};
+
+extern Profiler Profile;
+
+
+#if PROFILE_ENABLED
+
+// Times the rest of the enclosing block.
+class ProfileScope {
+
+    public:
+
+        explicit ProfileScope(uint8_t probe) : _probe(probe), _start(PROFILE_CLOCK()) {}
+
+        ~ProfileScope() { Profile.record(_probe, PROFILE_CLOCK() - _start); }
+
+    private:
+
+        uint8_t _probe;
+        uint32_t _start;
+};
+
+#define PROFILE_SCOPE(probe) ProfileScope _profileScope(probe)
+
+#else
+
+#define PROFILE_SCOPE(probe) do {} while (0)
+
+#endif // PROFILE_ENABLED
+
+#endif // PROFILER_H_
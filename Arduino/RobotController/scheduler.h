@@ -0,0 +1,106 @@
+// scheduler.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <Arduino.h>
+
+// Cooperative fixed-period task scheduler with rate-monotonic priorities:
+// tasks are kept sorted by period, and each call to run() starts only the
+// most urgent task that is due. loop() calls run() every pass, so after
+// any task finishes the shortest-period task is the first to be looked at
+// again, and a long low-priority task delays it by at most its own run
+// time. Tasks never preempt each other, so each one must return quickly.
+//
+// Release times are micros() values compared by signed difference, so
+// they stay correct across the 71 minute wrap. A task that starts a whole
+// period or more late has missed a release: the miss is counted as an
+// overrun and the missed releases are skipped rather than run back to
+// back.
+//
+// No allocation: the task table is a fixed array of N entries.
+
+template <uint8_t N>
+class Scheduler {
+
+  public:
+
+    typedef void (*TaskFn)();
+
+    struct Task {
+      TaskFn fn;
+      const __FlashStringHelper* name;
+      uint32_t period;                          // microseconds
+      uint32_t next;                            // micros() of the next release
+      uint16_t runs;
+      uint16_t overruns;                        // releases missed because the task started a period or more late
+    };
+
+    Scheduler() : _count(0), _late(0) {}
+
+    // Adds a task, keeping the table in rate-monotonic order. Returns false
+    // if the table is full.
+    boolean add(TaskFn fn, uint32_t periodUs, const __FlashStringHelper* name) {
+      if (_count >= N) return false;
+      uint8_t i = _count++;
+      while (i > 0 && _tasks[i - 1].period > periodUs) {
+        _tasks[i] = _tasks[i - 1];
+        i--;
+      }
+      Task& t = _tasks[i];
+      t.fn = fn;
+      t.name = name;
+      t.period = periodUs;
+      t.next = micros();
+      t.runs = 0;
+      t.overruns = 0;
+      return true;
+    }
+
+    // Releases every task now; call once at the end of setup().
+    void start() {
+      uint32_t now = micros();
+      for (uint8_t i = 0; i < _count; i++) _tasks[i].next = now;
+    }
+
+    // Runs the highest-priority task that is due, if any. Returns true if a
+    // task ran.
+    boolean run() {
+      uint32_t now = micros();
+      for (uint8_t i = 0; i < _count; i++) {
+        Task& t = _tasks[i];
+        uint32_t late = now - t.next;
+        if ((int32_t)late < 0) continue;
+        if (late >= t.period) {
+          uint32_t missed = late / t.period;
+          t.overruns += missed;
+          t.next += missed * t.period;
+        }
+        t.next += t.period;
+        t.runs++;
+        _late = late;
+        t.fn();
+        return true;
+      }
+      return false;
+    }
+
+    uint8_t count() { return _count; }
+
+    const Task& task(uint8_t i) { return _tasks[i]; }
+
+    // Microseconds between the release and the start of the task now
+    // running (or the last one to run).
+    uint32_t lateness() { return _late; }
+
+  private:
+
+    Task _tasks[N];
+    uint8_t _count;
+    uint32_t _late;
+};
+
+#endif // SCHEDULER_H_
@@ -0,0 +1,19 @@
+// sync.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Helpers for data shared between loop() and interrupt handlers.
+
+#ifndef SYNC_H_
+#define SYNC_H_
+
+#include <Arduino.h>
+
+// Keeps the compiler from moving memory accesses across this point. A
+// single-core AVR needs nothing more; the host build supplies a real fence.
+#ifndef memoryBarrier
+#define memoryBarrier() __asm__ __volatile__("" ::: "memory")
+#endif
+
+#endif // SYNC_H_
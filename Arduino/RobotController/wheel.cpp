@@ -7,47 +7,40 @@
 //
 //      INA     INB     Effect
 //      ----    ----    --------------------
-//      LOW     LOW     Brake
+//      LOW     LOW     Stop (coast)
 //      LOW     HIGH    Forward
 //      HIGH    LOW     Reverse
-//      HIGH    HIGH    Coast (do not use)
+//      HIGH    HIGH    Short brake
 
 #include "wheel.h"
+#include "config.h"
+#include "logger.h"
 
-const boolean _debug = true;
+// Debug records go through the log queue, and only when both LOG_LEVEL
+// includes debug and this wheel has debug enabled.
+#define WHEEL_LOG(fmt, ...) \
+  do { if (_debug) LOG_DEBUG("%s Wheel: " fmt, _label, ##__VA_ARGS__); } while (0)
 
-const unsigned long ADJ_DELAY = 200L;
-
-Wheel::Wheel(String label, int pwmPin, int inaPin, int inbPin, int initoff, boolean debug) :
+Wheel::Wheel(const char* label, int pwmPin, int inaPin, int inbPin, boolean debug) :
+  _tickStats(true),
   _lastTickTime(0L),
-  _nextAdjTime(0L),
-  _tbix(0),
+  _ticking(false),
   _pwmPin(pwmPin),
   _inaPin(inaPin),
   _inbPin(inbPin),
-  _initoff(initoff),
-  _speed(0),
+  _dir(0),
+  _power(0),
+  _state(RUNNING),
+  _brakeUntil(0L),
   _pwm(0),
   _label(label),
   _debug(debug)
 {
-  if (_debug) {
-    Serial.print(label);
-    Serial.print(" Wheel: ");
-    Serial.print("Initializing pwmPin=");
-    Serial.print(pwmPin);
-    Serial.print(", inaPin=");
-    Serial.print(inaPin);
-    Serial.print(", inbPin=");
-    Serial.print(inbPin);
-    Serial.print(", initoff=");
-    Serial.println(initoff);
-  }
-  for (int i = 0; i < TBSZ; i++) _tickBuf[i] = 0L;
+  WHEEL_LOG("Initializing pwmPin=%d, inaPin=%d, inbPin=%d", pwmPin, inaPin, inbPin);
   pinMode(_pwmPin, OUTPUT);
   pinMode(_inaPin, OUTPUT);
   pinMode(_inbPin, OUTPUT);
-  setSpeed(0);
+  setPower(0);
 }
 
 
@@ -58,70 +51,129 @@ Wheel::~Wheel() {
 }
 
 
-void Wheel::tick() {
-  unsigned long mics = micros();
-  _tickBuf[_tbix] = mics - _lastTickTime;
-  _lastTickTime = mics;
-  if (++_tbix >= TBSZ) _tbix = 0;
+// An interval as long as the stall timeout is the wheel starting again, and
+// starts a new average rather than joining the old one.
+void Wheel::tick(unsigned long t) {
+  if (_ticking && t - _lastTickTime < STALL_US) {
+    _tickStats.add(t - _lastTickTime);
+  } else {
+    _tickStats.reset();
+  }
+  _lastTickTime = t;
+  _ticking = true;
 }
 
 
-unsigned int Wheel::avgTickTime() {
-  unsigned long total = 0L;
-  noInterrupts();
-  for (int i = 0; i < TBSZ; i++) total += _tickBuf[i];
-  interrupts();
-  return (unsigned int)(total / TBSZ);
+// Advances the brake state machine and measures the wheel; the speed loop
+// closed over it is the Driver's (driver.h). The update that releases the
+// brake leaves the wheel REVERSING, and the next one makes it RUNNING, so
+// state() shows each reversal for a control period.
+void Wheel::control() {
+  measure();
+  if (_state == BRAKING) {
+    if ((long)(millis() - _brakeUntil) < 0) return;
+    _state = REVERSING;
+    setDirection(_power);
+    drive();
+    return;
+  }
+  _state = RUNNING;
 }
 
 
-void Wheel::setSpeed(int s) {
-  if ((s > 0 && _speed < 0) || (s < 0 && _speed > 0)) {
-    if (_debug) {
-      Serial.print(_label);
-      Serial.print(" Wheel: ");
-      Serial.println("Stopping motor to prepare for direction change.");
-    }
-    setPWM(0);
-    delay(ADJ_DELAY);
+// The speed estimate (see encoder.h), and the tick intervals from the edge
+// timestamps. The encoder interrupt only writes the timestamps, so the
+// interval average is the control task's alone and needs no critical
+// section.
+void Wheel::measure() {
+  _enc.update();
+  uint32_t t;
+  while (_enc.nextEdge(t)) tick(t);
+  if (_ticking && micros() - _lastTickTime >= STALL_US) {
+    _tickStats.reset();
+    _ticking = false;
   }
+}
+
+
+unsigned int Wheel::tickTPS() {
+  unsigned long avg = _tickStats.mean();
+  return avg ? (unsigned int)min((1000000UL + avg / 2) / avg, 65535UL) : 0;
+}
+
+
+void Wheel::setPower(int p) {
+  if (p > 255) p = 255;
+  else if (p < -255) p = -255;
+
+  _power = p;
+  if (setDirection(p)) drive();
+}
+
+
+// The direction pins only change with the sign of p; 0 keeps them, and
+// PWM 0 while driven is a short brake. The driver ramps a wheel down
+// through zero, so one already under REVERSE_TPS reverses without the
+// brake.
+void Wheel::command(int p) {
+  if (p > 255) p = 255;
+  else if (p < -255) p = -255;
 
-  if (s > MAX_FWD_SPEED) _speed = MAX_FWD_SPEED;
-  else if (s < MAX_REV_SPEED) _speed = MAX_REV_SPEED;
-  else _speed = s;
-
-  if (_debug) {
-    Serial.print(_label);
-    Serial.print(" Wheel: ");
-    Serial.print("Setting direction to ");
-    Serial.print(_speed < 0 ? "REVERSE" : (_speed > 0 ? "FORWARD" : "STOP"));
-    Serial.print(" (ina ");
-    Serial.print(_speed >= 0 ? "LOW" : "HIGH");
-    Serial.print(", inb ");
-    Serial.print(_speed <= 0 ? "LOW" : "HIGH");
-    Serial.print(")");
+  _power = p;
+  int dir = p > 0 ? 1 : (p < 0 ? -1 : 0);
+  if (dir && dir != _dir) {
+    if (_state != BRAKING && _enc.tps() < REVERSE_TPS) _dir = 0;
+    if (!setDirection(p)) return;
   }
-  digitalWrite(_inaPin, _speed >= 0 ? LOW : HIGH);
-  digitalWrite(_inbPin, _speed <= 0 ? LOW : HIGH);
+  _pwm = _state == BRAKING ? 0 : abs(p);
+}
+
+
+void Wheel::drive() {
+  setPWM(abs(_power));
+}
 
-  if (_debug) {
-    Serial.print(" and speed to ");
-    Serial.println(_speed);
+
+// A request while braking only changes what is driven once the brake is
+// released; the dead time is never cut short.
+boolean Wheel::setDirection(int d) {
+  int dir = d > 0 ? 1 : (d < 0 ? -1 : 0);
+  if (_state == BRAKING) return false;
+  if ((dir > 0 && _dir < 0) || (dir < 0 && _dir > 0)) {
+    brake();
+    return false;
   }
-  setPWM(10 * abs(_speed) + _initoff);
+  _dir = dir;
+  if (dir) _enc.setDirection(dir);             // a single-channel encoder counts the way the wheel is driven
+
+  WHEEL_LOG("Setting direction to %d (ina %c, inb %c)", _dir, _dir >= 0 ? 'L' : 'H', _dir <= 0 ? 'L' : 'H');
+  digitalWrite(_inaPin, _dir >= 0 ? LOW : HIGH);
+  digitalWrite(_inbPin, _dir <= 0 ? LOW : HIGH);
+  return true;
+}
+
+
+void Wheel::brake() {
+  WHEEL_LOG("Braking to prepare for direction change.");
+  _state = BRAKING;
+  _brakeUntil = millis() + ADJ_DELAY;
+  _dir = 0;
+  writePWM(0);
+  digitalWrite(_inaPin, HIGH);
+  digitalWrite(_inbPin, HIGH);
 }
 
 
 void Wheel::setPWM(int pwm) {
+  writePWM(pwm);
+  WHEEL_LOG("Setting PWM to %d", _pwm);
+}
+
+
+void Wheel::writePWM(int pwm) {
   if (pwm < 0) _pwm = 0;
   else if (pwm > 255) _pwm = 255;
   else _pwm = pwm;
-  if (_debug) {
-    Serial.print(_label);
-    Serial.print(" Wheel: ");
-    Serial.print("Setting PWM to ");
-    Serial.println(_pwm);
-  }
   analogWrite(_pwmPin, _pwm);
 }
 
@@ -7,59 +7,103 @@
 #define WHEEL_H_
 
 #include <Arduino.h>
+#include <RunningStats.h>
+#include "encoder.h"
 
 class Wheel {
 
   public:
 
-    Wheel(String label, int pwmPin, int inaPin, int inbPin, int initoff, boolean debug);
+    Wheel(const char* label, int pwmPin, int inaPin, int inbPin, boolean debug);
 
-    Wheel(String label, int pwmPin, int inaPin, int inbPin) : Wheel(label, pwmPin, inaPin, inbPin, 0, false) {}
+    Wheel(const char* label, int pwmPin, int inaPin, int inbPin) : Wheel(label, pwmPin, inaPin, inbPin, false) {}
 
     ~Wheel();
 
-    void tick();                                // call this method from the interrupt handler for the encoder
+    Encoder& encoder() { return _enc; }         // its interrupt handler must call encoder().edge()
 
-    void adjust(int a);                         // used by the WheelMonitor to make minor adjustments to the PWM
+    void tick(unsigned long t);                 // an encoder edge at micros() t, from control()
 
-    void setSpeed(int s);                       // desired speed 0-20, positive forward, negative reverse
+    void control();                             // call this method CONTROL_HZ times a second
 
-    unsigned int avgTickTime();                 // returns the average tick interval using the values in the tick buffer
+    void setPower(int p);                       // open-loop PWM -255 to 255, positive forward, negative reverse
 
-    void setLabel(const String& label) { _label = label; }
-    const String& getLabel() { return _label; }
+    // Signed PWM from a controller outside the wheel (see driver.h), held
+    // until latch() writes it so two wheels can be written together. Like
+    // setPower() a reversal brakes first, and the output is 0 until the
+    // brake is released.
+    void command(int p);
+    void latch() { analogWrite(_pwmPin, _pwm); }
+    int pwm() { return _pwm; }                  // the last PWM, 0-255
+
+    // A change of direction brakes the motor for ADJ_DELAY ms before the new
+    // direction is driven; control() moves the wheel through the states, so
+    // setPower() and command() always return at once.
+    enum State {
+      RUNNING,                                  // driven (or stopped) as last requested
+      BRAKING,                                  // TB6612FNG short brake before a reversal
+      REVERSING                                 // new direction driven, waiting for the first control update
+    };
+
+    State state() { return _state; }
+
+    // Mean of the last TICK_WINDOW tick intervals in microseconds, and the
+    // speed from it; both 0 until the second tick after a stall.
+    unsigned long avgTickTime() { return _tickStats.mean(); }
+    unsigned int tickTPS();
+
+    unsigned int measuredTPS() { return _enc.tps(); }  // ticks per second measured over the last control period
+
+    void setLabel(const char* label) { _label = label; }
+    const char* getLabel() { return _label; }
 
     void setDebug(boolean debug) { _debug = debug; }
     boolean getDebug() { return _debug; }
 
-    void setInitOffset(int initoff) { _initoff = initoff; }
-    int getInitOffset() { return _initoff; }
-
+    // Speed steps for the sketch's buttons; the Driver (driver.h) holds
+    // the speed, TPS_PER_SPEED ticks per second a step
     static const int MAX_FWD_SPEED = 25;
     static const int MAX_REV_SPEED = -25;
 
-  private:
+    static const int TPS_PER_SPEED = 30;
+    static const unsigned long ADJ_DELAY = 200UL;      // milliseconds of braking before a reversal
+    static const unsigned long STALL_US = 250000UL;    // no tick for this long and the wheel is stopped
+    static const unsigned int REVERSE_TPS = 100;       // command() reverses a wheel slower than this without braking
 
-    static const int TBSZ = 5;                  // tick buffer size
+  private:
 
-    volatile unsigned long _tickBuf[TBSZ];      // tick buffer -- array containing the last several tick intervals
+    static const uint8_t TICK_WINDOW = 8;       // tick intervals averaged, power of two
 
+    RunningStats<unsigned long, TICK_WINDOW> _tickStats;   // intervals under STALL_US, median of 3
     unsigned long _lastTickTime;                // the last time the tick() method was called. Used to calculate the tick interval
-    unsigned long _nextAdjTime;                 // the millis() value when PWM can be adjusted again after an adjustment is made
+    boolean _ticking;                           // _lastTickTime is a tick within STALL_US of the next
+
+    Encoder _enc;
 
-    int _tbix;                                  // tick buffer index -- the element where the next tick interval will be stored
     int _pwmPin;                                // arduino pin# connected to the TB6612FNG Motor Controller PWM pin to control speed
     int _inaPin;                                // arduino pin# connected to the TB6612FNG Motor Controller INA pin
     int _inbPin;                                // arduino pin# connected to the TB6612FNG Motor Controller INB pin
-    int _speed;                                 // requested speed 0-25, positive for forward, negative for reverse
+    int _dir;                                   // direction the motor is driven: 1 forward, -1 reverse, 0 stopped
+    int _power;                                 // requested PWM, positive for forward, negative for reverse
+    State _state;
+    unsigned long _brakeUntil;                  // the millis() value when braking ends
     int _pwm;                                   // the current PWM value
-    int _initoff;                               // manual PWM adjustment to help account for differences in the motors
 
-    String _label;                              // the name of this wheel (left, right, etc)
+    const char* _label;                         // the name of this wheel (left, right, etc), not copied
 
     boolean _debug;
 
     void setPWM(int pwm);
+
+    void writePWM(int pwm);                     // setPWM() without the debug record, for the control loop
+
+    void measure();                             // takes the encoder edges since the last control update
+
+    boolean setDirection(int d);                // sets the INA/INB pins for the sign of d, false if it has to brake first
+
+    void drive();                               // applies the requested power in the current direction
+
+    void brake();
 };
 
 #endif
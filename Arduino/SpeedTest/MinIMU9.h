@@ -11,6 +11,11 @@
 #include <LSM6.h>
 #include <LIS3MDL.h>
 
+// Keeps the compiler from moving memory accesses across this point
+#ifndef memoryBarrier
+#define memoryBarrier() __asm__ __volatile__("" ::: "memory")
+#endif
+
 
 struct Xyz {
   int x;
@@ -25,26 +30,103 @@ struct Readings {
   Xyz a;
   Xyz g;
   Xyz m;
+  uint64_t t;                                   // LSM6 hardware time of a and g in us, 0 if unknown
 
-  Readings(Xyz _a, Xyz _g, Xyz _m) : a(_a), g(_g), m(_m) { }
-  Readings(int ax, int ay, int az, int gx, int gy, int gz, int mx, int my, int mz) : 
-    a(Xyz(ax, ay, az)), g(Xyz(gx, gy, gz)), m(Xyz(mx, my, mz)) { }
+  Readings(Xyz _a, Xyz _g, Xyz _m, uint64_t _t = 0) : a(_a), g(_g), m(_m), t(_t) { }
+  Readings(int ax, int ay, int az, int gx, int gy, int gz, int mx, int my, int mz, uint64_t _t = 0) : 
+    a(Xyz(ax, ay, az)), g(Xyz(gx, gy, gz)), m(Xyz(mx, my, mz)), t(_t) { }
 };
 
 const int DEFAULT_SENSOR_SIGNS[] = {1, 1, 1, 1, 1, 1, 1, 1, 1};
 
 
+// Sources of the data-ready events MinIMU9::service() returns
+#define IMU_EVENT_NONE  0
+#define IMU_EVENT_IMU   1       // new LSM6 sample, read into Readings a, g and t
+#define IMU_EVENT_MAG   2       // new LIS3MDL sample, read into Readings m
+
+#define IMU_EVENT_QUEUE_SIZE 8  // power of two
+
+
+struct ImuEvent {
+  uint8_t source;               // IMU_EVENT_*
+  uint32_t micros;              // micros() at the data-ready edge
+};
+
+
+// Single-producer/single-consumer ring of data-ready events. The pin
+// interrupts push and loop() pops. Both pin handlers are producers, but AVR
+// handlers do not nest, so only one of them runs at a time. Each index is a
+// single byte written by only one side, so loads and stores of it are
+// atomic on the AVR.
+template <uint8_t SIZE>
+class ImuEventQueue {
+
+  public:
+
+    ImuEventQueue() : _head(0), _tail(0), _overflows(0) {}
+
+    // Producer side (ISR)
+    void push(uint8_t source, uint32_t t) {
+      uint8_t h = _head;
+      if ((uint8_t)(h - _tail) >= SIZE) {
+        _overflows++;
+        return;
+      }
+      _buf[h & MASK].source = source;
+      _buf[h & MASK].micros = t;
+      memoryBarrier();
+      _head = h + 1;
+    }
+
+    // Consumer side (loop). Returns false if the queue is empty.
+    boolean pop(ImuEvent& e) {
+      uint8_t t = _tail;
+      if (t == _head) return false;
+      memoryBarrier();
+      e = _buf[t & MASK];
+      memoryBarrier();
+      _tail = t + 1;
+      return true;
+    }
+
+    boolean empty() { return _head == _tail; }
+
+    uint16_t overflows() {
+      uint16_t a, b;
+      do {
+        a = _overflows;
+        b = _overflows;
+      } while (a != b);
+      return a;
+    }
+
+  private:
+
+    static_assert(SIZE <= 128 && (SIZE & (SIZE - 1)) == 0, "ImuEventQueue SIZE must be a power of two <= 128");
+
+    static const uint8_t MASK = SIZE - 1;
+
+    ImuEvent _buf[SIZE];
+
+    volatile uint8_t _head;
+    volatile uint8_t _tail;
+    volatile uint16_t _overflows;
+};
+
+
 class MinIMU9 {
 
   public:
 
-    MinIMU9(const int sensorSigns[]) : _ok(false), _ss(sensorSigns) { }
+    MinIMU9(const int sensorSigns[]) : _ok(false), _ss(sensorSigns), _imuPin(0), _magPin(0), _attached(false) { }
     MinIMU9() : MinIMU9(DEFAULT_SENSOR_SIGNS) { }
 
     boolean setup() {
       _ok = _imu.init() && _mag.init();
       if (_ok) {
         _imu.enableDefault();
+        _imu.enableTimestamp();
         _mag.enableDefault();
       }
       return _ok;
@@ -69,9 +151,75 @@ class MinIMU9 {
       _imu.read();
       _mag.read();
       return Readings(
-        _imu.a.x * _ss[0], _imu.a.y * _ss[1], _imu.a.z * _ss[1],
+        _imu.a.x * _ss[0], _imu.a.y * _ss[1], _imu.a.z * _ss[2],
         _imu.g.x * _ss[3], _imu.g.y * _ss[4], _imu.g.z * _ss[5],
-        _mag.m.x * _ss[6], _mag.m.y * _ss[7], _mag.m.z * _ss[8]);
+        _mag.m.x * _ss[6], _mag.m.y * _ss[7], _mag.m.z * _ss[8],
+        _imu.timestamp);
+    }
+
+    // Interrupt-driven acquisition: the LSM6 INT1 pin (data ready) and the
+    // LIS3MDL DRDY pin each raise an MCU interrupt on their rising edge, and
+    // the handler only queues the event with its micros() time. Nothing polls and nothing is read until
+    // a sensor has a new sample, so the sample rate follows the sensors'
+    // ODR instead of the speed of loop(). DRDY needs no setup on the
+    // LIS3MDL; its INT pin (INT_CFG) is the threshold interrupt and is not
+    // used.
+    //
+    // The stock Wire library blocks and needs interrupts enabled, so the
+    // reads themselves are made by service() from loop(). Returns false if
+    // the IMU is not set up or a pin has no external interrupt.
+    boolean attachInterrupts(uint8_t imuPin, uint8_t magPin) {
+      int imuIrq = digitalPinToInterrupt(imuPin);
+      int magIrq = digitalPinToInterrupt(magPin);
+      if (!_ok || imuIrq == NOT_AN_INTERRUPT || magIrq == NOT_AN_INTERRUPT) return false;
+      instance() = this;
+      _imuPin = imuPin;
+      _magPin = magPin;
+      pinMode(imuPin, INPUT);
+      pinMode(magPin, INPUT);
+      _imu.enableDataReadyInterrupt();
+      attachInterrupt(imuIrq, imuReady, RISING);
+      attachInterrupt(magIrq, magReady, RISING);
+      _attached = true;
+      // both lines are latched: one already high gives no edge until read
+      _imu.read();
+      _mag.read();
+      return true;
+    }
+
+    void detachInterrupts() {
+      if (!_attached) return;
+      detachInterrupt(digitalPinToInterrupt(_imuPin));
+      detachInterrupt(digitalPinToInterrupt(_magPin));
+      _imu.disableInterrupts();
+      _attached = false;
+    }
+
+    // Takes the next queued data-ready event and reads the sensor that
+    // raised it into r, signs applied; only that sensor's fields change.
+    // Returns an IMU_EVENT_NONE event when nothing is waiting.
+    ImuEvent service(Readings& r) {
+      ImuEvent e;
+      if (!_events.pop(e)) {
+        e.source = IMU_EVENT_NONE;
+        e.micros = 0;
+        return e;
+      }
+      if (e.source == IMU_EVENT_IMU) {
+        _imu.read();
+        r.a = Xyz(_imu.a.x * _ss[0], _imu.a.y * _ss[1], _imu.a.z * _ss[2]);
+        r.g = Xyz(_imu.g.x * _ss[3], _imu.g.y * _ss[4], _imu.g.z * _ss[5]);
+        r.t = _imu.timestamp;
+      } else if (e.source == IMU_EVENT_MAG) {
+        _mag.read();
+        r.m = Xyz(_mag.m.x * _ss[6], _mag.m.y * _ss[7], _mag.m.z * _ss[8]);
+      }
+      return e;
+    }
+
+    // Events dropped because loop() fell IMU_EVENT_QUEUE_SIZE behind
+    uint16_t eventOverflows() {
+      return _events.overflows();
     }
 
     boolean ok() {
@@ -80,10 +228,29 @@ class MinIMU9 {
 
 private:
 
+    // The pin handlers have no object of their own; there is one IMU.
+    static MinIMU9*& instance() {
+      static MinIMU9* imu = 0;
+      return imu;
+    }
+
+    static void imuReady() {
+      instance()->_events.push(IMU_EVENT_IMU, micros());
+    }
+
+    static void magReady() {
+      instance()->_events.push(IMU_EVENT_MAG, micros());
+    }
+
     boolean _ok;
     LSM6 _imu;
     LIS3MDL _mag;
     const int* _ss;
+
+    uint8_t _imuPin;
+    uint8_t _magPin;
+    boolean _attached;
+    ImuEventQueue<IMU_EVENT_QUEUE_SIZE> _events;
 };
 
 #endif
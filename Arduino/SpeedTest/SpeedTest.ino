@@ -20,6 +20,8 @@ const int TEST_BTN        = 53;
 const int PLUS_BTN        = A6;
 const int MINUS_BTN       = A7;
 const int PIEZO           = 45;
+const int IMU_INT1        = 18;   // LSM6 INT1 on INT3
+const int MAG_DRDY        = 19;   // LIS3MDL DRDY on INT2
 
 const unsigned long DEBOUNCE_DELAY = 300UL;       // milliseconds
 const unsigned long SENSOR_REPORT_FREQ = 1000UL;  // milliseconds
@@ -37,6 +39,7 @@ Wheel* leftWheel;
 Wheel* rightWheel;
 
 MinIMU9 imu;
+Readings readings(0, 0, 0, 0, 0, 0, 0, 0, 0);
 
 void setup() {
   Serial.begin(9600);
@@ -45,6 +48,8 @@ void setup() {
 
   if (!imu.setup())
     Serial.println("Failed to setup IMU!");
+  else if (!imu.attachInterrupts(IMU_INT1, MAG_DRDY))
+    Serial.println("Failed to attach IMU interrupts!");
 
   leftWheel = new Wheel("Left", LEFT_MOTOR_PWM, LEFT_MOTOR_DIR, WHEEL_DEBUG);
   rightWheel = new Wheel("Right", RIGHT_MOTOR_PWM, RIGHT_MOTOR_DIR, WHEEL_DEBUG);
@@ -98,13 +103,15 @@ void loop() {
     }
   }
 
+  // collect the samples the data-ready interrupts queued; report the latest
+  while (imu.ok() && imu.service(readings).source != IMU_EVENT_NONE) { }
+
   if (imu.ok() && m >= nextSensorTime) {
     nextSensorTime = m + SENSOR_REPORT_FREQ;
-    Readings r = imu.readAll();
     snprintf(sbuf, sizeof(sbuf), "A: %6d %6d %6d   G: %6d %6d %6d   M: %6d %6d %6d",
-      r.a.x, r.a.y, r.a.z,
-      r.g.x, r.g.y, r.g.z,
-      r.m.x, r.m.y, r.m.z);
+      readings.a.x, readings.a.y, readings.a.z,
+      readings.g.x, readings.g.y, readings.g.z,
+      readings.m.x, readings.m.y, readings.m.z);
     Serial.println(sbuf);
   }
 
@@ -12,8 +12,12 @@ const int REVERSE = HIGH;
 
 const unsigned long ADJ_DELAY = 200L;
 
+// Speed controller gains, Q8 (see SpeedController.h)
+const int16_t KP = 128;                         // 0.5 PWM per tick/s of error
+const int16_t KI = 24;                          // 0.094 PWM per tick/s of error per update
+
 const unsigned int TTT[] = {
-  -1, 30000, 25000, 20000, 17500, 15250, 13000, 11500, 10500, 9500, 
+  0xFFFF, 30000, 25000, 20000, 17500, 15250, 13000, 11500, 10500, 9500, 
   8800, 8000, 7500, 7000, 6700, 6400, 6200, 6000, 5750, 5500, 5300
 };
 
@@ -23,9 +27,15 @@ const int INIT_PWM[] = {
 };
 
 Wheel::Wheel(String label, int pwmPin, int dirPin, boolean debug) : 
+  _tickStats(true),
   _lastTickTime(0L),
+  _ticking(false),
+  _ticks(0),
   _nextAdjTime(0L),
-  _tbix(0),
+  _ctlTicks(0),
+  _ctlEdge(0L),
+  _tps(0),
+  _ctrl(KP, KI),
   _pwmPin(pwmPin), 
   _dirPin(dirPin), 
   _speed(0),
@@ -39,7 +49,6 @@ Wheel::Wheel(String label, int pwmPin, int dirPin, boolean debug) :
   if (_debug) Serial.print(pwmPin);
   if (_debug) Serial.print(", dirPin=");
   if (_debug) Serial.println(dirPin);
-  for (int i = 0; i < TBSZ; i++) _tickBuf[i] = 0L;
   pinMode(_pwmPin, OUTPUT);
   pinMode(_dirPin, OUTPUT);
   analogWrite(_pwmPin, 0);
@@ -53,54 +62,79 @@ Wheel::~Wheel() {
 }
 
 
+// Runs the speed controller every CONTROL_PERIOD ms while a speed is set,
+// with the INIT_PWM entry for the speed as feed-forward and the TTT entry
+// as the target.
 void Wheel::loop(unsigned long m) {
-  if (_speed && m > _nextAdjTime) {
-    unsigned int targetTickTime = TTT[abs(_speed)];
-    unsigned int tickTime = avgTickTime();
-    if (tickTime > 0) {
-      if (tickTime < targetTickTime) {
-        _pwm--;
-        if (_debug) Serial.print(_label);
-        if (_debug) Serial.print(" Wheel: ");
-        if (_debug) Serial.print("tickTime (");
-        if (_debug) Serial.print(tickTime);
-        if (_debug) Serial.print(") is less than target (");
-        if (_debug) Serial.print(targetTickTime);
-        if (_debug) Serial.print(") decreasing PWM to ");
-        if (_debug) Serial.println(_pwm);
-        setPWM(_pwm);
-      } else if (tickTime > targetTickTime) {
-        _pwm++;
-        if (_debug) Serial.print(_label);
-        if (_debug) Serial.print(" Wheel: ");
-        if (_debug) Serial.print("tickTime (");
-        if (_debug) Serial.print(tickTime);
-        if (_debug) Serial.print(") is greater than target (");
-        if (_debug) Serial.print(targetTickTime);
-        if (_debug) Serial.print(") increasing PWM to ");
-        if (_debug) Serial.println(_pwm);
-        setPWM(_pwm);
-      }
-    }
-    _nextAdjTime = m + ADJ_DELAY; 
+  if ((long)(m - _nextAdjTime) < 0) return;
+  _nextAdjTime += CONTROL_PERIOD;
+  if ((long)(m - _nextAdjTime) >= 0) _nextAdjTime = m + CONTROL_PERIOD;
+
+  measure();
+  if (_speed) setPWM(_ctrl.update(targetTPS(), _tps, INIT_PWM[abs(_speed)]));
+}
+
+
+// Average speed over the whole ticks seen since the last update; with no
+// new tick the speed is at most one tick over the time since the last one.
+void Wheel::measure() {
+  noInterrupts();
+  unsigned int ticks = _ticks;
+  unsigned long edge = _lastTickTime;
+  interrupts();
+
+  unsigned int n = ticks - _ctlTicks;
+  if (n > 0) {
+    unsigned long dt = edge - _ctlEdge;
+    _tps = dt > 0 ? (unsigned int)min(1000000UL * n / dt, 65535UL) : 0;
+    _ctlTicks = ticks;
+    _ctlEdge = edge;
+  } else {
+    unsigned long since = micros() - _ctlEdge;
+    unsigned long bound = since > 0 ? 1000000UL / since : 65535UL;
+    if (_tps > bound) _tps = (unsigned int)bound;
   }
 }
 
 
+unsigned int Wheel::targetTPS() {
+  return _speed ? (unsigned int)(1000000UL / TTT[abs(_speed)]) : 0;
+}
+
+
+// An interval as long as the stall timeout is the wheel starting again, and
+// starts a new average rather than joining the old one.
 void Wheel::tick() {
   unsigned long mics = micros();
-  _tickBuf[_tbix] = mics - _lastTickTime;
+  if (_ticking && mics - _lastTickTime < STALL_US) {
+    _tickStats.add(mics - _lastTickTime);
+  } else {
+    _tickStats.reset();
+  }
   _lastTickTime = mics;
-  if (++_tbix >= TBSZ) _tbix = 0;
+  _ticking = true;
+  _ticks++;
 }
 
 
-unsigned int Wheel::avgTickTime() {
-  unsigned long total = 0L;
+// Only the sum and count are read with interrupts off; the divide is after.
+// A wheel that has not ticked for STALL_US reads as stopped even though
+// the window still holds its last intervals; the next tick clears them.
+unsigned long Wheel::avgTickTime() {
   noInterrupts();
-  for (int i = 0; i < TBSZ; i++) total += _tickBuf[i];
+  unsigned long sum = _tickStats.sum();
+  uint8_t n = _tickStats.count();
+  unsigned long last = _lastTickTime;
+  boolean ticking = _ticking;
   interrupts();
-  return (unsigned int)(total / TBSZ);
+  if (!ticking || n == 0 || micros() - last >= STALL_US) return 0;
+  return sum / n;
+}
+
+
+unsigned int Wheel::tickTPS() {
+  unsigned long avg = avgTickTime();
+  return avg ? (unsigned int)min((1000000UL + avg / 2) / avg, 65535UL) : 0;
 }
 
 
@@ -125,6 +159,11 @@ void Wheel::setSpeed(int s) {
   
   if (_debug) Serial.print(" and speed to ");
   if (_debug) Serial.println(_speed);
+  _ctrl.reset();
+  noInterrupts();
+  _ctlTicks = _ticks;
+  interrupts();
+  _ctlEdge = micros();
   setPWM(INIT_PWM[abs(_speed)]);
 }
 
@@ -7,6 +7,8 @@
 #define WHEEL_H_
 
 #include <Arduino.h>
+#include <RunningStats.h>
+#include <SpeedController.h>
 
 class Wheel {
 
@@ -24,23 +26,37 @@ class Wheel {
 
     void setSpeed(int s);                       // desired speed 0-20, positive forward, negative reverse
 
-    unsigned int avgTickTime();                 // returns the average tick interval using the values in the tick buffer
+    // Mean of the last TICK_WINDOW tick intervals in microseconds, and the
+    // speed from it; both 0 until the second tick after a stall.
+    unsigned long avgTickTime();
+    unsigned int tickTPS();
+
+    unsigned int measuredTPS() { return _tps; } // ticks per second measured over the last control period
+    unsigned int targetTPS();                   // ticks per second the controller is holding for the current speed
     
     const String& label() { return _label; }
 
     static const int MAX_FWD_SPEED = 20;
     static const int MAX_REV_SPEED = -20;
 
+    static const unsigned long CONTROL_PERIOD = 20UL;  // milliseconds, 50 Hz
+    static const unsigned long STALL_US = 250000UL;    // no tick for this long and the wheel is stopped
+
   private:
 
-    static const int TBSZ = 5;                  // tick buffer size
+    static const uint8_t TICK_WINDOW = 8;       // tick intervals averaged, power of two
 
-    volatile unsigned long _tickBuf[TBSZ];      // tick buffer -- array containing the last several tick intervals
-    
-    unsigned long _lastTickTime;                // the last time the tick() method was called. Used to calculate the tick interval
-    unsigned long _nextAdjTime;                 // the millis() value when PWM can be adjusted again after an adjustment is made
+    RunningStats<unsigned long, TICK_WINDOW> _tickStats;   // intervals under STALL_US, median of 3; written by tick()
+    volatile unsigned long _lastTickTime;       // the last time the tick() method was called. Used to calculate the tick interval
+    volatile boolean _ticking;                  // _lastTickTime is a tick within STALL_US of the next
+    volatile unsigned int _ticks;               // encoder ticks counted by tick(), wraps
+    unsigned long _nextAdjTime;                 // the millis() value when the speed controller runs next
+
+    unsigned int _ctlTicks;                     // _ticks at the last control update
+    unsigned long _ctlEdge;                     // _lastTickTime at the last control update
+    unsigned int _tps;                          // measured ticks per second
+    SpeedController _ctrl;
 
-    int _tbix;                                  // tick buffer index -- the element where the next tick interval will be stored
     int _pwmPin;                                // arduino pin# connected to the DRV8835 Enable pin to control speed with PWM
     int _dirPin;                                // arduino pin# connected to the DRV8835 Phase pin to control forward/reverse
     int _speed;                                 // requested speed 0-20, positive for forward, negative for reverse
@@ -51,6 +67,8 @@ class Wheel {
     boolean _debug;
 
     void setPWM(int pwm);
+
+    void measure();                             // updates _tps from the ticks since the last control update
 };
 
 #endif
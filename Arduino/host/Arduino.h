@@ -0,0 +1,220 @@
+// Arduino.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Host (Linux, g++/clang) stand-in for the Arduino core. Time, pins,
+// interrupts, tone() and Serial are routed to the simulator (sim.h) so the
+// sketches build unmodified and run much faster than real time.
+//
+// Types follow the AVR target where it matters: millis()/micros() wrap at
+// 32 bits and Serial output is paced at the configured baud rate.
+
+#ifndef ARDUINO_H_
+#define ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+#include "binary.h"
+
+#define HOST_SIM        1
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef uint16_t word;
+
+#define HIGH            0x1
+#define LOW             0x0
+
+#define INPUT           0x0
+#define OUTPUT          0x1
+#define INPUT_PULLUP    0x2
+
+#define CHANGE          1
+#define FALLING         2
+#define RISING          3
+
+#define NOT_AN_INTERRUPT -1
+
+#define DEC             10
+#define HEX             16
+#define OCT             8
+#define BIN             2
+
+#define PI              3.1415926535897932384626433832795
+
+#define LED_BUILTIN     13
+
+#define A0              14
+#define A1              15
+#define A2              16
+#define A3              17
+#define A4              18
+#define A5              19
+#define A6              20
+#define A7              21
+
+#define NUM_DIGITAL_PINS 70
+
+// Flash access collapses to plain memory on the host.
+#define PROGMEM
+#define PSTR(s)             (s)
+#define pgm_read_byte(p)    (*(const uint8_t*)(p))
+#define pgm_read_word(p)    (*(const uint16_t*)(p))
+#define pgm_read_dword(p)   (*(const uint32_t*)(p))
+#define pgm_read_ptr(p)     (*(void* const*)(p))
+#define memcpy_P            memcpy
+#define strlen_P            strlen
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+// Keeps the compiler from moving memory accesses across this point. Shared
+// state between the sketch and its ISRs is exercised from real threads in
+// some simulations, so the host needs a full fence.
+#define memoryBarrier() __sync_synchronize()
+
+// AVR timer registers touched by the sketches. They have no effect on the
+// host other than holding their value.
+extern volatile uint8_t TCCR1B;
+
+// The AVR status register, for the save/cli()/restore idiom. Only the global
+// interrupt enable (bit 7) is modeled; it follows noInterrupts() and
+// interrupts(), and is clear inside a handler.
+class HostSREG {
+
+  public:
+
+    operator uint8_t() const;
+    HostSREG& operator=(uint8_t v);
+};
+
+extern HostSREG SREG;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+uint32_t hostNanos();                           // host only: a real-time clock for profiling, wraps
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+int analogRead(uint8_t pin);
+
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t interruptNum, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+void noInterrupts();
+void interrupts();
+inline void cli() { noInterrupts(); }
+inline void sei() { interrupts(); }
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+template <typename T, typename U> inline T min(T a, U b) { return (b < a) ? b : a; }
+template <typename T, typename U> inline T max(T a, U b) { return (a < b) ? b : a; }
+template <typename T, typename U, typename V> inline T constrain(T x, U lo, V hi) {
+  return x < lo ? lo : (x > hi ? hi : x);
+}
+
+
+class String {
+
+  public:
+
+    String(const char* s = "") : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    String(char c) : _s(1, c) {}
+    String(int v) : _s(std::to_string(v)) {}
+    String(unsigned int v) : _s(std::to_string(v)) {}
+    String(long v) : _s(std::to_string(v)) {}
+    String(unsigned long v) : _s(std::to_string(v)) {}
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.length(); }
+
+    String& operator+=(const String& rhs) { _s += rhs._s; return *this; }
+    friend String operator+(const String& lhs, const String& rhs) { return String(lhs._s + rhs._s); }
+
+    bool operator==(const String& rhs) const { return _s == rhs._s; }
+    bool operator!=(const String& rhs) const { return _s != rhs._s; }
+
+  private:
+
+    std::string _s;
+};
+
+
+class Print {
+
+  public:
+
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t n);
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+
+    size_t print(const __FlashStringHelper* s);
+    size_t print(const String& s);
+    size_t print(const char* s);
+    size_t print(char c);
+    size_t print(unsigned char n, int base = DEC);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println(const __FlashStringHelper* s);
+    size_t println(const String& s);
+    size_t println(const char* s);
+    size_t println(char c);
+    size_t println(unsigned char n, int base = DEC);
+    size_t println(int n, int base = DEC);
+    size_t println(unsigned int n, int base = DEC);
+    size_t println(long n, int base = DEC);
+    size_t println(unsigned long n, int base = DEC);
+    size_t println(double n, int digits = 2);
+    size_t println();
+
+  private:
+
+    size_t printNumber(unsigned long n, int base);
+};
+
+
+class HardwareSerial : public Print {
+
+  public:
+
+    HardwareSerial() : _baud(0) {}
+
+    void begin(unsigned long baud) { _baud = baud; }
+    void end() { _baud = 0; }
+    int availableForWrite();
+    void flush();
+    size_t write(uint8_t c);
+    using Print::write;
+
+    int available() { return 0; }
+    int read() { return -1; }
+
+    operator bool() { return true; }
+
+  private:
+
+    unsigned long _baud;
+};
+
+extern HardwareSerial Serial;
+
+#endif // ARDUINO_H_
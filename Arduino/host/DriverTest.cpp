@@ -0,0 +1,234 @@
+// DriverTest.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Drives two mismatched simulated motors -- the right one weaker, slower
+// to respond and with a higher dead band -- as the wheels of a Driver
+// (driver.h) run at CONTROL_HZ. The encoders are quadrature: a single
+// channel counts the wrong way while a wheel coasts on through a reversal,
+// which no controller can see. The schedule is a ramp to a fast straight,
+// a bump that holds the right wheel back for BUMP_MS, an arc, a spin and a
+// stop. It is run twice: with the cross-coupling and without it.
+//
+// The heading error is the difference between the edges the wheels have
+// moved and what the setpoints asked of them, so it is zero however the
+// robot turns as long as it turns as commanded.
+//
+// Checks, exiting non-zero on any failure:
+//   - the setpoint never changes faster than the acceleration limits, nor
+//     its acceleration faster than the jerk limits
+//   - each wheel's speed at the end of the straight and the arc within
+//     SPEED_ERROR of its setpoint, with no more than OVERSHOOT over it and
+//     a peak to peak under RIPPLE once settled
+//   - the heading error within HEADING_DEG through the straight, the arc
+//     and the spin, and through the bump within BUMP_HEADING_DEG and less
+//     than a third of what it is without the coupling
+//   - the wheels still within STALL_US of the setpoint reaching 0
+//
+// Usage: DriverTest [-v]
+//
+//   -v   print every control update
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "config.h"
+#include "wheel.h"
+#include "driver.h"
+
+namespace {
+
+const double SPEED_ERROR = 0.02;                // of the setpoint, at the end of a steady stretch
+const double OVERSHOOT = 0.05;
+const double RIPPLE = 0.04;                     // peak to peak over the settled stretch, of the setpoint
+const double HEADING_DEG = 1.5;                 // an edge of difference is 0.44 deg
+const double BUMP_HEADING_DEG = 4.0;
+const int BUMP_MS = 300;
+const double BUMP_GAIN = 0.6;                   // of the right motor's speed while it is held back
+
+struct Stretch {
+  const char* name;
+  double seconds;
+  int16_t velocity, yawRate;                    // mm/s, mrad/s
+  bool steady;                                  // settles: check the speeds at its end
+  bool bump;
+};
+
+const Stretch SCHEDULE[] = {
+  { "straight", 2.5, 900, 0, true, false },
+  { "bump", 1.5, 900, 0, false, true },
+  { "arc", 2.0, 400, 1500, true, false },
+  { "spin", 1.5, 0, -4000, false, false },
+  { "stop", 1.0, 0, 0, false, false },
+};
+const int STRETCHES = sizeof(SCHEDULE) / sizeof(SCHEDULE[0]);
+
+struct Result {
+  double heading[STRETCHES];                    // peak |heading error|, deg
+  double speedError, overshoot, ripple;         // worst over the steady stretches, of the setpoint
+  double rampExcess;                            // worst setpoint step over the limit, Q8
+  double jerkExcess;                            // worst acceleration step over the limit, per s/s
+  double stopMs;                                // from the setpoint reaching 0 to both wheels still
+};
+
+Wheel* leftWheel;
+Wheel* rightWheel;
+
+void leftEdge() { leftWheel->encoder().edge(); }
+void rightEdge() { rightWheel->encoder().edge(); }
+
+bool check(bool ok, const char* what) {
+  if (!ok) printf("FAIL: %s\n", what);
+  return ok;
+}
+
+double headingDeg(double edges) { return edges / TICKS_PER_METRE / (WHEEL_BASE_MM / 1000.0) * 180 / M_PI; }
+
+Result run(Driver& driver, sim::Motor& lm, sim::Motor& rm, bool verbose) {
+  Result r;
+  memset(&r, 0, sizeof(r));
+  const uint64_t periodUs = 1000000UL / CONTROL_HZ;
+  const double rightGain = rm.params().gain;
+  double expected = rm.position() - lm.position();   // edges the right wheel should be ahead by
+  int32_t lastV = driver.velocity() << 8, lastW = driver.yawRate() << 8;
+  int lastA = driver.acceleration(), lastWa = driver.yawAcceleration();
+  double zeroAt = -1;
+
+  for (int i = 0; i < STRETCHES; i++) {
+    const Stretch& s = SCHEDULE[i];
+    driver.move(s.velocity, s.yawRate);
+    uint64_t start = sim::now();
+    uint64_t end = start + (uint64_t)(s.seconds * 1e6);
+    double lo[2] = { 1e9, 1e9 }, hi[2] = { -1e9, -1e9 };
+    while (sim::now() < end) {
+      uint64_t t = sim::now() - start;
+      rm.params().gain = s.bump && t < BUMP_MS * 1000UL ? rightGain * BUMP_GAIN : rightGain;
+      sim::advance(periodUs);
+      driver.control();
+
+      double vStep = fabs((driver.velocity() << 8) - (double)lastV) - DRIVE_ACCEL * 256.0 / CONTROL_HZ;
+      double wStep = fabs((driver.yawRate() << 8) - (double)lastW) - DRIVE_YAW_ACCEL * 256.0 / CONTROL_HZ;
+      r.rampExcess = std::max(r.rampExcess, std::max(vStep, wStep) / 256.0);
+      lastV = driver.velocity() << 8;
+      lastW = driver.yawRate() << 8;
+      double aStep = abs(driver.acceleration() - lastA) - (double)DRIVE_JERK / CONTROL_HZ;
+      double waStep = abs(driver.yawAcceleration() - lastWa) - (double)DRIVE_YAW_JERK / CONTROL_HZ;
+      r.jerkExcess = std::max(r.jerkExcess, std::max(aStep, waStep));
+      lastA = driver.acceleration();
+      lastWa = driver.yawAcceleration();
+
+      expected += (driver.rightTPS() - driver.leftTPS()) * (periodUs / 1e6);
+      double err = headingDeg(rm.position() - lm.position() - expected);
+      r.heading[i] = std::max(r.heading[i], fabs(err));
+
+      // the last second of a steady stretch has settled
+      double speed[2] = { lm.speed(), rm.speed() };
+      int32_t target[2] = { driver.leftTPS(), driver.rightTPS() };
+      if (s.steady && end - sim::now() < 1000000ULL) {
+        for (int w = 0; w < 2; w++) {
+          lo[w] = std::min(lo[w], speed[w]);
+          hi[w] = std::max(hi[w], speed[w]);
+          r.overshoot = std::max(r.overshoot, (fabs(speed[w]) - abs(target[w])) / abs(target[w]));
+        }
+      }
+      if (!strcmp(s.name, "stop")) {
+        if (zeroAt < 0 && driver.velocity() == 0 && driver.yawRate() == 0) zeroAt = sim::now();
+        if (zeroAt >= 0 && r.stopMs == 0 && fabs(lm.speed()) < 1 && fabs(rm.speed()) < 1) {
+          r.stopMs = (sim::now() - zeroAt) / 1e3;
+        }
+      }
+
+      if (verbose) {
+        printf("%8.3f %-8s set %5d mm/s %6d mrad/s | L %5d %7.1f lag %5.2f pwm %3d | R %5d %7.1f lag %5.2f pwm %3d | "
+               "heading %6.2f\n", sim::now() / 1e6, s.name, driver.velocity(), driver.yawRate(), target[0], speed[0],
+               driver.leftLag() / 256.0, leftWheel->pwm(), target[1], speed[1], driver.rightLag() / 256.0,
+               rightWheel->pwm(), err);
+      }
+    }
+
+    if (s.steady) {
+      int32_t target[2] = { driver.leftTPS(), driver.rightTPS() };
+      double speed[2] = { lm.speed(), rm.speed() };
+      for (int w = 0; w < 2; w++) {
+        r.speedError = std::max(r.speedError, fabs(speed[w] - target[w]) / abs(target[w]));
+        r.ripple = std::max(r.ripple, (hi[w] - lo[w]) / abs(target[w]));
+      }
+    }
+  }
+  rm.params().gain = rightGain;
+  return r;
+}
+
+void report(const char* name, const Result& r) {
+  printf("%-10s heading error", name);
+  for (int i = 0; i < STRETCHES; i++) printf(" %s %.2f", SCHEDULE[i].name, r.heading[i]);
+  printf(" deg\n           speed error %.2f%%, overshoot %.2f%%, ripple %.2f%%, stopped %.0f ms after the setpoint\n",
+         100 * r.speedError, 100 * std::max(0.0, r.overshoot), 100 * r.ripple, r.stopMs);
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  bool verbose = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-v")) verbose = true;
+    else {
+      fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+      exit(2);
+    }
+  }
+
+  sim::MotorParams leftParams, rightParams;
+  rightParams.gain = 0.9;
+  rightParams.deadband = 48;
+  rightParams.tauMs = 100;
+  sim::Motor& lm = sim::addMotor("Left", LEFT_PWM, LEFT_DIR1, LEFT_DIR2, LEFT_ENC, leftParams);
+  sim::Motor& rm = sim::addMotor("Right", RIGHT_PWM, RIGHT_DIR1, RIGHT_DIR2, RIGHT_ENC, rightParams);
+  lm.setQuadrature(LEFT_ENC_B);
+  rm.setQuadrature(RIGHT_ENC_B);
+
+  leftWheel = new Wheel("Left", LEFT_PWM, LEFT_DIR1, LEFT_DIR2);
+  rightWheel = new Wheel("Right", RIGHT_PWM, RIGHT_DIR1, RIGHT_DIR2);
+  leftWheel->encoder().begin(LEFT_ENC, LEFT_ENC_B, leftEdge);
+  rightWheel->encoder().begin(RIGHT_ENC, RIGHT_ENC_B, rightEdge);
+  Driver driver(leftWheel, rightWheel);
+
+  int16_t kc = driver.coupling();
+  driver.setCoupling(0);
+  Result uncoupled = run(driver, lm, rm, verbose);
+  driver.release();
+  sim::advance(500000);
+  driver.setCoupling(kc);
+  Result coupled = run(driver, lm, rm, verbose);
+
+  report("uncoupled", uncoupled);
+  report("coupled", coupled);
+
+  bool ok = true;
+  const Result& r = coupled;
+  ok &= check(r.rampExcess <= 1.0 / 256, "setpoint within the acceleration limits");
+  ok &= check(r.jerkExcess <= 1, "acceleration within the jerk limits");
+  ok &= check(r.speedError <= SPEED_ERROR, "steady wheel speeds");
+  ok &= check(r.overshoot <= OVERSHOOT, "overshoot");
+  ok &= check(r.ripple <= RIPPLE, "ripple once settled");
+  for (int i = 0; i < STRETCHES; i++) {
+    if (SCHEDULE[i].bump) {
+      ok &= check(r.heading[i] <= BUMP_HEADING_DEG, "heading through the bump");
+      ok &= check(r.heading[i] < uncoupled.heading[i] / 3, "coupling cuts the heading error through the bump");
+    } else {
+      ok &= check(r.heading[i] <= HEADING_DEG, SCHEDULE[i].name);
+    }
+  }
+  double rampMs = 1000.0 * std::max(fabs((double)SCHEDULE[STRETCHES - 2].velocity) / DRIVE_ACCEL +
+                                    (double)DRIVE_ACCEL / DRIVE_JERK,
+                                    fabs((double)SCHEDULE[STRETCHES - 2].yawRate) / DRIVE_YAW_ACCEL +
+                                    (double)DRIVE_YAW_ACCEL / DRIVE_YAW_JERK);
+  ok &= check(r.stopMs > 0 && r.stopMs <= Wheel::STALL_US / 1e3, "stopped after the ramp");
+  printf("stop:      setpoint down in %.0f ms, wheels still %.0f ms later\n", rampMs, r.stopMs);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,195 @@
+// EncoderBench.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Runs two simulated motors through the same drive schedule -- a crawl,
+// full speed, straight into reverse, a stop, a slower crawl -- one with a
+// quadrature encoder and one with a single channel, each read by an
+// Encoder (encoder.h) updated at CONTROL_HZ as the control task would.
+//
+// For each steady stretch it reports the mean error of the encoders' speed
+// estimate against the motor's true speed, beside the speed of the last
+// edge interval alone (what the encoder interrupt used to publish). It
+// reports how far each encoder's position gets from the motor's, how long
+// the estimate takes to come down after the stop, and the host cost of the
+// interrupt handlers.
+//
+// Exits non-zero if the quadrature encoder's position is ever off by an
+// edge, if its velocity has the other sign from the edges it counted, if
+// a steady speed estimate is off by more than 2% (or 1 edge/s), or if the
+// estimate is still over MAX_STOPPED_TPS 250 ms after the last edge of the
+// stop.
+//
+// Usage: EncoderBench [-v]
+//
+//   -v   print every control update
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "config.h"
+#include "encoder.h"
+
+namespace {
+
+const uint8_t Q_PWM = 9, Q_INA = 14, Q_INB = 15, Q_ENC_A = 2, Q_ENC_B = 8;
+const uint8_t S_PWM = 10, S_INA = 16, S_INB = 17, S_ENC = 3;
+
+const double MAX_SPEED_ERROR = 0.02;            // of the true speed, or
+const double MIN_SPEED_ERROR_TPS = 1;           // this, if more
+const double STOP_WINDOW_MS = 250;              // from the last edge
+const unsigned MAX_STOPPED_TPS = 5;
+const double STEADY_S = 0.5;                    // the end of each stretch that is compared
+
+struct Stretch {
+  const char* name;
+  double seconds;
+  int drive;                                    // signed PWM, 0 to brake
+};
+
+const Stretch SCHEDULE[] = {
+  { "stopped", 0.5, 0 },
+  { "crawl", 1.5, 48 },
+  { "full speed", 1.5, 255 },
+  { "reverse", 1.5, -150 },
+  { "stop", 1.0, 0 },
+  { "slow crawl", 2.0, 44 },
+};
+
+Encoder quad, single;
+
+void quadEdge() { quad.edge(); }
+void singleEdge() { single.edge(); }
+
+// TB6612FNG: L/H forward, H/L reverse, H/H short brake
+void drive(uint8_t pwmPin, uint8_t inaPin, uint8_t inbPin, int d) {
+  digitalWrite(inaPin, d < 0 || d == 0 ? HIGH : LOW);
+  digitalWrite(inbPin, d > 0 || d == 0 ? HIGH : LOW);
+  analogWrite(pwmPin, abs(d));
+}
+
+// Speed from the last edge interval alone
+struct LastInterval {
+  uint32_t prev, interval;
+
+  void take(Encoder& e) {
+    uint32_t t;
+    while (e.nextEdge(t)) {
+      if (prev) interval = t - prev;
+      prev = t;
+    }
+  }
+
+  double tps() const { return interval ? 1e6 / interval : 0; }
+};
+
+struct Error {
+  double sum, lastSum;
+  unsigned long n;
+
+  void add(double estimate, double truth, double lastEstimate) {
+    sum += fabs(estimate - truth);
+    lastSum += fabs(lastEstimate - truth);
+    n++;
+  }
+};
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  bool verbose = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-v")) verbose = true;
+    else {
+      fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+      exit(2);
+    }
+  }
+
+  sim::Motor& qm = sim::addMotor("quadrature", Q_PWM, Q_INA, Q_INB, Q_ENC_A);
+  sim::Motor& sm = sim::addMotor("single", S_PWM, S_INA, S_INB, S_ENC);
+  qm.setQuadrature(Q_ENC_B);
+  quad.begin(Q_ENC_A, Q_ENC_B, quadEdge);
+  single.begin(S_ENC, Encoder::NO_PIN, singleEdge);
+
+  const uint64_t periodUs = 1000000UL / CONTROL_HZ;
+  LastInterval qLast = { 0, 0 }, sLast = { 0, 0 };
+  bool failed = false;
+  long worstQuad = 0, worstSingle = 0;
+  unsigned long wrongSign = 0;
+  long lastPosition = 0;
+
+  for (const Stretch& s : SCHEDULE) {
+    drive(Q_PWM, Q_INA, Q_INB, s.drive);
+    drive(S_PWM, S_INA, S_INB, s.drive);
+    if (s.drive) single.setDirection(s.drive < 0 ? -1 : 1);
+
+    Error qe = { 0, 0, 0 }, se = { 0, 0, 0 };
+    double stoppedMs = -1;
+    uint64_t start = sim::now(), end = start + (uint64_t)(s.seconds * 1e6);
+    while (sim::now() < end) {
+      sim::advance(periodUs);
+      quad.update();
+      single.update();
+      qLast.take(quad);
+      sLast.take(single);
+
+      long qOff = labs(quad.position() - (long)floor(qm.position()));
+      long sOff = labs(single.position() - (long)floor(sm.position()));
+      if (qOff > worstQuad) worstQuad = qOff;
+      if (sOff > worstSingle) worstSingle = sOff;
+      // a period with no edges keeps the last sign, as the motor reverses say
+      long moved = quad.position() - lastPosition;
+      if (moved && (quad.velocity() > 0) != (moved > 0)) wrongSign++;
+      lastPosition = quad.position();
+
+      if (verbose) {
+        printf("%8.3f %-10s true %7.1f quad %5d (%6d) last %7.1f | true %7.1f single %5d (%6d) last %7.1f\n",
+               sim::now() / 1e6, s.name, qm.speed(), quad.tps(), quad.velocity(), qLast.tps(), sm.speed(),
+               single.tps(), single.velocity(), sLast.tps());
+      }
+
+      double t = (sim::now() - start) / 1e6;
+      if (s.drive && t >= s.seconds - STEADY_S) {
+        qe.add(quad.tps(), fabs(qm.speed()), qLast.tps());
+        se.add(single.tps(), fabs(sm.speed()), sLast.tps());
+      }
+      if (!s.drive && stoppedMs < 0 && quad.tps() <= MAX_STOPPED_TPS && single.tps() <= MAX_STOPPED_TPS) {
+        stoppedMs = (sim::now() - quad.lastEdge()) / 1e3;
+      }
+    }
+
+    if (s.drive) {
+      double truth = fabs(qm.speed());
+      double limit = std::max(MAX_SPEED_ERROR * truth, MIN_SPEED_ERROR_TPS);
+      double q = qe.sum / qe.n, sg = se.sum / se.n;
+      printf("%-10s %7.1f edges/s: estimate off by %.2f (quadrature) and %.2f (single) edges/s,"
+             " last interval %.2f and %.2f\n", s.name, truth, q, sg, qe.lastSum / qe.n, se.lastSum / se.n);
+      if (q > limit || sg > std::max(MAX_SPEED_ERROR * fabs(sm.speed()), MIN_SPEED_ERROR_TPS)) failed = true;
+    } else if (start > 0) {
+      printf("%-10s estimate under %u edges/s %.0f ms after the last edge; last interval still says %.1f and %.1f\n", s.name,
+             MAX_STOPPED_TPS, stoppedMs, qLast.tps(), sLast.tps());
+      if (stoppedMs < 0 || stoppedMs > STOP_WINDOW_MS) failed = true;
+    }
+  }
+
+  printf("position: quadrature at most %ld edges off, single channel %ld (counting the drive direction);"
+         " %lu updates with the wrong sign\n", worstQuad, worstSingle, wrongSign);
+  if (worstQuad || wrongSign) failed = true;
+  printf("edges:    %lu and %lu counted, %llu and %llu produced\n", (unsigned long)quad.edges(),
+         (unsigned long)single.edges(), (unsigned long long)qm.edges(), (unsigned long long)sm.edges());
+  if (quad.edges() != (uint32_t)qm.edges() || single.edges() != (uint32_t)sm.edges()) failed = true;
+
+  for (std::map<std::string, sim::IsrStats>::const_iterator it = sim::isrStats().begin();
+       it != sim::isrStats().end(); ++it) {
+    printf("ISR %-14s %8llu calls, host mean %.0f ns, max %llu ns\n", it->first.c_str(),
+      (unsigned long long)it->second.calls, (double)it->second.totalNs / it->second.calls,
+      (unsigned long long)it->second.maxNs);
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,379 @@
+// FusionBench.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Runs the fixed-point Madgwick and Mahony filters (quaternionFiltersFixed)
+// beside the float ones they were ported from (quaternionFilters) on the
+// same sensor data, and reports how far apart their orientations get and
+// how far each is from the true orientation. The data is either a recorded
+// log (-f) or four generated runs of a MinIMU-9 on the robot: sitting
+// level, driving with turns and bumps, tumbling, and starting tilted 30°
+// so the filters have to converge. The generated sensors have the LSM6's
+// and LIS3MDL's scales, gyro bias and noise.
+//
+// The cost of an update on the AVR is estimated by compiling both filter
+// sources a second time with their types swapped for the counting
+// stand-ins in avr_ops.h and pricing the operations they do; the counted
+// fixed-point filters must also give bit-for-bit the same quaternions as
+// the host build, which they only do if nothing relies on a 32-bit int.
+// The filters run as OrientationFilter objects, several at once: each
+// sample goes to one pair (float and fixed) by itself and to another in
+// bursts, as a FIFO drain would hand them over, and the bursts must land
+// within 0.01° of one at a time for less work per sample. With the
+// default gains the free functions run alongside and must give exactly
+// the objects' results. Mahony also runs with an integral gain.
+//
+// Exits non-zero if the fixed-point filters are less than 4x faster than
+// the float ones, if a fixed-point orientation is ever more than 0.5° from
+// the float one (after the tilted run has converged; at low sample rates,
+// four of Madgwick's fixed-size beta steps if that is more, since near
+// convergence the step's direction is noise the two round differently),
+// if its RMS error against the truth is more than 0.25° worse than
+// float's, if the counted build differs, or if the bursts or the free
+// functions don't hold up.
+//
+// Usage: FusionBench [-f recording] [-t seconds] [-r rate_hz] [-b burst]
+//
+//   -f   replay a recording instead of the generated runs (imu_log.h);
+//        with the truth columns the errors from truth are reported too
+//   -t   length of each generated run (default 30 s)
+//   -r   sample rate of the generated runs (default 416 Hz)
+//   -b   samples per burst update (default 16)
+
+#include <Arduino.h>
+#include <OrientationFilter.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+#include "avr_ops.h"
+#include "imu_log.h"
+
+// The filters again, counting what they do
+namespace countedFloat {
+#undef _QUATERNIONFILTERS_H_
+#define float avr::CountedFloat
+#include "quaternionFilters.cpp"
+#undef float
+}
+
+namespace countedFixed {
+#undef _QUATERNIONFILTERSFIXED_H_
+#define int16_t avr::CountedInt16
+#define uint16_t avr::CountedUint16
+#define int32_t avr::CountedInt32
+#define uint32_t avr::CountedUint32
+#include "quaternionFiltersFixed.cpp"
+#undef int16_t
+#undef uint16_t
+#undef int32_t
+#undef uint32_t
+}
+
+namespace {
+
+const double SETTLE_S = 5;                      // tilted start converging
+
+const double MAX_FIXED_ERROR_DEG = 0.5;         // fixed from float, or
+const double MAX_FIXED_ERROR_STEPS = 4;         // this many Madgwick steps, if more
+const double BETA = 0.6046;                     // quaternionFilters.cpp, rad/s
+const double MAX_TRUTH_LOSS_DEG = 0.25;         // fixed worse than float against truth
+const double MAX_BURST_ERROR_DEG = 0.01;       // bursts from one sample at a time
+const double MIN_SPEEDUP = 4;
+
+using sim::ImuLogSample;
+using sim::ImuLog;
+using sim::quaternionAngleDeg;
+
+int16_t clamp16(double v) {
+  v = floor(v + 0.5);
+  return (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+}
+
+int16_t gyroQ11(double radPerS) {
+  return clamp16(radPerS * QF_GYRO_ONE);
+}
+
+// A sample as the float and fixed-point filters, and their counted builds, take it
+template <typename S>
+S floatSample(const ImuLogSample& s) {
+  S r = { (float)s.a[0], (float)s.a[1], (float)s.a[2], (float)s.g[0], (float)s.g[1], (float)s.g[2],
+          (float)s.m[0], (float)s.m[1], (float)s.m[2], s.dtUs * 1e-6f };
+  return r;
+}
+
+template <typename S>
+S fixedSample(const ImuLogSample& s) {
+  S r = { s.a[0], s.a[1], s.a[2], gyroQ11(s.g[0]), gyroQ11(s.g[1]), gyroQ11(s.g[2]), s.m[0], s.m[1], s.m[2],
+          s.dtUs };
+  return r;
+}
+
+// The counted builds' updates for each algorithm
+template <typename Algorithm> struct Counted;
+
+template <> struct Counted<Madgwick> {
+  static void update(countedFloat::QuaternionFilterState& f, const countedFloat::QuaternionSample* s, size_t n) {
+    countedFloat::MadgwickQuaternionUpdate(f, s, n);
+  }
+  static void update(countedFixed::QuaternionFilterStateFixed& f, const countedFixed::QuaternionSampleFixed* s,
+                     size_t n) {
+    countedFixed::MadgwickQuaternionUpdateFixed(f, s, n);
+  }
+};
+
+template <> struct Counted<Mahony> {
+  static void update(countedFloat::QuaternionFilterState& f, const countedFloat::QuaternionSample* s, size_t n) {
+    countedFloat::MahonyQuaternionUpdate(f, s, n);
+  }
+  static void update(countedFixed::QuaternionFilterStateFixed& f, const countedFixed::QuaternionSampleFixed* s,
+                     size_t n) {
+    countedFixed::MahonyQuaternionUpdateFixed(f, s, n);
+  }
+};
+
+struct CountedFilters {
+  countedFloat::QuaternionFilterState fl;
+  countedFixed::QuaternionFilterStateFixed fx;
+
+  explicit CountedFilters(float ki) {
+    countedFloat::QuaternionFilterInit(fl);
+    countedFixed::QuaternionFilterInitFixed(fx);
+    fl.ki = ki;
+    fx.ki = OrientationFilterTypes<int16_t>::gain(ki, 32768.0f);
+  }
+};
+
+// The filter the free functions share, back to the identity
+void resetShared() {
+  float* q = const_cast<float*>(getQ());
+  int32_t* qf = const_cast<int32_t*>(getQFixed());
+  for (int i = 0; i < 4; i++) {
+    q[i] = i ? 0 : 1;
+    qf[i] = i ? 0 : QF_Q_ONE;
+  }
+}
+
+template <typename T>
+void toDouble(const T* q, double scale, double out[4]) {
+  for (int i = 0; i < 4; i++) out[i] = (double)q[i] / scale;
+}
+
+
+struct Result {
+  double maxDiffDeg, rmsDiffDeg;                // fixed from float
+  double floatTruthDeg, fixedTruthDeg;          // RMS from truth, or -1 with no truth
+  double burstDiffDeg;                          // burst updates from one at a time, float or fixed
+  unsigned long mismatches;                     // counted build differing from the host build
+  unsigned long sharedMismatches;               // free functions differing from an OrientationFilter
+};
+
+template <typename Algorithm>
+Result replay(const ImuLog& run, double settleS, float ki, uint16_t burst) {
+  OrientationFilter<float, Algorithm> fl, flBurst;
+  OrientationFilter<int16_t, Algorithm> fx, fxBurst;
+  fl.setGains(10, ki);
+  flBurst.setGains(10, ki);
+  fx.setGains(10, ki);
+  fxBurst.setGains(10, ki);
+  CountedFilters counted(ki);
+  resetShared();
+  std::vector<QuaternionSample> flBuf;
+  std::vector<QuaternionSampleFixed> fxBuf;
+
+  Result r = { 0, 0, -1, -1, 0, 0, 0 };
+  double sumSq = 0, floatSq = 0, fixedSq = 0, t = 0;
+  unsigned long compared = 0, truths = 0;
+
+  for (const ImuLogSample& s : run) {
+    QuaternionSample fs = floatSample<QuaternionSample>(s);
+    QuaternionSampleFixed xs = fixedSample<QuaternionSampleFixed>(s);
+    fl.update(fs);
+    fx.update(xs);
+    countedFixed::QuaternionSampleFixed cs = fixedSample<countedFixed::QuaternionSampleFixed>(s);
+    Counted<Algorithm>::update(counted.fx, &cs, 1);
+    for (int i = 0; i < 4; i++) {
+      if (counted.fx.q[i].v != fx.getQ()[i]) r.mismatches++;
+    }
+
+    // The free functions are the default gains
+    if (ki == 0) {
+      if (std::is_same<Algorithm, Madgwick>::value) {
+        MadgwickQuaternionUpdate(fs.ax, fs.ay, fs.az, fs.gx, fs.gy, fs.gz, fs.mx, fs.my, fs.mz, fs.deltat);
+        MadgwickQuaternionUpdateFixed(xs.ax, xs.ay, xs.az, xs.gx, xs.gy, xs.gz, xs.mx, xs.my, xs.mz, xs.deltatUs);
+      } else {
+        MahonyQuaternionUpdate(fs.ax, fs.ay, fs.az, fs.gx, fs.gy, fs.gz, fs.mx, fs.my, fs.mz, fs.deltat);
+        MahonyQuaternionUpdateFixed(xs.ax, xs.ay, xs.az, xs.gx, xs.gy, xs.gz, xs.mx, xs.my, xs.mz, xs.deltatUs);
+      }
+      if (memcmp(getQ(), fl.getQ(), 4 * sizeof(float))) r.sharedMismatches++;
+      if (memcmp(getQFixed(), fx.getQ(), 4 * sizeof(int32_t))) r.sharedMismatches++;
+    }
+
+    double fq[4], xq[4];
+    toDouble(fl.getQ(), 1, fq);
+    toDouble(fx.getQ(), QF_Q_ONE, xq);
+    flBuf.push_back(fs);
+    fxBuf.push_back(xs);
+    if (flBuf.size() == burst) {
+      flBurst.update(&flBuf[0], burst);
+      fxBurst.update(&fxBuf[0], burst);
+      flBuf.clear();
+      fxBuf.clear();
+      double bq[4];
+      toDouble(flBurst.getQ(), 1, bq);
+      double d = quaternionAngleDeg(fq, bq);
+      if (d > r.burstDiffDeg || isnan(d)) r.burstDiffDeg = d;
+      toDouble(fxBurst.getQ(), QF_Q_ONE, bq);
+      d = quaternionAngleDeg(xq, bq);
+      if (d > r.burstDiffDeg || isnan(d)) r.burstDiffDeg = d;
+    }
+
+    t += s.dtUs * 1e-6;
+    if (t < settleS) continue;
+
+    double d = quaternionAngleDeg(fq, xq);
+    if (d > r.maxDiffDeg || isnan(d)) r.maxDiffDeg = d;   // the float filter's NaN sticks
+    sumSq += d * d;
+    compared++;
+    if (s.truth[0] != 0) {
+      double ef = quaternionAngleDeg(fq, s.truth), ex = quaternionAngleDeg(xq, s.truth);
+      floatSq += ef * ef;
+      fixedSq += ex * ex;
+      truths++;
+    }
+  }
+  if (compared) r.rmsDiffDeg = sqrt(sumSq / compared);
+  if (truths) {
+    r.floatTruthDeg = sqrt(floatSq / truths);
+    r.fixedTruthDeg = sqrt(fixedSq / truths);
+  }
+  return r;
+}
+
+
+struct Cost {
+  double floatCycles, fixedCycles;              // per update, one sample at a time
+  double floatBurstCycles, fixedBurstCycles;    // per sample, in bursts
+};
+
+// Counted cycles per sample over every run, updating with burst samples at a time
+template <typename Algorithm, typename State, typename S, typename Convert>
+double cycles(const std::vector<ImuLog>& runs, State& initial, uint16_t burst, Convert convert) {
+  unsigned long samples = 0;
+  std::vector<S> buf;
+  avr::counts().clear();
+  for (const ImuLog& run : runs) {
+    State f = initial;
+    for (const ImuLogSample& s : run) {
+      buf.push_back(convert(s));
+      if (buf.size() == burst) {
+        Counted<Algorithm>::update(f, &buf[0], burst);
+        buf.clear();
+      }
+    }
+    samples += run.size() - buf.size();
+    buf.clear();
+  }
+  return avr::counts().cycles() / samples;
+}
+
+template <typename Algorithm>
+Cost cost(const std::vector<ImuLog>& runs, float ki, uint16_t burst) {
+  CountedFilters initial(ki);
+  auto fs = floatSample<countedFloat::QuaternionSample>;
+  auto xs = fixedSample<countedFixed::QuaternionSampleFixed>;
+  Cost c;
+  c.floatCycles = cycles<Algorithm, countedFloat::QuaternionFilterState, countedFloat::QuaternionSample>(
+    runs, initial.fl, 1, fs);
+  c.fixedCycles = cycles<Algorithm, countedFixed::QuaternionFilterStateFixed, countedFixed::QuaternionSampleFixed>(
+    runs, initial.fx, 1, xs);
+  c.floatBurstCycles = cycles<Algorithm, countedFloat::QuaternionFilterState, countedFloat::QuaternionSample>(
+    runs, initial.fl, burst, fs);
+  c.fixedBurstCycles = cycles<Algorithm, countedFixed::QuaternionFilterStateFixed,
+    countedFixed::QuaternionSampleFixed>(runs, initial.fx, burst, xs);
+  return c;
+}
+
+
+template <typename Algorithm>
+bool check(const char* name, float ki, const std::vector<ImuLog>& runs,
+           const std::vector<const char*>& names, bool recorded, uint16_t burst) {
+  bool failed = false;
+  Cost c = cost<Algorithm>(runs, ki, burst);
+  double speedup = c.floatCycles / c.fixedCycles;
+  printf("%s: %.0f cycles (%.2f ms at 16 MHz) float, %.0f cycles (%.2f ms) fixed, %.1fx;"
+    " in bursts of %u, %.0f and %.0f per sample\n", name, c.floatCycles, c.floatCycles / 16000, c.fixedCycles,
+    c.fixedCycles / 16000, speedup, burst, c.floatBurstCycles, c.fixedBurstCycles);
+  if (speedup < MIN_SPEEDUP) failed = true;
+  if (c.floatBurstCycles > c.floatCycles || c.fixedBurstCycles > c.fixedCycles) failed = true;
+
+  for (size_t k = 0; k < runs.size(); k++) {
+    double settleS = !recorded && k == sim::MOTION_TILTED ? SETTLE_S : 0;
+    Result r = replay<Algorithm>(runs[k], settleS, ki, burst);
+    printf("  %-14s fixed from float: max %.3f deg, RMS %.3f deg", names[k], r.maxDiffDeg, r.rmsDiffDeg);
+    if (r.floatTruthDeg >= 0) {
+      printf("; from truth RMS %.3f deg float, %.3f deg fixed", r.floatTruthDeg, r.fixedTruthDeg);
+    }
+    printf("; bursts %.4f deg from single", r.burstDiffDeg);
+    if (r.mismatches) printf("; %lu counted values DIFFER", r.mismatches);
+    if (r.sharedMismatches) printf("; %lu free function results DIFFER", r.sharedMismatches);
+    printf("\n");
+    uint16_t longest = 0;
+    for (const ImuLogSample& s : runs[k]) longest = s.dtUs > longest ? s.dtUs : longest;
+    double stepDeg = BETA * longest * 1e-6 * 180 / M_PI;
+    double limit = MAX_FIXED_ERROR_STEPS * stepDeg > MAX_FIXED_ERROR_DEG ? MAX_FIXED_ERROR_STEPS * stepDeg
+                                                                        : MAX_FIXED_ERROR_DEG;
+    if (!(r.maxDiffDeg <= limit) || r.mismatches || r.sharedMismatches) failed = true;
+    if (r.fixedTruthDeg > r.floatTruthDeg + MAX_TRUTH_LOSS_DEG) failed = true;
+    if (!(r.burstDiffDeg <= MAX_BURST_ERROR_DEG)) failed = true;
+  }
+  return failed;
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  const char* recording = 0;
+  double seconds = 30;
+  double rateHz = 416;
+  unsigned long burst = 16;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-f") && i + 1 < argc) recording = argv[++i];
+    else if (!strcmp(argv[i], "-t") && i + 1 < argc) seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-r") && i + 1 < argc) rateHz = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-b") && i + 1 < argc) burst = strtoul(argv[++i], 0, 10);
+    else {
+      fprintf(stderr, "usage: %s [-f recording] [-t seconds] [-r rate_hz] [-b burst]\n", argv[0]);
+      exit(2);
+    }
+  }
+  if (burst < 1 || burst > 1000) {
+    fprintf(stderr, "%s: burst must be 1 to 1000 samples\n", argv[0]);
+    exit(2);
+  }
+
+  std::vector<ImuLog> runs;
+  std::vector<const char*> names;
+  if (recording) {
+    runs.resize(1);
+    if (!sim::loadImuLog(recording, runs[0]) || runs[0].empty()) {
+      printf("%s: no samples\n", recording);
+      return 1;
+    }
+    names.push_back(recording);
+  } else {
+    for (int k = 0; k < sim::MOTION_COUNT; k++) {
+      runs.push_back(sim::generateImuLog((sim::ImuMotion)k, seconds, rateHz, 12345 + k));
+      names.push_back(sim::IMU_MOTION_NAMES[k]);
+    }
+  }
+
+  bool failed = check<Madgwick>("Madgwick", 0, runs, names, recording, burst);
+  failed = check<Mahony>("Mahony", 0, runs, names, recording, burst) || failed;
+  failed = check<Mahony>("Mahony, Ki 0.01", 0.01f, runs, names, recording, burst) || failed;
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,303 @@
+// FusionSweep.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Tunes the float orientation filters offline: replays an IMU log through
+// Madgwick with a range of betas and Mahony with a grid of Kp and Ki, and
+// ranks the gains by the RMS angle between the filter and the true
+// orientation over every sample, so slow convergence from the tilted start
+// counts against a gain as much as noise does. The log is a recording with
+// truth (-f) or the four generated runs of FusionBench (imu_log.h); each
+// run starts the filters from the identity.
+//
+// The gain sets run eight (four without AVX) at a time in the SIMD lanes of
+// a FilterLanes (fusion_lanes.h), and the groups are shared out to -j worker
+// threads. Every gain set also runs on its own through the library's
+// OrientationFilter, which is what the lanes are timed against: the report
+// gives filter samples per second per core for each, from the CPU time the
+// workers used.
+//
+// Exits non-zero if any lane's quaternions or error differ by a bit from
+// its OrientationFilter's, or if the lanes are less than 2x faster (on a
+// log long enough to time).
+//
+// Usage: FusionSweep [-f recording] [-t seconds] [-r rate_hz] [-j threads] [-n gains]
+//                    [-a madgwick|mahony]
+//
+//   -f   replay a recording instead of the generated runs; it must have the
+//        truth columns (imu_log.h)
+//   -t   length of each generated run (default 30 s)
+//   -r   sample rate of the generated runs (default 416 Hz)
+//   -j   worker threads (default one per core)
+//   -n   betas, and Kps, to try (default 32), spaced evenly in log from
+//        0.02 to 2 rad/s and from 0.5 to 20; Mahony tries each Kp with four Kis
+//   -a   one algorithm only
+
+#include <Arduino.h>
+#include <OrientationFilter.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "fusion_lanes.h"
+#include "imu_log.h"
+
+namespace {
+
+const double MIN_BETA = 0.02, MAX_BETA = 2;     // rad/s
+const double MIN_KP = 0.5, MAX_KP = 20;
+const float KIS[] = { 0, 0.002f, 0.01f, 0.05f };
+const double MIN_SPEEDUP = 2;
+const double MIN_TIMED_S = 0.1;                 // CPU time alone for the speedup to count
+const int SHOWN = 5;                            // best gains listed
+
+typedef double FusionLaneSum __attribute__((vector_size(FUSION_LANES * sizeof(double))));
+const int WIDTH = FUSION_LANES;
+
+struct Gains {
+  float beta, kp, ki;
+};
+
+// A run as the float filters take it, with the truth in float
+struct Run {
+  std::vector<QuaternionSample> samples;
+  std::vector<float> truth;                     // 4 per sample
+};
+
+// One gain set's replay of every run
+struct Score {
+  double errorSum;                              // 1 - (q . truth)^2, sin^2 of half the angle, summed
+  std::vector<float> finalQ;                    // 4 per run
+};
+
+// RMS angle from truth, degrees, from the mean of sin^2 of half the angle
+double rmsDeg(double errorSum, unsigned long samples) {
+  double mean = errorSum / samples;
+  return 2 * asin(sqrt(mean < 0 ? 0 : mean > 1 ? 1 : mean)) * 180 / M_PI;
+}
+
+// Gain set g alone, through the library
+template <typename Algorithm>
+void replayScalar(const std::vector<Run>& runs, const Gains& g, Score& score) {
+  OrientationFilter<float, Algorithm> filter;
+  filter.setBeta(g.beta);
+  filter.setGains(g.kp, g.ki);
+  score.errorSum = 0;
+  score.finalQ.clear();
+  for (const Run& run : runs) {
+    filter.reset();
+    for (size_t k = 0; k < run.samples.size(); k++) {
+      filter.update(run.samples[k]);
+      const float* q = filter.getQ();
+      const float* t = &run.truth[4 * k];
+      float d = q[0] * t[0] + q[1] * t[1] + q[2] * t[2] + q[3] * t[3];
+      score.errorSum += (double)(1.0f - d * d);
+    }
+    score.finalQ.insert(score.finalQ.end(), filter.getQ(), filter.getQ() + 4);
+  }
+}
+
+// Gain sets g[0] to g[n - 1], n <= WIDTH, in lanes
+template <typename Algorithm>
+void replayLanes(const std::vector<Run>& runs, const Gains* g, int n, Score* scores) {
+  FilterLanes<Algorithm> lanes;
+  for (int i = 0; i < WIDTH; i++) {
+    const Gains& lane = g[i < n ? i : n - 1];     // spare lanes repeat the last
+    lanes.setBeta(i, lane.beta);
+    lanes.setGains(i, lane.kp, lane.ki);
+  }
+  FusionLaneSum sum = {};
+  for (int i = 0; i < n; i++) scores[i].finalQ.clear();
+  for (const Run& run : runs) {
+    lanes.reset();
+    for (size_t k = 0; k < run.samples.size(); k++) {
+      lanes.update(run.samples[k]);
+      const float* t = &run.truth[4 * k];
+      FusionLane d = lanes.q(0) * t[0] + lanes.q(1) * t[1] + lanes.q(2) * t[2] + lanes.q(3) * t[3];
+      sum += __builtin_convertvector(1.0f - d * d, FusionLaneSum);
+    }
+    for (int i = 0; i < n; i++) {
+      for (int c = 0; c < 4; c++) scores[i].finalQ.push_back(lanes.q(c)[i]);
+    }
+  }
+  for (int i = 0; i < n; i++) scores[i].errorSum = sum[i];
+}
+
+// CPU time of the calling thread, seconds
+double threadSeconds() {
+  timespec t;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Replays every gain set on threads workers, each taking the next task of
+// perTask gain sets until none are left. Returns the CPU seconds the
+// workers used, summed.
+template <typename Algorithm>
+double sweep(const std::vector<Run>& runs, const std::vector<Gains>& gains, std::vector<Score>& scores,
+             unsigned threads, bool inLanes) {
+  const size_t perTask = inLanes ? WIDTH : 1;
+  std::atomic<size_t> next(0);
+  std::vector<double> busy(threads, 0);
+  std::vector<std::thread> workers;
+  scores.resize(gains.size());
+  for (unsigned w = 0; w < threads; w++) {
+    workers.push_back(std::thread([&, w]() {
+      double start = threadSeconds();
+      for (size_t first; (first = next.fetch_add(perTask)) < gains.size();) {
+        int n = (int)std::min(perTask, gains.size() - first);
+        if (inLanes) replayLanes<Algorithm>(runs, &gains[first], n, &scores[first]);
+        else replayScalar<Algorithm>(runs, gains[first], scores[first]);
+      }
+      busy[w] = threadSeconds() - start;
+    }));
+  }
+  double total = 0;
+  for (unsigned w = 0; w < threads; w++) {
+    workers[w].join();
+    total += busy[w];
+  }
+  return total;
+}
+
+template <typename Algorithm>
+void describe(const Gains& g, char* out, size_t size);
+
+template <>
+void describe<Madgwick>(const Gains& g, char* out, size_t size) {
+  snprintf(out, size, "beta %.4f", g.beta);
+}
+
+template <>
+void describe<Mahony>(const Gains& g, char* out, size_t size) {
+  snprintf(out, size, "Kp %.3f, Ki %.3f", g.kp, g.ki);
+}
+
+template <typename Algorithm>
+bool check(const char* name, const std::vector<Run>& runs, const std::vector<Gains>& gains, unsigned threads) {
+  unsigned long samples = 0;
+  for (const Run& run : runs) samples += run.samples.size();
+  double filterSamples = (double)samples * gains.size();
+
+  std::vector<Score> scalar, lanes;
+  double scalarS = sweep<Algorithm>(runs, gains, scalar, threads, false);
+  double lanesS = sweep<Algorithm>(runs, gains, lanes, threads, true);
+
+  unsigned long differ = 0;
+  for (size_t i = 0; i < gains.size(); i++) {
+    // bitwise, so a NaN matches a NaN
+    if (memcmp(&scalar[i].errorSum, &lanes[i].errorSum, sizeof(double)) ||
+        memcmp(&scalar[i].finalQ[0], &lanes[i].finalQ[0], scalar[i].finalQ.size() * sizeof(float))) differ++;
+  }
+  double scalarRate = filterSamples / scalarS, lanesRate = filterSamples / lanesS;
+  double speedup = lanesRate / scalarRate;
+  printf("%s: %zu gain sets on %u thread%s, %.1fM filter samples/s per core alone, %.1fM in lanes, %.1fx",
+         name, gains.size(), threads, threads == 1 ? "" : "s", scalarRate / 1e6, lanesRate / 1e6, speedup);
+  if (differ) printf("; %lu lanes DIFFER from alone", differ);
+  printf("\n");
+
+  std::vector<size_t> order(gains.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return lanes[a].errorSum < lanes[b].errorSum; });
+  char text[64];
+  for (size_t k = 0; k < order.size() && k < (size_t)SHOWN; k++) {
+    describe<Algorithm>(gains[order[k]], text, sizeof text);
+    printf("  %-22s %.3f deg RMS from truth\n", text, rmsDeg(lanes[order[k]].errorSum, samples));
+  }
+  describe<Algorithm>(gains[0], text, sizeof text);
+  printf("  %-22s %.3f deg (default)\n", text, rmsDeg(lanes[0].errorSum, samples));
+
+  return differ || (scalarS >= MIN_TIMED_S && speedup < MIN_SPEEDUP);
+}
+
+// n values from lo to hi, spaced evenly in log
+std::vector<double> logSpaced(double lo, double hi, unsigned n) {
+  std::vector<double> v;
+  for (unsigned i = 0; i < n; i++) v.push_back(n == 1 ? lo : lo * pow(hi / lo, (double)i / (n - 1)));
+  return v;
+}
+
+Run toRun(const sim::ImuLog& log) {
+  Run run;
+  for (const sim::ImuLogSample& s : log) {
+    QuaternionSample r = { (float)s.a[0], (float)s.a[1], (float)s.a[2], (float)s.g[0], (float)s.g[1],
+                           (float)s.g[2], (float)s.m[0], (float)s.m[1], (float)s.m[2], s.dtUs * 1e-6f };
+    run.samples.push_back(r);
+    for (int i = 0; i < 4; i++) run.truth.push_back((float)s.truth[i]);
+  }
+  return run;
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  const char* recording = 0;
+  const char* only = 0;
+  double seconds = 30;
+  double rateHz = 416;
+  unsigned long threads = std::thread::hardware_concurrency();
+  unsigned long count = 32;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-f") && i + 1 < argc) recording = argv[++i];
+    else if (!strcmp(argv[i], "-t") && i + 1 < argc) seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-r") && i + 1 < argc) rateHz = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-j") && i + 1 < argc) threads = strtoul(argv[++i], 0, 10);
+    else if (!strcmp(argv[i], "-n") && i + 1 < argc) count = strtoul(argv[++i], 0, 10);
+    else if (!strcmp(argv[i], "-a") && i + 1 < argc && (!strcmp(argv[i + 1], "madgwick") ||
+                                                        !strcmp(argv[i + 1], "mahony"))) only = argv[++i];
+    else {
+      fprintf(stderr, "usage: %s [-f recording] [-t seconds] [-r rate_hz] [-j threads] [-n gains]"
+                      " [-a madgwick|mahony]\n", argv[0]);
+      exit(2);
+    }
+  }
+  if (threads < 1) threads = 1;
+  if (count < 1 || count > 10000) {
+    fprintf(stderr, "%s: gains must be 1 to 10000\n", argv[0]);
+    exit(2);
+  }
+
+  std::vector<Run> runs;
+  if (recording) {
+    sim::ImuLog log;
+    if (!sim::loadImuLog(recording, log) || log.empty()) {
+      printf("%s: no samples\n", recording);
+      return 1;
+    }
+    for (const sim::ImuLogSample& s : log) {
+      if (s.truth[0] == 0) {
+        printf("%s: no truth to score against\n", recording);
+        return 1;
+      }
+    }
+    runs.push_back(toRun(log));
+  } else {
+    for (int k = 0; k < sim::MOTION_COUNT; k++) {
+      runs.push_back(toRun(sim::generateImuLog((sim::ImuMotion)k, seconds, rateHz, 12345 + k)));
+    }
+  }
+
+  QuaternionFilterState defaults;
+  QuaternionFilterInit(defaults);
+  std::vector<Gains> madgwick(1, Gains{ defaults.beta, defaults.kp, defaults.ki });
+  std::vector<Gains> mahony = madgwick;
+  for (double beta : logSpaced(MIN_BETA, MAX_BETA, count)) {
+    madgwick.push_back(Gains{ (float)beta, defaults.kp, defaults.ki });
+  }
+  for (double kp : logSpaced(MIN_KP, MAX_KP, count)) {
+    for (float ki : KIS) mahony.push_back(Gains{ defaults.beta, (float)kp, ki });
+  }
+
+  bool failed = false;
+  if (!only || !strcmp(only, "madgwick")) failed = check<Madgwick>("Madgwick", runs, madgwick, threads) || failed;
+  if (!only || !strcmp(only, "mahony")) failed = check<Mahony>("Mahony", runs, mahony, threads) || failed;
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+// I2CAsync_sim.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Host side of I2CAsync. Each transaction takes the same bus time as the
+// blocking Wire calls it replaces, but the sketch does not wait for it:
+// one simulated TWI interrupt at the end of the transaction talks to the
+// device, runs the callback and starts the next queued transaction. The
+// AVR takes one interrupt per bus event instead; their CPU time is charged
+// to that one.
+
+#include <I2CAsync.h>
+#include "sim.h"
+
+namespace {
+
+const uint64_t TWI_ISR_US = 4;                  // one TWI interrupt on a 16 MHz AVR
+const uint64_t TWI_EVENTS = 5;                  // start, address, register, repeated start, address
+
+
+
+void twiInterrupt() {
+  AsyncWire.isr();
+}
+
+} // namespace
+
+
+void I2CAsync::portBegin(uint32_t hz) {
+  sim::i2cClock(hz);
+}
+
+
+void I2CAsync::portStart() {
+  I2CTransaction *t = _head;
+  // address + register, then after the repeated start address + data
+  uint64_t us = sim::i2cBusTimeUs(1);
+  if (sim::findI2CDevice(t->address)) us += sim::i2cBusTimeUs(t->length);
+  sim::at(sim::now() + us, []() { sim::runIsr("TWI master", twiInterrupt); });
+}
+
+
+void I2CAsync::isr() {
+  I2CTransaction *t = _head;
+  sim::I2CDevice *dev = sim::findI2CDevice(t->address);
+  sim::I2CStats &stats = sim::i2cStats();
+  uint8_t status = I2C_ASYNC_NACK;
+  stats.transactions++;
+  stats.bytes++;
+  stats.asyncUs += sim::i2cBusTimeUs(1);
+  if (dev) {
+    dev->receive(&t->reg, 1);
+    dev->request(t->dest, t->length);
+    stats.transactions++;
+    stats.bytes += t->length;
+    stats.asyncUs += sim::i2cBusTimeUs(t->length);
+    status = I2C_ASYNC_OK;
+  }
+  sim::advance((TWI_EVENTS + (dev ? t->length : 0)) * TWI_ISR_US);
+  if (finish(status)) portStart();
+}
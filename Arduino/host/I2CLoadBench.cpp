@@ -0,0 +1,210 @@
+// I2CLoadBench.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Runs a 1 kHz control task under the RobotController scheduler while three
+// sensors stream over I2C -- an LSM6DS33 with timestamps, an MPU-9250 and a
+// LIS3MDL -- each read from its own task. The sensors are read once with
+// the drivers' blocking calls and once with their async variants on
+// I2CAsync, and for each the control task's lateness, missed releases and
+// the sensor reads completed are reported. Exits non-zero if, with async
+// reads, the control task is ever late by more than a tenth of its period
+// or misses a release, or a sensor completes fewer reads than its task
+// issued.
+//
+// Usage: I2CLoadBench [-t seconds] [-k bus_khz]
+//
+//   -t   simulated run time per mode (default 5 s)
+//   -k   I2C bus clock (default 400 kHz)
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <I2CAsync.h>
+#include <LSM6.h>
+#include <LIS3MDL.h>
+#include <MPU9250.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "imu_sim.h"
+#include "scheduler.h"
+
+namespace {
+
+const uint32_t CONTROL_US = 1000;               // control period
+const uint32_t CONTROL_COST_US = 150;           // control work per run
+const uint32_t LSM6_US = 2400;                  // about 416 Hz
+const uint32_t MPU_US = 5000;                   // 200 Hz
+const uint32_t MAG_US = 12500;                  // 80 Hz
+const uint32_t SUBMIT_COST_US = 10;             // sensor task work besides the read
+const uint64_t PASS_COST_US = 20;               // loop() overhead per pass
+const uint8_t MPU_BYTES = 14;                   // accelerometer, temperature, gyro
+
+struct Stats {
+  uint32_t maxLate;
+  double meanLate;
+  uint16_t overruns;
+  unsigned long issued[3];                      // reads started, per sensor
+  unsigned long completed[3];
+  double asyncUs;                               // bus time run by the TWI interrupt, per second
+  double blockedUs;                             // bus time the sketch waited for, per second
+};
+
+enum { SENSOR_LSM6, SENSOR_MPU, SENSOR_MAG };
+
+const char* const SENSOR_NAMES[] = { "LSM6", "MPU-9250", "LIS3MDL" };
+
+LSM6 imu;
+LIS3MDL mag;
+MPU9250 mpu;
+uint8_t mpuBuf[MPU_BYTES];
+I2CTransaction mpuXfer;
+
+bool async = false;
+Scheduler<4> scheduler;
+Stats stats;
+double lateSum;
+
+
+void countCompletion(void* context) {
+  stats.completed[(intptr_t)context]++;
+}
+
+
+void mpuDone(I2CTransaction* t) {
+  if (t->status == I2C_ASYNC_OK) stats.completed[SENSOR_MPU]++;
+}
+
+
+void controlTask() {
+  uint32_t late = scheduler.lateness();
+  if (late > stats.maxLate) stats.maxLate = late;
+  lateSum += late;
+  sim::advance(CONTROL_COST_US);
+}
+
+
+void lsm6Task() {
+  sim::advance(SUBMIT_COST_US);
+  stats.issued[SENSOR_LSM6]++;
+  if (async) {
+    imu.readAsync(countCompletion, (void*)SENSOR_LSM6);
+  } else {
+    imu.read();
+    stats.completed[SENSOR_LSM6]++;
+  }
+}
+
+
+void mpuTask() {
+  sim::advance(SUBMIT_COST_US);
+  stats.issued[SENSOR_MPU]++;
+  if (async) {
+    mpu.readBytesAsync(&mpuXfer, MPU9250_ADDRESS, ACCEL_XOUT_H, MPU_BYTES, mpuBuf, mpuDone);
+  } else {
+    mpu.readBytes(MPU9250_ADDRESS, ACCEL_XOUT_H, MPU_BYTES, mpuBuf);
+    stats.completed[SENSOR_MPU]++;
+  }
+}
+
+
+void magTask() {
+  sim::advance(SUBMIT_COST_US);
+  stats.issued[SENSOR_MAG]++;
+  if (async) {
+    mag.readAsync(countCompletion, (void*)SENSOR_MAG);
+  } else {
+    mag.read();
+    stats.completed[SENSOR_MAG]++;
+  }
+}
+
+
+Stats run(bool useAsync, double seconds) {
+  async = useAsync;
+  stats = Stats();
+  lateSum = 0;
+  scheduler = Scheduler<4>();
+  scheduler.add(controlTask, CONTROL_US, F("control"));
+  scheduler.add(lsm6Task, LSM6_US, F("lsm6"));
+  scheduler.add(mpuTask, MPU_US, F("mpu9250"));
+  scheduler.add(magTask, MAG_US, F("lis3mdl"));
+  sim::i2cStats() = sim::I2CStats();
+  scheduler.start();
+
+  uint64_t end = sim::now() + (uint64_t)(seconds * 1e6);
+  while (sim::now() < end) {
+    sim::advance(PASS_COST_US);
+    scheduler.run();
+  }
+  while (AsyncWire.busy()) sim::advance(PASS_COST_US);
+
+  stats.overruns = scheduler.task(0).overruns;
+  stats.meanLate = lateSum / scheduler.task(0).runs;
+  stats.asyncUs = sim::i2cStats().asyncUs / seconds;
+  stats.blockedUs = sim::i2cStats().busUs / seconds;
+  return stats;
+}
+
+
+void report(const char* mode, const Stats& s, double seconds) {
+  printf("%s:\n", mode);
+  printf("  control  late max %4u us, mean %5.1f us, %u missed releases\n", s.maxLate, s.meanLate, s.overruns);
+  for (int i = 0; i < 3; i++) {
+    printf("  %-8s %6.1f reads/s of %6.1f issued\n", SENSOR_NAMES[i], s.completed[i] / seconds, s.issued[i] / seconds);
+  }
+  printf("  bus      %5.1f%% waited on by the sketch, %5.1f%% run by the TWI interrupt\n",
+    s.blockedUs / 1e4, s.asyncUs / 1e4);
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  double seconds = 5.0;
+  unsigned long khz = 400;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-t") && i + 1 < argc) seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-k") && i + 1 < argc) khz = strtoul(argv[++i], 0, 10);
+    else {
+      fprintf(stderr, "usage: %s [-t seconds] [-k bus_khz]\n", argv[0]);
+      exit(2);
+    }
+  }
+
+  sim::LSM6Device imuDevice;
+  sim::LIS3MDLDevice magDevice;
+  sim::RegisterDevice mpuDevice(MPU9250_ADDRESS);
+  mpuDevice.reg(WHO_AM_I_MPU9250) = 0x71;
+  sim::addI2CDevice(&imuDevice);
+  sim::addI2CDevice(&magDevice);
+  sim::addI2CDevice(&mpuDevice);
+
+  Wire.begin();
+  Wire.setClock(khz * 1000);
+  AsyncWire.begin(khz * 1000);
+
+  if (!imu.init() || !mag.init() || mpu.readByte(MPU9250_ADDRESS, WHO_AM_I_MPU9250) != 0x71) {
+    printf("sensors not detected\n");
+    return 1;
+  }
+  imu.enableDefault();
+  imu.enableTimestamp();
+  mag.enableDefault();
+
+  printf("1 kHz control task with LSM6 at %.0f Hz, MPU-9250 at %.0f Hz, LIS3MDL at %.0f Hz, %lu kHz bus, %.1f s per mode\n",
+    1e6 / LSM6_US, 1e6 / MPU_US, 1e6 / MAG_US, khz, seconds);
+  Stats blocking = run(false, seconds);
+  Stats queued = run(true, seconds);
+  report("blocking reads", blocking, seconds);
+  report("I2CAsync reads", queued, seconds);
+
+  if (queued.maxLate > CONTROL_US / 10 || queued.overruns) return 1;
+  for (int i = 0; i < 3; i++) {
+    if (queued.completed[i] < queued.issued[i]) return 1;
+  }
+  if (AsyncWire.errors()) return 1;
+  return 0;
+}
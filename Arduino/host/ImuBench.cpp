@@ -0,0 +1,356 @@
+// ImuBench.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Reads a simulated LSM6DS33 through the LSM6 library the way the sketch
+// does and reports, per IMU sample, the I2C transactions, bytes and bus
+// time each read path costs, and how many samples mixed gyro and
+// accelerometer outputs from different samples. The FIFO path drains every
+// sample the part produces into a struct-of-arrays buffer and also counts
+// samples lost between drains. Last, the FIFO is drained with hardware
+// timestamps, across a wrap of the 24-bit counter, and the time steps
+// between samples are compared with stamping each batch with micros() as
+// it is drained. Finally MinIMU9 runs inside a simulated loop(), once
+// reading every sensor on each pass and once reading only on the sensors'
+// data-ready interrupts, counting the distinct and repeated samples each
+// collects and the bus time spent per distinct sample. The samples MinIMU9
+// keeps are then checked: the ring's running mean and variance against
+// the same statistics summed directly over its spans, and the signs
+// readAll() applies. Exits non-zero if the burst or FIFO reads mix or lose
+// samples or don't save bus traffic, if a hardware time step is off by
+// more than one counter tick, if the interrupt path reads a sample twice
+// or doesn't save bus time over polling, or if a ring statistic or a sign
+// is wrong.
+//
+// Usage: ImuBench [-n samples] [-k bus_khz] [-p drain_period_ms] [-l loop_us]
+//
+//   -n   samples read per path (default 10000)
+//   -k   I2C bus clock (default 400 kHz)
+//   -p   time between FIFO drains (default 10 ms)
+//   -l   other work per loop() pass in the acquisition paths (default 1000 us)
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <LSM6.h>
+#include "minimu9.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "imu_sim.h"
+
+namespace {
+
+const uint64_t SAMPLE_SPACING_US = 997;         // not a multiple of any ODR period
+const uint16_t FIFO_CAPACITY = 64;              // samples per drain
+const uint8_t IMU_INT1_PIN = 18;                // LSM6 INT1
+const uint8_t MAG_DRDY_PIN = 19;                // LIS3MDL DRDY
+
+struct Result {
+  double transactions;                          // per sample
+  double bytes;
+  double busUs;
+  unsigned long mixed;                          // samples with gyro and accel from different outputs
+  unsigned long lost;                           // output samples skipped between consecutive FIFO samples
+};
+
+
+template <typename ReadFn>
+Result bench(LSM6& imu, unsigned long n, ReadFn read) {
+  sim::i2cStats() = sim::I2CStats();
+  Result r = { 0, 0, 0, 0, 0 };
+  for (unsigned long i = 0; i < n; i++) {
+    sim::advance(SAMPLE_SPACING_US);
+    read();
+    if (sim::LSM6Device::sampleOf(imu.g.x) != sim::LSM6Device::sampleOf(imu.a.z)) r.mixed++;
+  }
+  const sim::I2CStats& s = sim::i2cStats();
+  r.transactions = (double)s.transactions / n;
+  r.bytes = (double)s.bytes / n;
+  r.busUs = (double)s.busUs / n;
+  return r;
+}
+
+
+// Streams n samples through the FIFO, draining it every periodUs.
+Result benchFifo(LSM6& imu, unsigned long n, uint64_t periodUs) {
+  int16_t gx[FIFO_CAPACITY], gy[FIFO_CAPACITY], gz[FIFO_CAPACITY];
+  int16_t ax[FIFO_CAPACITY], ay[FIFO_CAPACITY], az[FIFO_CAPACITY];
+  LSM6::fifoBuffer buf = { gx, gy, gz, ax, ay, az, FIFO_CAPACITY, 0 };
+
+  imu.enableFifo(FIFO_CAPACITY / 2);
+  sim::i2cStats() = sim::I2CStats();
+  Result r = { 0, 0, 0, 0, 0 };
+  unsigned long got = 0;
+  int last = -1;
+  while (got < n) {
+    sim::advance(periodUs);
+    uint16_t k = imu.readFifo(&buf);
+    for (uint16_t i = 0; i < k; i++) {
+      unsigned s = sim::LSM6Device::sampleOf(gx[i]);
+      if (s != sim::LSM6Device::sampleOf(az[i])) r.mixed++;
+      if (last >= 0) r.lost += (s - last - 1) & 0x0FFF;
+      last = s;
+    }
+    got += k;
+  }
+  imu.disableFifo();
+  if (imu.fifo_overrun) r.lost++;
+
+  const sim::I2CStats& s = sim::i2cStats();
+  r.transactions = (double)s.transactions / got;
+  r.bytes = (double)s.bytes / got;
+  r.busUs = (double)s.busUs / got;
+  return r;
+}
+
+
+// Largest error in the time step between consecutive FIFO samples, taking
+// each sample's time from the LSM6 timestamp or from micros() at the drain.
+struct StepErrors {
+  double hardwareUs;
+  double drainUs;
+  bool monotonic;
+};
+
+
+StepErrors benchTimestamps(LSM6& imu, sim::LSM6Device& device, unsigned long n, uint64_t periodUs) {
+  int16_t gx[FIFO_CAPACITY], gy[FIFO_CAPACITY], gz[FIFO_CAPACITY];
+  int16_t ax[FIFO_CAPACITY], ay[FIFO_CAPACITY], az[FIFO_CAPACITY];
+  uint64_t t[FIFO_CAPACITY];
+  LSM6::fifoBuffer buf = { gx, gy, gz, ax, ay, az, FIFO_CAPACITY, t };
+
+  imu.enableTimestamp();
+  device.setTimestamp(0xFFFFFF - 4000);         // wraps 100 ms in
+  imu.enableFifo(FIFO_CAPACITY / 2);
+
+  StepErrors e = { 0, 0, true };
+  double step = (double)device.periodUs();
+  unsigned long got = 0;
+  bool first = true;
+  uint64_t lastHw = 0;
+  uint64_t lastDrain = 0;
+  while (got < n) {
+    sim::advance(periodUs);
+    uint16_t k = imu.readFifo(&buf);
+    uint64_t drain = micros();
+    for (uint16_t i = 0; i < k; i++) {
+      if (!first) {
+        if (t[i] <= lastHw) e.monotonic = false;
+        double hw = fabs((double)(t[i] - lastHw) - step);
+        double mcu = fabs((double)(drain - lastDrain) - step);
+        if (hw > e.hardwareUs) e.hardwareUs = hw;
+        if (mcu > e.drainUs) e.drainUs = mcu;
+      }
+      first = false;
+      lastHw = t[i];
+      lastDrain = drain;
+    }
+    got += k;
+  }
+  imu.disableFifo();
+  return e;
+}
+
+
+// Samples MinIMU9 collects from each sensor in a loop() that does loopUs
+// of other work per pass.
+struct Acquisition {
+  unsigned long imuSamples;                     // distinct LSM6 samples read
+  unsigned long imuRepeats;                     // reads that returned the previous sample again
+  unsigned long magSamples;
+  unsigned long magRepeats;
+  double busUs;                                 // bus time per distinct sample
+  double latencyUs;                             // mean data-ready edge to read, interrupt path only
+};
+
+
+// Counts a reading as a new sample or a repeat of the last one
+void tally(unsigned s, int& last, unsigned long& samples, unsigned long& repeats) {
+  if ((int)s == last) repeats++;
+  else samples++;
+  last = s;
+}
+
+
+template <typename PassFn>
+Acquisition acquire(uint64_t runUs, uint64_t loopUs, PassFn pass) {
+  sim::i2cStats() = sim::I2CStats();
+  Acquisition a = { 0, 0, 0, 0, 0, 0 };
+  uint64_t start = sim::now();
+  while (sim::now() - start < runUs) {
+    sim::advance(loopUs);
+    pass(a);
+  }
+  unsigned long samples = a.imuSamples + a.magSamples;
+  a.busUs = samples ? (double)sim::i2cStats().busUs / samples : 0;
+  return a;
+}
+
+
+Acquisition benchPolled(MinIMU9& imu, uint64_t runUs, uint64_t loopUs) {
+  int lastImu = -1, lastMag = -1;
+  return acquire(runUs, loopUs, [&](Acquisition& a) {
+    Readings r = imu.readAll();
+    tally(sim::LSM6Device::sampleOf(r.g.x), lastImu, a.imuSamples, a.imuRepeats);
+    tally(sim::LSM6Device::sampleOf(r.m.x), lastMag, a.magSamples, a.magRepeats);
+  });
+}
+
+
+Acquisition benchInterrupts(MinIMU9& imu, uint64_t runUs, uint64_t loopUs) {
+  int lastImu = -1, lastMag = -1;
+  Readings r(0, 0, 0, 0, 0, 0, 0, 0, 0);
+  double latency = 0;
+  unsigned long reads = 0;
+  Acquisition a = acquire(runUs, loopUs, [&](Acquisition& a) {
+    for (;;) {
+      ImuEvent e = imu.service(r);
+      if (e.source == IMU_EVENT_NONE) break;
+      if (e.source == IMU_EVENT_IMU) tally(sim::LSM6Device::sampleOf(r.g.x), lastImu, a.imuSamples, a.imuRepeats);
+      if (e.source == IMU_EVENT_MAG) tally(sim::LSM6Device::sampleOf(r.m.x), lastMag, a.magSamples, a.magRepeats);
+      latency += micros() - e.micros;
+      reads++;
+    }
+  });
+  a.latencyUs = reads ? latency / reads : 0;
+  return a;
+}
+
+
+// Largest difference between the ring's running mean and variance and
+// the same computed directly from the samples it holds, across channels.
+template <uint16_t N>
+double ringError(const ImuRing<N>& ring) {
+  ImuSpan spans[2];
+  uint8_t k = ring.latest(ring.size(), spans);
+  double worst = 0;
+  for (uint8_t c = 0; c < IMU_CHANNELS; c++) {
+    const int16_t* v = ring.channel(c);
+    double sum = 0, sumSq = 0;
+    unsigned n = 0;
+    for (uint8_t s = 0; s < k; s++) {
+      for (uint16_t i = spans[s].start; i < spans[s].start + spans[s].count; i++) {
+        sum += v[i];
+        n++;
+      }
+    }
+    double mean = sum / n;
+    for (uint8_t s = 0; s < k; s++) {
+      for (uint16_t i = spans[s].start; i < spans[s].start + spans[s].count; i++) {
+        sumSq += (v[i] - mean) * (v[i] - mean);
+      }
+    }
+    double var = sumSq / n;
+    worst = fmax(worst, fabs(ring.mean(c) - mean));
+    worst = fmax(worst, fabs(ring.variance(c) - var) / fmax(1.0, var));
+  }
+  return worst;
+}
+
+
+void report(const char* path, const Result& r) {
+  printf("%-22s %4.1f transactions, %5.1f bytes, %6.1f us bus time per sample, %lu mixed, %lu lost\n",
+    path, r.transactions, r.bytes, r.busUs, r.mixed, r.lost);
+}
+
+
+void report(const char* path, const Acquisition& a, double seconds) {
+  printf("%-22s LSM6 %5.0f/s (%4.0f/s repeats), LIS3MDL %3.0f/s (%4.0f/s repeats), %5.1f us bus time per sample",
+    path, a.imuSamples / seconds, a.imuRepeats / seconds, a.magSamples / seconds, a.magRepeats / seconds, a.busUs);
+  if (a.latencyUs > 0) printf(", %.0f us edge to read", a.latencyUs);
+  printf("\n");
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  unsigned long n = 10000;
+  unsigned long khz = 400;
+  double drainMs = 10;
+  unsigned long loopUs = 1000;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) n = strtoul(argv[++i], 0, 10);
+    else if (!strcmp(argv[i], "-k") && i + 1 < argc) khz = strtoul(argv[++i], 0, 10);
+    else if (!strcmp(argv[i], "-p") && i + 1 < argc) drainMs = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-l") && i + 1 < argc) loopUs = strtoul(argv[++i], 0, 10);
+    else {
+      fprintf(stderr, "usage: %s [-n samples] [-k bus_khz] [-p drain_period_ms] [-l loop_us]\n", argv[0]);
+      exit(2);
+    }
+  }
+
+  sim::LSM6Device device;
+  sim::LIS3MDLDevice mag;
+  sim::addI2CDevice(&device);
+  sim::addI2CDevice(&mag);
+  Wire.begin();
+  Wire.setClock(khz * 1000);
+
+  LSM6 imu;
+  if (!imu.init()) {
+    printf("LSM6 not detected\n");
+    return 1;
+  }
+  imu.enableDefault();
+
+  printf("LSM6DS33 at %lu kHz, %lu samples per path\n", khz, n);
+  Result separate = bench(imu, n, [&imu]() { imu.readAcc(); imu.readGyro(); });
+  Result burst = bench(imu, n, [&imu]() { imu.read(); });
+  Result withTemp = bench(imu, n, [&imu]() { imu.readWithTemp(); });
+  Result fifo = benchFifo(imu, n, (uint64_t)(drainMs * 1000));
+  report("readAcc() + readGyro()", separate);
+  report("read()", burst);
+  report("readWithTemp()", withTemp);
+  printf("FIFO, drained every %.1f ms:\n", drainMs);
+  report("readFifo()", fifo);
+  StepErrors steps = benchTimestamps(imu, device, n, (uint64_t)(drainMs * 1000));
+  printf("FIFO time steps, largest error: %.0f us from LSM6 timestamps (%s across the wrap), %.0f us from micros() at the drain\n",
+    steps.hardwareUs, steps.monotonic ? "monotonic" : "NOT MONOTONIC", steps.drainUs);
+
+  MinIMU9 minimu;
+  if (!minimu.setup()) {
+    printf("MinIMU-9 not detected\n");
+    return 1;
+  }
+  uint64_t runUs = n * device.periodUs();
+  double seconds = runUs / 1e6;
+  Acquisition polled = benchPolled(minimu, runUs, loopUs);
+  device.connectInt1(IMU_INT1_PIN);
+  mag.connectDrdy(MAG_DRDY_PIN);
+  if (!minimu.attachInterrupts(IMU_INT1_PIN, MAG_DRDY_PIN)) {
+    printf("MinIMU9 interrupts not attached\n");
+    return 1;
+  }
+  Acquisition interrupts = benchInterrupts(minimu, runUs, loopUs);
+  printf("MinIMU9 in a loop() with %lu us of other work per pass, %.1f s:\n", loopUs, seconds);
+  report("readAll() every pass", polled, seconds);
+  report("data-ready interrupts", interrupts, seconds);
+
+  // both sensors turned 180 degrees about y: readAll() once took the
+  // accelerometer z sign from y
+  minimu.detachInterrupts();
+  typedef Orientation<-SENSOR_X, SENSOR_Y, -SENSOR_Z> Flipped;
+  OrientedMinIMU9<Flipped> flipped;
+  flipped.setup();
+  Readings r = flipped.readAll();
+  int raw[] = { r.a.x, r.a.y, r.a.z, r.g.x, r.g.y, r.g.z, r.m.x, r.m.y, r.m.z };
+  int wrongSigns = 0;
+  for (int c = 0; c < IMU_CHANNELS; c++) {
+    if ((raw[c] < 0) != Flipped::reversed(c % 3)) wrongSigns++;
+  }
+  double ringErr = ringError(minimu.samples());
+  printf("MinIMU9 ring of %u samples: %u held, running mean/variance off by %.2g, %d wrong signs from readAll()\n",
+    minimu.samples().capacity(), minimu.samples().size(), ringErr, wrongSigns);
+
+  if (burst.mixed || withTemp.mixed || burst.busUs >= separate.busUs) return 1;
+  if (fifo.mixed || fifo.lost || fifo.busUs >= burst.busUs) return 1;
+  if (!steps.monotonic || steps.hardwareUs > 25) return 1;
+  if (interrupts.imuRepeats || interrupts.magRepeats || interrupts.busUs >= polled.busUs) return 1;
+  if (minimu.eventOverflows()) return 1;
+  if (minimu.samples().size() != minimu.samples().capacity() || ringErr > 1e-3 || wrongSigns) return 1;
+  return 0;
+}
@@ -0,0 +1,180 @@
+// MotionTest.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Queues a run of segments on a MotionQueue (motion.h) all at once, as the
+// master would in one upload, and lets it drive two simulated motors with
+// quadrature encoders through a Driver (driver.h) at CONTROL_HZ: a fast
+// straight that blends into a slower one, an arc, a spin, and a reversing
+// straight that ends the queue.
+//
+// Checks, exiting non-zero on any failure:
+//   - the queue takes MOTION_QUEUE_SIZE segments and refuses the next
+//   - the segments run in order, each once, and the page's number, depth
+//     and flags follow them
+//   - each timed segment lasts its length to within a control period
+//   - each distance segment covers its length to within DISTANCE_MM, and
+//     the last, where the robot stops, to within STOP_MM once it has
+//   - the setpoint stays above BLEND_FLOOR from the first straight into
+//     the arc, and its acceleration never changes faster than the jerk
+//     limits
+//
+// Usage: MotionTest [-v]
+//
+//   -v   print every control update
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "config.h"
+#include "wheel.h"
+#include "driver.h"
+#include "motion.h"
+
+namespace {
+
+const double DISTANCE_MM = 10.0;
+const double STOP_MM = 15.0;
+const int16_t BLEND_FLOOR = 250;                // mm/s the setpoint stays above from the first straight into the arc
+
+struct Plan {
+  const char* name;
+  bool timed;
+  uint16_t length;                              // ms or mm
+  int16_t velocity, yawRate;                    // mm/s, mrad/s
+};
+
+const Plan PLAN[] = {
+  { "fast", false, 600, 500, 0 },
+  { "slow", false, 400, 300, 0 },
+  { "arc", true, 1500, 300, 1000 },
+  { "spin", true, 1000, 0, -3000 },
+  { "reverse", false, 300, -400, 0 },
+};
+const int SEGMENTS = sizeof(PLAN) / sizeof(PLAN[0]);
+
+Wheel* leftWheel;
+Wheel* rightWheel;
+
+void leftEdge() { leftWheel->encoder().edge(); }
+void rightEdge() { rightWheel->encoder().edge(); }
+
+bool check(bool ok, const char* what) {
+  if (!ok) printf("FAIL: %s\n", what);
+  return ok;
+}
+
+double travelMm(sim::Motor& lm, sim::Motor& rm) { return (lm.position() + rm.position()) / 2 * 1000 / TICKS_PER_METRE; }
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  bool verbose = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-v")) verbose = true;
+    else {
+      fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+      exit(2);
+    }
+  }
+
+  sim::Motor& lm = sim::addMotor("Left", LEFT_PWM, LEFT_DIR1, LEFT_DIR2, LEFT_ENC);
+  sim::Motor& rm = sim::addMotor("Right", RIGHT_PWM, RIGHT_DIR1, RIGHT_DIR2, RIGHT_ENC);
+  lm.setQuadrature(LEFT_ENC_B);
+  rm.setQuadrature(RIGHT_ENC_B);
+
+  leftWheel = new Wheel("Left", LEFT_PWM, LEFT_DIR1, LEFT_DIR2);
+  rightWheel = new Wheel("Right", RIGHT_PWM, RIGHT_DIR1, RIGHT_DIR2);
+  leftWheel->encoder().begin(LEFT_ENC, LEFT_ENC_B, leftEdge);
+  rightWheel->encoder().begin(RIGHT_ENC, RIGHT_ENC_B, rightEdge);
+  Driver driver(leftWheel, rightWheel);
+  MotionQueue motion(&driver, leftWheel, rightWheel);
+
+  bool ok = true;
+  bool fits = true;
+  for (int i = 0; i < MOTION_QUEUE_SIZE; i++) fits &= motion.timed(100, 0, 0);
+  ok &= check(fits && !motion.timed(100, 0, 0) && motion.depth() == MOTION_QUEUE_SIZE, "queue capacity");
+  motion.clear();
+  ok &= check(motion.depth() == 0 && !motion.running(), "clear");
+
+  for (int i = 0; i < SEGMENTS; i++) {
+    const Plan& p = PLAN[i];
+    if (p.timed) motion.timed(p.length, p.velocity, p.yawRate);
+    else motion.distance(p.length, p.velocity);
+  }
+
+  const uint64_t periodUs = 1000000UL / CONTROL_HZ;
+  uint64_t started[SEGMENTS + 1];
+  double startMm[SEGMENTS + 1];
+  int seen = 0;
+  bool pageOk = true;
+  int16_t slowest = 32767;
+  bool cruising = false;                        // the setpoint has reached the first segment's speed
+  int lastA = 0, lastWa = 0;
+  double jerkExcess = 0;
+  uint64_t end = sim::now() + 15000000ULL;
+
+  while (sim::now() < end) {
+    sim::advance(periodUs);
+    motion.update();
+    driver.control();
+
+    struct MotionPage page;
+    motion.page(&page);
+    while (seen <= SEGMENTS && page.segment >= seen) {
+      started[seen] = sim::now();
+      startMm[seen] = travelMm(lm, rm);
+      if (page.segment != seen) pageOk = false;           // skipped one
+      seen++;
+    }
+    bool running = page.segment < SEGMENTS;
+    pageOk &= page.queued == SEGMENTS && page.depth == SEGMENTS - page.segment &&
+              !!(page.flags & MOTION_FLAG_RUNNING) == running;
+    cruising |= driver.velocity() >= PLAN[0].velocity;
+    if (cruising && page.segment < 3) slowest = std::min(slowest, driver.velocity());
+
+    double aStep = abs(driver.acceleration() - lastA) - (double)DRIVE_JERK / CONTROL_HZ;
+    double waStep = abs(driver.yawAcceleration() - lastWa) - (double)DRIVE_YAW_JERK / CONTROL_HZ;
+    jerkExcess = std::max(jerkExcess, std::max(aStep, waStep));
+    lastA = driver.acceleration();
+    lastWa = driver.yawAcceleration();
+
+    if (verbose) {
+      printf("%8.3f seg %u depth %u progress %5u | set %5d mm/s %6d mrad/s | L %7.1f R %7.1f | %7.1f mm\n",
+             sim::now() / 1e6, page.segment, page.depth, page.progress, page.velocity, page.yawRate, lm.speed(),
+             rm.speed(), travelMm(lm, rm));
+    }
+    if (!running && fabs(lm.speed()) < 1 && fabs(rm.speed()) < 1) break;
+  }
+  double stoppedMm = travelMm(lm, rm);
+
+  ok &= check(seen == SEGMENTS + 1, "every segment run");
+  ok &= check(pageOk, "motion page follows the queue");
+  for (int i = 0; i < SEGMENTS && i + 1 < seen; i++) {
+    const Plan& p = PLAN[i];
+    if (p.timed) {
+      double ms = (started[i + 1] - started[i]) / 1e3;
+      printf("%-8s %4u ms took %6.0f ms\n", p.name, p.length, ms);
+      ok &= check(fabs(ms - p.length) <= 1000.0 / CONTROL_HZ, "timed segment length");
+    } else {
+      double mm = fabs(startMm[i + 1] - startMm[i]);
+      printf("%-8s %4u mm covered %6.1f mm\n", p.name, p.length, mm);
+      ok &= check(fabs(mm - p.length) <= DISTANCE_MM, "distance segment length");
+    }
+  }
+  if (seen == SEGMENTS + 1) {
+    double mm = fabs(stoppedMm - startMm[SEGMENTS - 1]);
+    printf("stop:    last segment %u mm, %.1f mm once stopped\n", PLAN[SEGMENTS - 1].length, mm);
+    ok &= check(fabs(mm - PLAN[SEGMENTS - 1].length) <= STOP_MM, "stopped at the end of the queue");
+  }
+  printf("blend:   setpoint at least %d mm/s from the first straight into the arc; "
+         "acceleration at most %.1f over the jerk limits\n", slowest, std::max(0.0, jerkExcess));
+  ok &= check(slowest >= BLEND_FLOOR, "straights and arc blended");
+  ok &= check(jerkExcess <= 1, "acceleration within the jerk limits");
+  return ok ? 0 : 1;
+}
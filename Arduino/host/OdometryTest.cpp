@@ -0,0 +1,229 @@
+// OdometryTest.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Drives two simulated motors with quadrature encoders as the wheels of a
+// robot of TICKS_PER_METRE and WHEEL_BASE_MM (config.h) -- standing, a
+// straight, arcs, a spin, a reversing arc -- and tracks it with two
+// Odometry (odometry.h) updated at CONTROL_HZ: one from the encoders alone,
+// one with a simulated gyro that reads the mean true yaw rate over the
+// period plus a bias and noise, clipped at the LSM6's 245 dps. The spin is
+// fast enough to saturate it. In the last stretch the right wheel slips: a
+// quarter of its travel does not carry the robot.
+//
+// Checks, exiting non-zero on any failure:
+//   - sinQ15() against sin() at every angle
+//   - the encoder-only pose against the same edges integrated in double:
+//     the fixed point may add no more than REF_POS_MM and REF_HEADING_DEG
+//   - both poses against the true motion before the slip, and the
+//     velocity and yaw rate at the end of the straight and the arc
+//   - after the slip, the gyro pose's heading within SLIP_HEADING_DEG of
+//     the truth while the encoders' is not; the gyro's turn used in under
+//     10% of the updates outside the slip; and the learned gyro bias
+//
+// Usage: OdometryTest [-v]
+//
+//   -v   print the poses at every stretch
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "config.h"
+#include "encoder.h"
+#include "odometry.h"
+
+namespace {
+
+const double REF_POS_MM = 0.5;
+const double REF_HEADING_DEG = 0.01;
+const double TRUTH_POS_MM = 25.0;               // edges are ~1 mm; one edge of difference turns ~0.4 deg
+const double TRUTH_HEADING_DEG = 1.0;
+const double SLIP_HEADING_DEG = 2.0;
+const double RATE_ERROR = 0.03;                 // velocity and yaw rate, of the true value
+const int GYRO_BIAS = 40;                       // counts
+const int GYRO_NOISE = 6;                       // counts, peak to peak
+const double GYRO_DPS_PER_COUNT = 8.75e-3;
+const double SLIP = 0.25;                       // of the right wheel's travel lost in the slip stretch
+
+struct Stretch {
+  const char* name;
+  double seconds;
+  int left, right;                              // signed PWM
+  bool slip;
+};
+
+const Stretch SCHEDULE[] = {
+  { "standing", 1.0, 0, 0, false },
+  { "straight", 2.0, 150, 150, false },
+  { "arc left", 2.0, 100, 160, false },
+  { "spin right", 1.0, 150, -150, false },
+  { "reverse arc", 1.5, -200, -120, false },
+  { "stop", 0.5, 0, 0, false },
+  { "slipping arc", 1.5, 180, 140, true },
+  { "stop", 1.0, 0, 0, false },
+};
+
+Encoder leftEnc, rightEnc;
+
+void leftEdge() { leftEnc.edge(); }
+void rightEdge() { rightEnc.edge(); }
+
+// TB6612FNG: L/H forward, H/L reverse, H/H short brake
+void drive(uint8_t pwmPin, uint8_t inaPin, uint8_t inbPin, int d) {
+  digitalWrite(inaPin, d < 0 || d == 0 ? HIGH : LOW);
+  digitalWrite(inbPin, d > 0 || d == 0 ? HIGH : LOW);
+  analogWrite(pwmPin, abs(d));
+}
+
+struct Pose {
+  double x, y, theta;                           // m, rad
+
+  void move(double dl, double dr) {
+    double ds = (dl + dr) / 2, dth = (dr - dl) / (WHEEL_BASE_MM / 1000.0);
+    x += ds * cos(theta + dth / 2);
+    y += ds * sin(theta + dth / 2);
+    theta += dth;
+  }
+};
+
+double wrapDeg(double deg) {
+  deg = fmod(deg, 360.0);
+  if (deg > 180) deg -= 360;
+  if (deg < -180) deg += 360;
+  return deg;
+}
+
+double headingDeg(Odometry& o) { return o.heading32() * (360.0 / 4294967296.0); }
+
+double posErrMm(Odometry& o, const Pose& p) { return hypot(o.x() / 1e3 - p.x * 1e3, o.y() / 1e3 - p.y * 1e3); }
+
+double headErrDeg(Odometry& o, const Pose& p) { return fabs(wrapDeg(headingDeg(o) - p.theta * 180 / M_PI)); }
+
+bool check(bool ok, const char* what) {
+  if (!ok) printf("FAIL: %s\n", what);
+  return ok;
+}
+
+bool checkSine() {
+  int worst = 0;
+  for (uint32_t a = 0; a < 65536; a++) {
+    int e = abs((int)(Odometry::sinQ15((uint16_t)a) - lround(32768 * sin(a * 2 * M_PI / 65536))));
+    if (e > worst) worst = e;
+  }
+  printf("sinQ15:   at most %d/32768 off\n", worst);
+  return check(worst <= 3, "sinQ15 within 3/32768");
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  bool verbose = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-v")) verbose = true;
+    else {
+      fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+      exit(2);
+    }
+  }
+
+  bool ok = checkSine();
+
+  sim::Motor& lm = sim::addMotor("Left", LEFT_PWM, LEFT_DIR1, LEFT_DIR2, LEFT_ENC);
+  sim::Motor& rm = sim::addMotor("Right", RIGHT_PWM, RIGHT_DIR1, RIGHT_DIR2, RIGHT_ENC);
+  lm.setQuadrature(LEFT_ENC_B);
+  rm.setQuadrature(RIGHT_ENC_B);
+  leftEnc.begin(LEFT_ENC, LEFT_ENC_B, leftEdge);
+  rightEnc.begin(RIGHT_ENC, RIGHT_ENC_B, rightEdge);
+
+  Odometry wheels(TICKS_PER_METRE, WHEEL_BASE_MM);
+  Odometry gyro(TICKS_PER_METRE, WHEEL_BASE_MM);
+  gyro.setSlipThreshold(ODOM_SLIP_DPS);
+  wheels.update(leftEnc, rightEnc);
+  gyro.update(leftEnc, rightEnc, GYRO_BIAS);
+
+  const double metrePerEdge = 1.0 / TICKS_PER_METRE;
+  const uint64_t periodUs = 1000000UL / CONTROL_HZ;
+  Pose truth = { 0, 0, 0 }, ref = { 0, 0, 0 };
+  double lastL = lm.position(), lastR = rm.position();
+  int32_t refL = leftEnc.position(), refR = rightEnc.position();
+  double yawRate = 0, speed = 0;                // true over the last period, rad/s and m/s
+  uint32_t noise = 12345;
+  double refPos = 0, refHead = 0;
+  unsigned long slipFlags[2] = { 0, 0 }, updates[2] = { 0, 0 };   // outside and in the slip stretch
+
+  for (const Stretch& s : SCHEDULE) {
+    drive(LEFT_PWM, LEFT_DIR1, LEFT_DIR2, s.left);
+    drive(RIGHT_PWM, RIGHT_DIR1, RIGHT_DIR2, s.right);
+    uint64_t end = sim::now() + (uint64_t)(s.seconds * 1e6);
+    while (sim::now() < end) {
+      double theta0 = truth.theta, x0 = truth.x, y0 = truth.y;
+      for (uint64_t t = 0; t < periodUs; t += 1000) {
+        sim::advance(1000);
+        double dl = (lm.position() - lastL) * metrePerEdge;
+        double dr = (rm.position() - lastR) * metrePerEdge * (s.slip ? 1 - SLIP : 1);
+        lastL = lm.position();
+        lastR = rm.position();
+        truth.move(dl, dr);
+      }
+      yawRate = (truth.theta - theta0) / (periodUs / 1e6);
+      speed = hypot(truth.x - x0, truth.y - y0) / (periodUs / 1e6);
+      leftEnc.update();
+      rightEnc.update();
+
+      noise = noise * 1103515245 + 12345;
+      int n = (int)((noise >> 16) % (GYRO_NOISE + 1)) - GYRO_NOISE / 2;
+      long counts = lround(yawRate * 180 / M_PI / GYRO_DPS_PER_COUNT) + GYRO_BIAS + n;
+      wheels.update(leftEnc, rightEnc);
+      gyro.update(leftEnc, rightEnc, (int16_t)constrain(counts, -32768L, 32767L));
+      updates[s.slip]++;
+      if (gyro.flags() & ODOM_FLAG_SLIP) slipFlags[s.slip]++;
+
+      ref.move((leftEnc.position() - refL) * metrePerEdge, (rightEnc.position() - refR) * metrePerEdge);
+      refL = leftEnc.position();
+      refR = rightEnc.position();
+      refPos = std::max(refPos, posErrMm(wheels, ref));
+      refHead = std::max(refHead, headErrDeg(wheels, ref));
+    }
+
+    if (verbose) {
+      printf("%-12s truth %8.1f %8.1f mm %7.2f deg | wheels %8.1f %8.1f %7.2f | gyro %8.1f %8.1f %7.2f%s\n",
+             s.name, truth.x * 1e3, truth.y * 1e3, wrapDeg(truth.theta * 180 / M_PI), wheels.x() / 1e3,
+             wheels.y() / 1e3, wrapDeg(headingDeg(wheels)), gyro.x() / 1e3, gyro.y() / 1e3,
+             wrapDeg(headingDeg(gyro)), gyro.flags() & ODOM_FLAG_SLIP ? " slip" : "");
+    }
+
+    if (!strcmp(s.name, "straight") || !strcmp(s.name, "arc left")) {
+      double v = speed * 1e3, w = yawRate * 1e3;
+      printf("%-12s velocity %4d mm/s (true %.0f), yaw rate %5d/%5d mrad/s wheels/gyro (true %.0f)\n", s.name,
+             wheels.velocity(), v, wheels.yawRate(), gyro.yawRate(), w);
+      ok &= check(fabs(wheels.velocity() - v) <= RATE_ERROR * fabs(v) + 2, "velocity");
+      ok &= check(fabs(wheels.yawRate() - w) <= RATE_ERROR * fabs(w) + 10, "wheel yaw rate");
+    }
+    if (!strcmp(s.name, "stop") && !s.slip && sim::now() < 9000000ULL) {
+      double p = posErrMm(wheels, truth), h = headErrDeg(wheels, truth);
+      double gp = posErrMm(gyro, truth), gh = headErrDeg(gyro, truth);
+      printf("before slip: %.2f m travelled, off by %.1f mm %.2f deg (wheels), %.1f mm %.2f deg (gyro)\n",
+             hypot(truth.x, truth.y), p, h, gp, gh);
+      ok &= check(p <= TRUTH_POS_MM && h <= TRUTH_HEADING_DEG, "wheel pose before the slip");
+      ok &= check(gp <= TRUTH_POS_MM && gh <= TRUTH_HEADING_DEG, "gyro pose before the slip");
+    }
+  }
+
+  double h = headErrDeg(wheels, truth), gh = headErrDeg(gyro, truth);
+  printf("after slip:  heading off by %.2f deg (wheels), %.2f deg (gyro); position %.1f and %.1f mm\n",
+         h, gh, posErrMm(wheels, truth), posErrMm(gyro, truth));
+  ok &= check(gh <= SLIP_HEADING_DEG && h > 2 * gh, "gyro heading through the slip");
+  printf("gyro used:   %.1f%% of updates outside the slip, %.1f%% in it\n", 100.0 * slipFlags[0] / updates[0],
+         100.0 * slipFlags[1] / updates[1]);
+  ok &= check(slipFlags[0] <= updates[0] / 10, "gyro used in under 10% of updates outside the slip");
+  printf("gyro bias:   %d counts learned (true %d)\n", gyro.gyroBias(), GYRO_BIAS);
+  ok &= check(abs(gyro.gyroBias() - GYRO_BIAS) <= 2, "gyro bias");
+  printf("fixed point: at most %.3f mm %.4f deg from the same edges in double\n", refPos, refHead);
+  ok &= check(refPos <= REF_POS_MM && refHead <= REF_HEADING_DEG, "fixed point against double");
+  return ok ? 0 : 1;
+}
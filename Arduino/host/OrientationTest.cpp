@@ -0,0 +1,265 @@
+// OrientationTest.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Checks every Orientation (orientation.h): all 48 ways of laying the
+// sensor's signed axes along the robot's. The 24 rotations are built
+// independently, by composing 90° turns about x, y and z until no new
+// matrix appears, and each descriptor must land in that set exactly when
+// rotation() says it is one, so the 24 rotations are each covered once.
+// Each descriptor's apply() must give the matrix its template arguments
+// spell out, and target() must invert source().
+//
+// Then, for each of the 24 rotations, a MinIMU9 mounted that way reads the
+// simulated MinIMU-9, whose outputs carry their sensor axis in their low
+// bits: every robot axis of readAll(), service(), readStream() and the
+// sample ring must come from the right sensor axis with the right sign.
+// Exits non-zero on the first failure.
+//
+// Usage: OrientationTest
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "minimu9.h"
+#include "sim.h"
+#include "imu_sim.h"
+
+namespace {
+
+const uint8_t IMU_INT1_PIN = 18;
+const uint8_t MAG_DRDY_PIN = 19;
+const uint16_t FIFO_CAPACITY = 32;
+
+struct Matrix {
+  int m[3][3];
+
+  bool operator==(const Matrix& o) const { return !memcmp(m, o.m, sizeof m); }
+
+  Matrix operator*(const Matrix& o) const {
+    Matrix r;
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        r.m[i][j] = 0;
+        for (int k = 0; k < 3; k++) r.m[i][j] += m[i][k] * o.m[k][j];
+      }
+    }
+    return r;
+  }
+};
+
+const Matrix TURN_X = {{ { 1, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 } }};
+const Matrix TURN_Y = {{ { 0, 0, 1 }, { 0, 1, 0 }, { -1, 0, 0 } }};
+const Matrix TURN_Z = {{ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } }};
+
+std::vector<Matrix> rotations;
+std::vector<int> matched;                       // descriptors that landed on each rotation
+int failures = 0;
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL: " __VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+
+// The closure of the three quarter turns
+void buildRotations() {
+  const Matrix identity = {{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }};
+  rotations.push_back(identity);
+  for (size_t i = 0; i < rotations.size(); i++) {
+    const Matrix turns[] = { TURN_X, TURN_Y, TURN_Z };
+    for (const Matrix& t : turns) {
+      Matrix r = t * rotations[i];
+      bool seen = false;
+      for (const Matrix& q : rotations) seen = seen || q == r;
+      if (!seen) rotations.push_back(r);
+    }
+  }
+  matched.assign(rotations.size(), 0);
+}
+
+
+// Signed permutation I of 48: the permutation is I / 8, the reversed axes
+// the bits of I % 8
+template <int I>
+struct Mount {
+  static constexpr int8_t P[6][3] = { { 1, 2, 3 }, { 1, 3, 2 }, { 2, 1, 3 }, { 2, 3, 1 }, { 3, 1, 2 }, { 3, 2, 1 } };
+  static const int8_t X = (I & 1 ? -1 : 1) * P[I / 8][0];
+  static const int8_t Y = (I & 2 ? -1 : 1) * P[I / 8][1];
+  static const int8_t Z = (I & 4 ? -1 : 1) * P[I / 8][2];
+  typedef Orientation<X, Y, Z> Type;
+};
+
+template <int I>
+constexpr int8_t Mount<I>::P[6][3];
+
+
+// Robot axis r of a reading from sensor axis base + source(r), as the
+// simulated devices encode it
+int16_t axisCode(int16_t v) {
+  return (v < 0 ? -v : v) & 7;
+}
+
+
+template <class O>
+bool axesMatch(const char* what, int x, int y, int z, int base, const char* name) {
+  int v[3] = { x, y, z };
+  bool ok = true;
+  for (uint8_t r = 0; r < 3; r++) {
+    bool sourceOk = axisCode(v[r]) == base + O::source(r);
+    bool signOk = (v[r] < 0) == O::reversed(r);
+    if (!sourceOk || !signOk) {
+      printf("FAIL: %s %s robot axis %c = %d\n", name, what, "xyz"[r], v[r]);
+      failures++;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+
+template <int I>
+void checkDescriptor() {
+  typedef typename Mount<I>::Type O;
+  const int8_t args[3] = { Mount<I>::X, Mount<I>::Y, Mount<I>::Z };
+
+  Matrix m = {{ { 0 } }};
+  for (int r = 0; r < 3; r++) {
+    int s = (args[r] < 0 ? -args[r] : args[r]) - 1;
+    m.m[r][s] = args[r] < 0 ? -1 : 1;
+    CHECK(O::source(r) == s && O::reversed(r) == (args[r] < 0), "mount %d axis %d: source/reversed", I, r);
+    CHECK(O::target(s) == r, "mount %d: target(%d) is not %d", I, s, r);
+  }
+
+  // apply() is m times the reading, for readings that tell the axes apart
+  const int16_t in[][3] = { { 1000, 2000, 3000 }, { -7, 11, -13 }, { 32767, -32767, 0 } };
+  for (const auto& v : in) {
+    int16_t x = v[0], y = v[1], z = v[2];
+    O::apply(x, y, z);
+    int16_t out[3] = { x, y, z };
+    for (int r = 0; r < 3; r++) {
+      int want = m.m[r][0] * v[0] + m.m[r][1] * v[1] + m.m[r][2] * v[2];
+      CHECK(out[r] == want, "mount %d: apply() axis %d gave %d, want %d", I, r, out[r], want);
+    }
+  }
+
+  int found = -1;
+  for (size_t k = 0; k < rotations.size(); k++) {
+    if (rotations[k] == m) found = (int)k;
+  }
+  CHECK((found >= 0) == O::rotation(), "mount %d: rotation() is %d", I, O::rotation());
+  if (found >= 0) matched[found]++;
+}
+
+
+// Reads the simulated MinIMU-9 mounted as O on every path
+template <class O>
+void checkMinIMU9(const char* name) {
+  OrientedMinIMU9<O, O> imu;
+  if (!imu.setup()) {
+    printf("FAIL: %s: MinIMU-9 not detected\n", name);
+    failures++;
+    return;
+  }
+  sim::advance(20000);
+
+  Readings r = imu.readAll();
+  axesMatch<O>("readAll() a", r.a.x, r.a.y, r.a.z, sim::LSM6Device::AX, name);
+  axesMatch<O>("readAll() g", r.g.x, r.g.y, r.g.z, sim::LSM6Device::GX, name);
+  axesMatch<O>("readAll() m", r.m.x, r.m.y, r.m.z, 0, name);
+  Xyz a = imu.readAccelerometer();
+  axesMatch<O>("readAccelerometer()", a.x, a.y, a.z, sim::LSM6Device::AX, name);
+  Xyz m = imu.readMagnetometer();
+  axesMatch<O>("readMagnetometer()", m.x, m.y, m.z, 0, name);
+
+  const ImuRing<IMU_RING_SIZE>& s = imu.samples();
+  axesMatch<O>("ring a", s.last(IMU_AX), s.last(IMU_AY), s.last(IMU_AZ), sim::LSM6Device::AX, name);
+  axesMatch<O>("ring g", s.last(IMU_GX), s.last(IMU_GY), s.last(IMU_GZ), sim::LSM6Device::GX, name);
+  axesMatch<O>("ring m", s.last(IMU_MX), s.last(IMU_MY), s.last(IMU_MZ), 0, name);
+
+  imu.attachInterrupts(IMU_INT1_PIN, MAG_DRDY_PIN);
+  Readings e(0, 0, 0, 0, 0, 0, 0, 0, 0);
+  bool sawImu = false, sawMag = false;
+  for (int pass = 0; pass < 100 && !(sawImu && sawMag); pass++) {
+    sim::advance(1000);
+    for (ImuEvent ev = imu.service(e); ev.source != IMU_EVENT_NONE; ev = imu.service(e)) {
+      if (ev.source == IMU_EVENT_IMU) {
+        sawImu = true;
+        axesMatch<O>("service() a", e.a.x, e.a.y, e.a.z, sim::LSM6Device::AX, name);
+        axesMatch<O>("service() g", e.g.x, e.g.y, e.g.z, sim::LSM6Device::GX, name);
+      } else if (ev.source == IMU_EVENT_MAG) {
+        sawMag = true;
+        axesMatch<O>("service() m", e.m.x, e.m.y, e.m.z, 0, name);
+      }
+    }
+  }
+  CHECK(sawImu && sawMag, "%s: service() saw no data-ready events", name);
+  imu.detachInterrupts();
+
+  int16_t gx[FIFO_CAPACITY], gy[FIFO_CAPACITY], gz[FIFO_CAPACITY];
+  int16_t ax[FIFO_CAPACITY], ay[FIFO_CAPACITY], az[FIFO_CAPACITY];
+  LSM6::fifoBuffer buf = { gx, gy, gz, ax, ay, az, FIFO_CAPACITY, 0 };
+  imu.enableStreaming(FIFO_CAPACITY / 2);
+  sim::advance(10000);
+  uint16_t n = imu.readStream(&buf);
+  CHECK(n > 0, "%s: readStream() returned nothing", name);
+  for (uint16_t i = 0; i < n; i++) {
+    if (!axesMatch<O>("readStream() a", ax[i], ay[i], az[i], sim::LSM6Device::AX, name)) break;
+    if (!axesMatch<O>("readStream() g", gx[i], gy[i], gz[i], sim::LSM6Device::GX, name)) break;
+  }
+  axesMatch<O>("ring after readStream() a", s.last(IMU_AX), s.last(IMU_AY), s.last(IMU_AZ), sim::LSM6Device::AX, name);
+}
+
+
+template <int I>
+struct All {
+  static void run(int& rotationsRead) {
+    All<I - 1>::run(rotationsRead);
+    checkDescriptor<I - 1>();
+    typedef typename Mount<I - 1>::Type O;
+    if (O::rotation()) {
+      char name[32];
+      snprintf(name, sizeof name, "Orientation<%d, %d, %d>", Mount<I - 1>::X, Mount<I - 1>::Y, Mount<I - 1>::Z);
+      checkMinIMU9<O>(name);
+      rotationsRead++;
+    }
+  }
+};
+
+template <>
+struct All<0> {
+  static void run(int&) {}
+};
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  if (argc > 1) {
+    fprintf(stderr, "usage: %s\n", argv[0]);
+    exit(2);
+  }
+
+  sim::LSM6Device imuDevice;
+  sim::LIS3MDLDevice magDevice;
+  imuDevice.connectInt1(IMU_INT1_PIN);
+  magDevice.connectDrdy(MAG_DRDY_PIN);
+  sim::addI2CDevice(&imuDevice);
+  sim::addI2CDevice(&magDevice);
+  Wire.begin();
+  Wire.setClock(400000);
+
+  buildRotations();
+  CHECK(rotations.size() == 24, "%u rotations built, not 24", (unsigned)rotations.size());
+
+  int rotationsRead = 0;
+  All<48>::run(rotationsRead);
+  for (size_t k = 0; k < matched.size(); k++) {
+    CHECK(matched[k] == 1, "rotation %u matched by %d descriptors", (unsigned)k, matched[k]);
+  }
+
+  printf("%u rotations, 48 descriptors, %d MinIMU9 mounts read: %s\n", (unsigned)rotations.size(), rotationsRead,
+    failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,567 @@
+// RobotSim.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Runs the RobotController sketch against two simulated motors and reports
+// loop latency, ISR cost and how quickly each wheel settles after the motors
+// are started. Throughout the run a master polls the register map at 20 Hz
+// and the cumulative tick counts it sees are checked against the encoder
+// edges the motors produced. At the end the odometry page is read over I2C
+// and must match the sketch's pose, and a run of motion segments is
+// uploaded in one write and followed on the motion page. The run fails if a
+// wheel takes longer than 300 ms past the driver's acceleration ramp to
+// settle, or if a wheel's tick interval average is more than 2% off the
+// motor's settled speed or still reads a speed at the end of the run, or if
+// the segments don't all run in order.
+//
+// The sketch's profiler probes are printed at the end, along with the host
+// cost of one probe, and a profile page read over I2C is checked against
+// them.
+//
+// Usage: RobotSim [-t seconds] [-l loop_cost_us] [-v] [-c trace.csv] [-s burst] [-x] [-r reads]
+//
+//   -t   simulated run time (default 8 s)
+//   -l   simulated cost of one pass through loop() (default 50 us)
+//   -v   echo the sketch's Serial output
+//   -c   write a 1 ms trace of motor drive and wheel speed to a CSV file
+//   -s   I2C stress: every 2 s the master streams this many motor commands
+//        back to back at 400 kHz; exits non-zero if any are lost
+//   -x   at 4 s the master reverses both wheels (CMD_REV_BOTH); reports how
+//        long each wheel takes to turn around and the longest loop() pass
+//        while they do; exits non-zero if either never shows REVERSING
+//   -r   register stress: instead of the simulation, one thread updates the
+//        registers while another reads this many snapshots through the
+//        request handler; exits non-zero on a torn read
+
+#include <Arduino.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "sim.h"
+#include "config.h"
+#include "i2c_handler.h"
+#include "odometry.h"
+#include "piezo.h"
+#include "profiler.h"
+#include "scheduler.h"
+
+void setup();
+void loop();
+
+extern Scheduler<TASK_COUNT> scheduler;
+extern Odometry odometry;
+
+namespace {
+
+const double SETTLE_LIMIT_MS = 300.0;           // past the driver's ramp (see reportSettling())
+const double TICK_SPEED_ERROR = 0.02;
+
+struct Sample {
+  uint64_t t;
+  int drive;                                    // PWM signed by the TB6612FNG direction, 0 when not driven
+  double speed;
+  unsigned int tickTps;                         // the wheel's speed from its tick interval average
+  uint64_t edges;
+  bool reversing;                               // the wheel's state() was REVERSING
+};
+
+struct Options {
+  double seconds;
+  uint64_t loopCostUs;
+  const char* csv;
+  int burst;
+  unsigned long regReads;
+  bool reverse;
+
+  Options() : seconds(8.0), loopCostUs(50), csv(0), burst(0), regReads(0), reverse(false) {}
+};
+
+
+int drive(uint8_t pwmPin, uint8_t inaPin, uint8_t inbPin) {
+  int a = sim::pinLevel(inaPin);
+  int b = sim::pinLevel(inbPin);
+  if (a == LOW && b == HIGH) return sim::pwm(pwmPin);
+  if (a == HIGH && b == LOW) return -sim::pwm(pwmPin);
+  return 0;
+}
+
+
+Options parseArgs(int argc, char** argv) {
+  Options o;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-t") && i + 1 < argc) o.seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-l") && i + 1 < argc) o.loopCostUs = strtoull(argv[++i], 0, 10);
+    else if (!strcmp(argv[i], "-c") && i + 1 < argc) o.csv = argv[++i];
+    else if (!strcmp(argv[i], "-s") && i + 1 < argc) o.burst = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-r") && i + 1 < argc) o.regReads = strtoul(argv[++i], 0, 10);
+    else if (!strcmp(argv[i], "-x")) o.reverse = true;
+    else if (!strcmp(argv[i], "-v")) sim::echoSerial = true;
+    else {
+      fprintf(stderr, "usage: %s [-t seconds] [-l loop_cost_us] [-v] [-c trace.csv] [-s burst] [-x] [-r reads]\n", argv[0]);
+      exit(2);
+    }
+  }
+  return o;
+}
+
+
+// The last sample of the drive segment starting at start, before the
+// driver's ramp down to the stop: the last with the drive within 10% of
+// the segment's median.
+size_t segmentEnd(const std::vector<Sample>& trace, size_t start) {
+  size_t end = start;
+  while (end + 1 < trace.size() && (trace[end + 1].drive > 0) == (trace[start].drive > 0) &&
+         trace[end + 1].drive != 0) end++;
+  std::vector<int> drives;
+  for (size_t i = start; i <= end; i++) drives.push_back(abs(trace[i].drive));
+  std::nth_element(drives.begin(), drives.begin() + drives.size() / 2, drives.end());
+  int median = drives[drives.size() / 2];
+  while (end > start && abs(trace[end].drive) * 10 < median * 9) end--;
+  return end;
+}
+
+
+// Time from when the motor is first driven until the speed stays within 5%
+// of the value it holds at the end of that drive segment. Both are printed,
+// but the settling time returned, in ms, is the time past the driver's
+// ramp up to that speed, or -1 if the motor was never driven. The
+// driver's acceleration and jerk limits take longer than SETTLE_LIMIT_MS
+// on their own to reach speed, so the limit applies past the ramp.
+double reportSettling(const char* label, const std::vector<Sample>& trace) {
+  size_t start = 0;
+  while (start < trace.size() && trace[start].drive == 0) start++;
+  if (start == trace.size()) {
+    printf("%-6s motor: never driven\n", label);
+    return -1.0;
+  }
+  size_t end = segmentEnd(trace, start);
+
+  size_t tail = end > start + 100 ? end - 100 : start;
+  double final = 0.0;
+  for (size_t i = tail; i <= end; i++) final += trace[i].speed;
+  final /= (end - tail + 1);
+
+  size_t settled = end;
+  while (settled > start && fabs(trace[settled - 1].speed - final) <= 0.05 * fabs(final)) settled--;
+
+  double ms = (trace[settled].t - trace[start].t) / 1e3;
+  double rampMs = (fabs(final) * 1e3 / TICKS_PER_METRE / DRIVE_ACCEL + (double)DRIVE_ACCEL / DRIVE_JERK) * 1e3;
+  printf("%-6s motor: start %.3f s, 5%% settle %.0f ms, %.0f ms past the %.0f ms ramp, final %.1f edges/s at drive %d\n",
+    label, trace[start].t / 1e6, ms, ms - rampMs, rampMs, final, trace[end].drive);
+  return ms - rampMs;
+}
+
+
+// The wheel's tick interval average against the motor over the last 100 ms
+// of its first drive segment, and how long after the motor was last driven,
+// and after its last tick, it comes down to zero. False if it is off by more than TICK_SPEED_ERROR or
+// still reads a speed at the end.
+bool reportTickFilter(const char* label, const std::vector<Sample>& trace) {
+  size_t start = 0;
+  while (start < trace.size() && trace[start].drive == 0) start++;
+  if (start == trace.size()) return true;
+  size_t end = segmentEnd(trace, start);
+
+  size_t tail = end > start + 100 ? end - 100 : start;
+  double err = 0.0, speed = 0.0;
+  for (size_t i = tail; i <= end; i++) {
+    err += fabs(trace[i].tickTps - fabs(trace[i].speed));
+    speed += fabs(trace[i].speed);
+  }
+  err /= speed;
+
+  size_t lastDriven = trace.size() - 1;
+  while (lastDriven > 0 && trace[lastDriven].drive == 0) lastDriven--;
+  size_t zero = trace.size();
+  while (zero > lastDriven + 1 && trace[zero - 1].tickTps == 0) zero--;
+  bool stopped = zero < trace.size();
+  size_t lastTick = trace.size() - 1;
+  while (lastTick > 0 && trace[lastTick - 1].edges == trace.back().edges) lastTick--;
+
+  printf("%-6s ticks: interval average off by %.2f%% settled, ", label, err * 100);
+  bool shouldStop = trace.back().t - trace[lastTick].t > Wheel::STALL_US + 1000000UL / CONTROL_HZ;
+  if (stopped) {
+    printf("zero %.0f ms after the drive stopped, %.0f ms after the last tick\n",
+      (trace[zero].t - trace[lastDriven].t) / 1e3, (trace[zero].t - trace[lastTick].t) / 1e3);
+  } else {
+    printf("still %u ticks/s at the end\n", trace.back().tickTps);
+  }
+  return err <= TICK_SPEED_ERROR && (stopped || !shouldStop);
+}
+
+// First sample at or after t where the wheel runs backwards, in ms after t.
+double reversedAfter(const std::vector<Sample>& trace, uint64_t t) {
+  for (size_t i = 0; i < trace.size(); i++) {
+    if (trace[i].t >= t && trace[i].speed < 0.0) return (trace[i].t - t) / 1e3;
+  }
+  return -1.0;
+}
+
+// How long after t the wheel reported REVERSING, in ms; a brake released
+// and its RUNNING update in the same control period shows none.
+double reversingFor(const std::vector<Sample>& trace, uint64_t t) {
+  size_t n = 0;
+  for (size_t i = 0; i < trace.size(); i++) {
+    if (trace[i].t >= t && trace[i].reversing) n++;
+  }
+  return n * (trace.size() > 1 ? (trace[1].t - trace[0].t) / 1e3 : 0.0);
+}
+
+// Queues bursts of single-command write transactions, each starting as soon
+// as the previous one has cleared the bus.
+unsigned long scheduleCommandBursts(int burst, uint64_t end) {
+  static const uint8_t cmds[] = { CMD_FWD_LEFT, CMD_FWD_RIGHT, CMD_FWD_BOTH };
+  sim::i2cClock(400000);
+  uint64_t spacing = sim::i2cBusTimeUs(2);
+  unsigned long sent = 0;
+  for (uint64_t t = 500000; t < end; t += 2000000) {
+    for (int i = 0; i < burst; i++) {
+      uint8_t cmd[2] = { cmds[i % 3], (uint8_t)(60 + (i * 7) % 150) };
+      sim::at(t + i * spacing, [cmd]() { sim::i2cMasterWrite(I2C_ADDR, cmd, sizeof(cmd)); });
+      sent++;
+    }
+  }
+  return sent;
+}
+
+// The writer stores a counter in the left tps and its complement in the
+// right tps, the way an encoder ISR would update related fields; every
+// snapshot the master reads must hold a matching pair.
+int registerStress(unsigned long reads) {
+  I2C_Slave.rightWheelTPS(0xFFFF);               // a matching pair for the first snapshot
+  I2C_Slave.publish();
+
+  std::atomic<bool> done(false);
+  std::thread writer([&done]() {
+    uint16_t v = 0;
+    while (!done.load(std::memory_order_relaxed)) {
+      I2C_Slave.beginUpdate();
+      I2C_Slave.leftWheelTPS(v);
+      for (volatile int i = 0; i < 20; i++) {}  // widen the window a torn copy would hit
+      I2C_Slave.rightWheelTPS((uint16_t)~v);
+      I2C_Slave.endUpdate();
+      for (volatile int i = 0; i < 100; i++) {} // time between updates
+      v++;
+    }
+  });
+
+  unsigned long torn = 0;
+  unsigned long fresh = 0;
+  uint8_t lastSeq = 0;
+  for (unsigned long i = 0; i < reads; i++) {
+    union RegBuf snap;
+    sim::i2cMasterRead(I2C_ADDR, snap.buffer, REG_SIZE);
+    if (snap.registers.left.tps != (uint16_t)~snap.registers.right.tps) torn++;
+    if (snap.registers.seq != lastSeq) fresh++;
+    lastSeq = snap.registers.seq;
+  }
+  done = true;
+  writer.join();
+
+  printf("registers: %lu snapshots read, %lu new, %lu repeated, %lu torn\n", reads, fresh, reads - fresh, torn);
+  return torn ? 1 : 0;
+}
+
+void runLoop(uint64_t us, uint64_t loopCostUs) {
+  uint64_t end = sim::now() + us;
+  while (sim::now() < end) {
+    loop();
+    sim::advance(loopCostUs);
+  }
+}
+
+
+// Host cost of one PROFILE_SCOPE: two clock reads and a record().
+double probeCostNs() {
+  const int N = 1000000;
+  Profiler p;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; i++) {
+    uint32_t start = hostNanos();
+    p.record(PROBE_LOOP, hostNanos() - start);
+  }
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+}
+
+
+void reportProfile() {
+  printf("profile: %.1f ns per probe on the host; buckets are 0-1, 2-3, 4-7 ... 2048+\n", probeCostNs());
+  for (uint8_t i = 0; i < PROBE_COUNT; i++) {
+    ProbeStats s = Profile.stats(i);
+    printf("  %-10s %s %7lu runs, min %5u max %5u mean %5lu |", reinterpret_cast<const char*>(Profiler::name(i)),
+      Profiler::unit(i), (unsigned long)s.count, s.count ? s.min : 0, s.max,
+      (unsigned long)(s.count ? s.total / s.count : 0));
+    for (int b = 0; b < PROFILE_BUCKETS; b++) printf(" %u", s.hist[b]);
+    printf("\n");
+  }
+}
+
+
+// Selects the control task's profile page, reads it the way the Pi would
+// and compares it with the profiler, then goes back to the registers.
+bool checkProfilePage(uint64_t loopCostUs) {
+  if (!PROFILE_ENABLED) return true;            // the pages read 0
+  uint8_t select[2] = { CMD_SELECT_PAGE, PAGE_PROFILE + PROBE_CONTROL };
+  sim::i2cMasterWrite(I2C_ADDR, select, sizeof(select));
+  runLoop(20000, loopCostUs);
+
+  union RegBuf buf;
+  sim::i2cMasterRead(I2C_ADDR, buf.buffer, REG_SIZE);
+  struct ProfilePage page;
+  memcpy(&page, buf.buffer, sizeof(page));
+  ProbeStats s = Profile.stats(PROBE_CONTROL);
+  // the buckets halve together as they fill, so they hold at most count
+  unsigned long n = 0;
+  bool histOk = true;
+  for (int b = 0; b < PROFILE_BUCKETS; b++) {
+    n += page.hist[b];
+    histOk &= page.hist[b] == s.hist[b];
+  }
+  bool ok = page.probe == PROBE_CONTROL && page.buckets == PROFILE_BUCKETS &&
+            page.min == s.min && page.max == s.max && page.mean == s.total / s.count &&
+            histOk && n > 0 && n <= s.count;
+  printf("i2c:     profile page for %s: %lu runs (%lu in the histogram), min %u max %u mean %u (%s)\n",
+    reinterpret_cast<const char*>(Profiler::name(page.probe)), (unsigned long)s.count, n, page.min, page.max,
+    page.mean, ok ? "matches" : "MISMATCH");
+
+  select[1] = PAGE_REGISTERS;
+  sim::i2cMasterWrite(I2C_ADDR, select, sizeof(select));
+  runLoop(20000, loopCostUs);
+  return ok;
+}
+
+
+// The pose as a master polling it reads it: one 16-byte read of the
+// odometry page.
+bool checkOdometryPage(uint64_t loopCostUs) {
+  uint8_t select[2] = { CMD_SELECT_PAGE, PAGE_ODOMETRY };
+  sim::i2cMasterWrite(I2C_ADDR, select, sizeof(select));
+  runLoop(20000, loopCostUs);
+
+  struct OdometryPage page, live;
+  sim::i2cMasterRead(I2C_ADDR, (uint8_t*)&page, sizeof(page));
+  odometry.page(&live);
+  bool ok = !memcmp(&page, &live, sizeof(page));
+  printf("i2c:     odometry page: x %.1f mm, y %.1f mm, heading %.2f deg, %d mm/s, seq %u (%s)\n",
+    page.x / 1e3, page.y / 1e3, page.heading * (360.0 / 65536), page.velocity, page.seq,
+    ok ? "matches" : "MISMATCH");
+
+  select[1] = PAGE_REGISTERS;
+  sim::i2cMasterWrite(I2C_ADDR, select, sizeof(select));
+  runLoop(20000, loopCostUs);
+  return ok;
+}
+
+
+// Uploads a run of timed segments in one write, the way the Pi would, and
+// follows them on the motion page until the queue has run dry; the
+// register map's depth must then read 0.
+bool checkMotionQueue(uint64_t loopCostUs) {
+  const int16_t SEGMENTS[][3] = { { 300, 200, 0 }, { 300, 300, 0 }, { 300, 200, 1500 }, { 300, 0, 0 } };
+  const int count = sizeof(SEGMENTS) / sizeof(SEGMENTS[0]);
+  uint8_t upload[count * 7];
+  for (int i = 0; i < count; i++) {
+    uint8_t* c = &upload[i * 7];
+    c[0] = CMD_SEG_TIMED;
+    for (int f = 0; f < 3; f++) {
+      c[1 + 2 * f] = SEGMENTS[i][f] & 0xFF;
+      c[2 + 2 * f] = (SEGMENTS[i][f] >> 8) & 0xFF;
+    }
+  }
+  uint8_t select[2] = { CMD_SELECT_PAGE, PAGE_MOTION };
+  sim::i2cMasterWrite(I2C_ADDR, upload, sizeof(upload));
+  sim::i2cMasterWrite(I2C_ADDR, select, sizeof(select));
+  runLoop(20000, loopCostUs);
+
+  struct MotionPage page;
+  bool ordered = true;
+  int reads = 0;
+  uint16_t last = 0;
+  uint64_t until = sim::now() + count * 1000000ULL;
+  do {
+    sim::i2cMasterRead(I2C_ADDR, (uint8_t*)&page, sizeof(page));
+    ordered &= page.segment >= last && page.segment <= last + 1 && page.depth == count - page.segment;
+    last = page.segment;
+    reads++;
+    runLoop(50000, loopCostUs);
+  } while ((page.flags & MOTION_FLAG_RUNNING) && sim::now() < until);
+
+  select[1] = PAGE_REGISTERS;
+  sim::i2cMasterWrite(I2C_ADDR, select, sizeof(select));
+  runLoop(20000, loopCostUs);
+  union RegBuf regs;
+  sim::i2cMasterRead(I2C_ADDR, regs.buffer, REG_SIZE);
+  bool ok = ordered && page.segment == count && page.queued == count && regs.registers.motionDepth == 0;
+  printf("i2c:     motion queue: %d segments in one %u-byte write, %u of %u run in order over %d page reads (%s)\n",
+    count, (unsigned)sizeof(upload), page.segment, page.queued, reads, ok ? "ok" : "MISMATCH");
+  return ok;
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  Options opt = parseArgs(argc, argv);
+  if (opt.regReads) {
+    setup();
+    return registerStress(opt.regReads);
+  }
+
+  sim::MotorParams leftParams;
+  sim::MotorParams rightParams;
+  rightParams.gain = 0.95;                      // the right gearbox is a little stiffer
+  sim::Motor& left = sim::addMotor("Left", LEFT_PWM, LEFT_DIR1, LEFT_DIR2, LEFT_ENC, leftParams);
+  sim::Motor& right = sim::addMotor("Right", RIGHT_PWM, RIGHT_DIR1, RIGHT_DIR2, RIGHT_ENC, rightParams);
+
+  // start the motors after a second; they stop on their own after RUN_TIME
+  sim::pressButton(A_BTN, 1000000ULL, 50000ULL);
+
+  uint64_t end = (uint64_t)(opt.seconds * 1e6);
+  unsigned long sent = opt.burst > 0 ? scheduleCommandBursts(opt.burst, end) : 0;
+  const uint64_t REVERSE_AT = 4000000ULL;
+  if (opt.reverse) {
+    sim::at(REVERSE_AT, []() {
+      uint8_t cmd[2] = { CMD_REV_BOTH, 100 };
+      sim::i2cMasterWrite(I2C_ADDR, cmd, sizeof(cmd));
+    });
+  }
+  std::vector<Sample> leftTrace;
+  std::vector<Sample> rightTrace;
+  // 20 Hz register poll, the rate the Pi reads at
+  unsigned long polls = 0;
+  union RegBuf regs;
+  memset(&regs, 0, sizeof(regs));
+  std::function<void()> poll = [&]() {
+    sim::i2cMasterRead(I2C_ADDR, regs.buffer, REG_SIZE);
+    polls++;
+    sim::at(sim::now() + 50000, poll);
+  };
+  sim::at(50000, poll);
+
+  std::function<void()> sample = [&]() {
+    Wheel* lw = I2C_Slave.leftWheel();          // none before setup()
+    Wheel* rw = I2C_Slave.rightWheel();
+    Sample l = { sim::now(), drive(LEFT_PWM, LEFT_DIR1, LEFT_DIR2), left.speed(), lw ? lw->tickTPS() : 0U,
+                 left.edges(), lw && lw->state() == Wheel::REVERSING };
+    Sample r = { sim::now(), drive(RIGHT_PWM, RIGHT_DIR1, RIGHT_DIR2), right.speed(), rw ? rw->tickTPS() : 0U,
+                 right.edges(), rw && rw->state() == Wheel::REVERSING };
+    leftTrace.push_back(l);
+    rightTrace.push_back(r);
+    sim::at(sim::now() + 1000, sample);
+  };
+  sim::at(0, sample);
+
+  uint64_t loops = 0;
+  uint64_t loopSimTotal = 0;
+  uint64_t loopSimMax = 0;
+  uint64_t loopHostNs = 0;
+  uint64_t reverseLoopMax = 0;                  // longest pass in the second after the reversal
+
+  std::chrono::steady_clock::time_point wall0 = std::chrono::steady_clock::now();
+
+  setup();
+  while (sim::now() < end) {
+    uint64_t t0 = sim::now();
+    std::chrono::steady_clock::time_point h0 = std::chrono::steady_clock::now();
+    loop();
+    loopHostNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - h0).count();
+    sim::advance(opt.loopCostUs);
+
+    uint64_t dt = sim::now() - t0;
+    loops++;
+    loopSimTotal += dt;
+    if (dt > loopSimMax) loopSimMax = dt;
+    if (t0 >= REVERSE_AT && t0 < REVERSE_AT + 1000000ULL && dt > reverseLoopMax) reverseLoopMax = dt;
+  }
+
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+
+  if (opt.csv) {
+    FILE* f = fopen(opt.csv, "w");
+    if (!f) {
+      perror(opt.csv);
+      return 1;
+    }
+    fprintf(f, "t_ms,left_drive,left_speed,right_drive,right_speed\n");
+    for (size_t i = 0; i < leftTrace.size(); i++) {
+      fprintf(f, "%.3f,%d,%.2f,%d,%.2f\n", leftTrace[i].t / 1e3,
+        leftTrace[i].drive, leftTrace[i].speed, rightTrace[i].drive, rightTrace[i].speed);
+    }
+    fclose(f);
+  }
+
+  printf("simulated %.3f s in %.3f s (%.0fx real time)\n", sim::now() / 1e6, wall, sim::now() / 1e6 / wall);
+  printf("loop():  %llu passes, mean %.1f us, max %.3f ms (simulated), host %.0f ns/pass\n",
+    (unsigned long long)loops, (double)loopSimTotal / loops, loopSimMax / 1e3, (double)loopHostNs / loops);
+  for (std::map<std::string, sim::IsrStats>::const_iterator it = sim::isrStats().begin();
+       it != sim::isrStats().end(); ++it) {
+    printf("ISR %-14s %8llu calls, host mean %.0f ns, max %llu ns\n", it->first.c_str(),
+      (unsigned long long)it->second.calls, (double)it->second.totalNs / it->second.calls,
+      (unsigned long long)it->second.maxNs);
+  }
+  for (uint8_t i = 0; i < scheduler.count(); i++) {
+    const Scheduler<TASK_COUNT>::Task& t = scheduler.task(i);
+    printf("task %-10s %3lu Hz, %6u runs, %u overruns\n", reinterpret_cast<const char*>(t.name),
+      1000000UL / t.period, t.runs, t.overruns);
+  }
+  reportProfile();
+  printf("serial:  %.3f ms stalled on a full TX buffer\n", sim::serialStallUs() / 1e3);
+  size_t notes = 0;
+  for (size_t i = 0; i < sim::tones().size(); i++) if (sim::tones()[i].frequency) notes++;
+  printf("piezo:   %lu notes played, %u tunes dropped\n", (unsigned long)notes, piezoDropped());
+  double leftSettle = reportSettling("Left", leftTrace);
+  double rightSettle = reportSettling("Right", rightTrace);
+  bool tickFilterOk = reportTickFilter("Left", leftTrace);
+  tickFilterOk = reportTickFilter("Right", rightTrace) && tickFilterOk;
+
+  bool reversingOk = true;
+  if (opt.reverse) {
+    double leftReversing = reversingFor(leftTrace, REVERSE_AT);
+    double rightReversing = reversingFor(rightTrace, REVERSE_AT);
+    printf("reverse: left turned after %.0f ms, right after %.0f ms, longest loop() pass %.3f ms\n",
+      reversedAfter(leftTrace, REVERSE_AT), reversedAfter(rightTrace, REVERSE_AT), reverseLoopMax / 1e3);
+    printf("         REVERSING for %.0f ms left, %.0f ms right\n", leftReversing, rightReversing);
+    reversingOk = leftReversing > 0.0 && rightReversing > 0.0;
+  }
+
+  sim::i2cMasterRead(I2C_ADDR, regs.buffer, REG_SIZE);
+  // the counts are published each control period, so a wheel still turning
+  // can be up to a period's edges ahead of them
+  uint32_t leftBehind = (uint32_t)left.edges() - regs.registers.leftTelemetry.ticks;
+  uint32_t rightBehind = (uint32_t)right.edges() - regs.registers.rightTelemetry.ticks;
+  bool ticksOk = leftBehind <= (uint32_t)(fabs(left.speed()) / CONTROL_HZ) + 1 &&
+                 rightBehind <= (uint32_t)(fabs(right.speed()) / CONTROL_HZ) + 1;
+  printf("regs:    %lu polls at 20 Hz, map v%u, status 0x%02x, ticks %lu/%lu left, %lu/%lu right (%s)\n",
+    polls, regs.registers.version, regs.registers.status,
+    (unsigned long)regs.registers.leftTelemetry.ticks, (unsigned long)left.edges(),
+    (unsigned long)regs.registers.rightTelemetry.ticks, (unsigned long)right.edges(),
+    !ticksOk ? "MISMATCH" : (leftBehind || rightBehind ? "within a control period" : "exact"));
+  if (!ticksOk || !tickFilterOk || !reversingOk) return 1;
+  if (!checkProfilePage(opt.loopCostUs)) return 1;
+  if (!checkOdometryPage(opt.loopCostUs)) return 1;
+  if (opt.burst == 0 && !opt.reverse && (leftSettle > SETTLE_LIMIT_MS || rightSettle > SETTLE_LIMIT_MS)) {
+    printf("settle:  over the %.0f ms limit past the ramp\n", SETTLE_LIMIT_MS);
+    return 1;
+  }
+
+  if (opt.burst > 0) {
+    // let loop() drain whatever is still queued; the page checks sent four more
+    while (I2C_Slave.commandsExecuted() + I2C_Slave.commandOverflows() < sent + 4 && sim::now() < end + 60000000ULL) {
+      runLoop(opt.loopCostUs, opt.loopCostUs);
+    }
+    unsigned long lost = sent + 4 - I2C_Slave.commandsExecuted();
+    printf("i2c:     %lu commands sent in bursts of %d, %lu executed, %u overflows, %u errors, %lu lost\n",
+      sent, opt.burst, I2C_Slave.commandsExecuted(), I2C_Slave.commandOverflows(), I2C_Slave.commandErrors(), lost);
+    if (lost) return 1;
+  }
+  if (!checkMotionQueue(opt.loopCostUs)) return 1;
+  return 0;
+}
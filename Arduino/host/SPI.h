@@ -0,0 +1,46 @@
+// SPI.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Host stand-in for the Arduino SPI library. Nothing simulated sits on SPI;
+// this only lets drivers that include SPI.h for an optional SPI mode build.
+
+#ifndef SPI_H_
+#define SPI_H_
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define SPI_HAS_TRANSACTION 1
+
+class SPISettings {
+
+  public:
+
+    SPISettings() {}
+    SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) { (void)clock; (void)bitOrder; (void)dataMode; }
+};
+
+
+class SPIClass {
+
+  public:
+
+    void begin() {}
+    void end() {}
+    void beginTransaction(SPISettings settings) { (void)settings; }
+    void endTransaction() {}
+    uint8_t transfer(uint8_t data) { (void)data; return 0xFF; }   // nothing answers
+};
+
+extern SPIClass SPI;
+
+#endif // SPI_H_
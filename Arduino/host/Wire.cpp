@@ -0,0 +1,143 @@
+// Wire.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#include <Wire.h>
+#include "sim.h"
+
+
+TwoWire Wire;
+
+
+TwoWire::TwoWire() :
+  _slaveAddress(0),
+  _txAddress(0),
+  _txLen(0),
+  _rxLen(0),
+  _rxPos(0),
+  _onReceive(0),
+  _onRequest(0)
+{
+}
+
+
+void TwoWire::begin() {
+  _slaveAddress = 0;
+}
+
+
+void TwoWire::begin(uint8_t address) {
+  _slaveAddress = address;
+}
+
+
+void TwoWire::end() {
+  _slaveAddress = 0;
+}
+
+
+void TwoWire::setClock(uint32_t hz) {
+  sim::i2cClock(hz);
+}
+
+
+void TwoWire::beginTransmission(uint8_t address) {
+  _txAddress = address;
+  _txLen = 0;
+}
+
+
+uint8_t TwoWire::endTransmission(uint8_t sendStop) {
+  (void)sendStop;
+  sim::I2CDevice* dev = sim::findI2CDevice(_txAddress);
+  sim::I2CStats& stats = sim::i2cStats();
+  uint64_t busUs = sim::i2cBusTimeUs(dev ? _txLen : 0);
+  stats.transactions++;
+  stats.bytes += _txLen;
+  stats.busUs += busUs;
+  sim::advance(busUs);
+  if (!dev) return 2;                           // NACK on address
+  dev->receive(_txBuf, _txLen);
+  _txLen = 0;
+  return 0;
+}
+
+
+uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop) {
+  (void)sendStop;
+  if (quantity > BUFFER_LENGTH) quantity = BUFFER_LENGTH;
+  sim::I2CDevice* dev = sim::findI2CDevice((uint8_t)address);
+  _rxPos = 0;
+  _rxLen = dev ? dev->request(_rxBuf, quantity) : 0;
+  sim::I2CStats& stats = sim::i2cStats();
+  uint64_t busUs = sim::i2cBusTimeUs(_rxLen);
+  stats.transactions++;
+  stats.bytes += _rxLen;
+  stats.busUs += busUs;
+  sim::advance(busUs);
+  return (uint8_t)_rxLen;
+}
+
+
+size_t TwoWire::write(uint8_t data) {
+  if (_txLen >= BUFFER_LENGTH) return 0;
+  _txBuf[_txLen++] = data;
+  return 1;
+}
+
+
+size_t TwoWire::write(const uint8_t* data, size_t n) {
+  size_t i = 0;
+  while (i < n && write(data[i])) i++;
+  return i;
+}
+
+
+int TwoWire::available() {
+  return (int)(_rxLen - _rxPos);
+}
+
+
+int TwoWire::read() {
+  return _rxPos < _rxLen ? _rxBuf[_rxPos++] : -1;
+}
+
+
+int TwoWire::peek() {
+  return _rxPos < _rxLen ? _rxBuf[_rxPos] : -1;
+}
+
+
+void TwoWire::onReceive(void (*handler)(int)) {
+  _onReceive = handler;
+}
+
+
+void TwoWire::onRequest(void (*handler)(void)) {
+  _onRequest = handler;
+}
+
+
+bool TwoWire::slaveReceive(const uint8_t* data, size_t n) {
+  if (n > BUFFER_LENGTH) n = BUFFER_LENGTH;
+  memcpy(_rxBuf, data, n);
+  _rxLen = n;
+  _rxPos = 0;
+  if (_onReceive) {
+    void (*handler)(int) = _onReceive;
+    sim::runIsr("TWI receive", [handler, n]() { handler((int)n); });
+  }
+  return true;
+}
+
+
+size_t TwoWire::slaveRequest(uint8_t* buf, size_t n) {
+  _txLen = 0;
+  if (_onRequest) sim::runIsr("TWI request", _onRequest);
+  size_t sent = _txLen < n ? _txLen : n;
+  memcpy(buf, _txBuf, sent);
+  for (size_t i = sent; i < n; i++) buf[i] = 0xFF;   // master clocks out an idle bus
+  _txLen = 0;
+  return sent;
+}
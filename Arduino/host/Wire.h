@@ -0,0 +1,68 @@
+// Wire.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Host stand-in for the Arduino TwoWire library. As master it talks to the
+// simulated devices registered with sim::addI2CDevice() and blocks for the
+// modeled bus time; as slave its callbacks are driven by
+// sim::i2cMasterWrite() / sim::i2cMasterRead().
+
+#ifndef WIRE_H_
+#define WIRE_H_
+
+#include <Arduino.h>
+
+#define BUFFER_LENGTH 32
+
+class TwoWire {
+
+  public:
+
+    TwoWire();
+
+    void begin();                               // as master
+    void begin(uint8_t address);                // as slave
+    void begin(int address) { begin((uint8_t)address); }
+    void end();
+    void setClock(uint32_t hz);
+
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+    uint8_t endTransmission(uint8_t sendStop = true);
+    uint8_t requestFrom(int address, int quantity, int sendStop = true);
+
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* data, size_t n);
+    size_t write(int data) { return write((uint8_t)data); }
+    int available();
+    int read();
+    int peek();
+
+    void onReceive(void (*handler)(int));
+    void onRequest(void (*handler)(void));
+
+    // simulator side of the slave role
+    uint8_t slaveAddress() const { return _slaveAddress; }
+    bool slaveReceive(const uint8_t* data, size_t n);
+    size_t slaveRequest(uint8_t* buf, size_t n);
+
+  private:
+
+    uint8_t _slaveAddress;
+
+    uint8_t _txAddress;
+    uint8_t _txBuf[BUFFER_LENGTH];
+    size_t _txLen;
+
+    uint8_t _rxBuf[BUFFER_LENGTH];
+    size_t _rxLen;
+    size_t _rxPos;
+
+    void (*_onReceive)(int);
+    void (*_onRequest)(void);
+};
+
+extern TwoWire Wire;
+
+#endif // WIRE_H_
@@ -0,0 +1,242 @@
+// avr_ops.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Stand-ins for float and the fixed-width integer types that count every
+// arithmetic operation, for estimating what a kernel costs on the AVR
+// without the board. A library source is compiled a second time with its
+// types swapped for these (#define float CountedFloat, and so on), and
+// the counts are priced with the cycle costs below.
+//
+// The integer stand-ins also follow the AVR's rules rather than the
+// host's: int is 16 bits, so int16_t op int16_t is done in 16 bits and
+// wraps there. Code that only works because the host widens to 32 bits
+// gives different answers when counted, and the benches check for that.
+// Integer literals must fit the AVR int (write L or U suffixes as the AVR
+// needs them), and the stand-ins abort on one that doesn't.
+//
+// Costs are cycles on an ATmega328 with its hardware multiplier: the float
+// ones are avr-libc's published averages for its float routines, the
+// integer ones what avr-gcc emits, including the call into __mulhisi3 and
+// __mulsi3. Loads, stores and loop overhead are not counted for either.
+
+#ifndef AVR_OPS_H_
+#define AVR_OPS_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <type_traits>
+
+namespace avr {
+
+enum Op {
+  FLOAT_ADD, FLOAT_MUL, FLOAT_DIV, FLOAT_SQRT, FLOAT_CMP,
+  ADD16, ADD32,                                 // also subtract, negate, compare, and, or
+  MUL16,                                        // 16 x 16 -> 16
+  MUL16_32,                                     // 16 x 16 -> 32, operands widened from 16 bits
+  MUL32,                                        // 32 x 32 -> 32
+  SHIFT16, SHIFT32,                             // counted per bit position moved, after whole bytes
+  OP_COUNT
+};
+
+const char* const OP_NAMES[OP_COUNT] = {
+  "float +", "float *", "float /", "sqrt", "float cmp",
+  "int16 +", "int32 +", "16x16->16", "16x16->32", "32x32", "int16 >>", "int32 >>"
+};
+
+const uint16_t OP_CYCLES[OP_COUNT] = {
+  110, 140, 470, 490, 50,
+  2, 4, 8, 24, 60, 2, 4
+};
+
+struct Counts {
+  unsigned long n[OP_COUNT];
+
+  Counts() { clear(); }
+
+  void clear() {
+    for (int i = 0; i < OP_COUNT; i++) n[i] = 0;
+  }
+
+  double cycles() const {
+    double c = 0;
+    for (int i = 0; i < OP_COUNT; i++) c += (double)n[i] * OP_CYCLES[i];
+    return c;
+  }
+};
+
+inline Counts& counts() {
+  static Counts c;
+  return c;
+}
+
+inline void count(Op op, unsigned long k = 1) {
+  counts().n[op] += k;
+}
+
+
+class CountedFloat {
+
+  public:
+
+    CountedFloat() : v(0) {}
+    CountedFloat(double x) : v((float)x) {}
+
+    explicit operator float() const { return v; }
+
+    CountedFloat operator-() const { return CountedFloat(-v); }
+
+    CountedFloat& operator+=(CountedFloat o) { count(FLOAT_ADD); v += o.v; return *this; }
+    CountedFloat& operator-=(CountedFloat o) { count(FLOAT_ADD); v -= o.v; return *this; }
+    CountedFloat& operator*=(CountedFloat o) { count(FLOAT_MUL); v *= o.v; return *this; }
+    CountedFloat& operator/=(CountedFloat o) { count(FLOAT_DIV); v /= o.v; return *this; }
+
+    friend CountedFloat operator+(CountedFloat a, CountedFloat b) { return a += b; }
+    friend CountedFloat operator-(CountedFloat a, CountedFloat b) { return a -= b; }
+    friend CountedFloat operator*(CountedFloat a, CountedFloat b) { return a *= b; }
+    friend CountedFloat operator/(CountedFloat a, CountedFloat b) { return a /= b; }
+
+    friend bool operator==(CountedFloat a, CountedFloat b) { count(FLOAT_CMP); return a.v == b.v; }
+    friend bool operator!=(CountedFloat a, CountedFloat b) { count(FLOAT_CMP); return a.v != b.v; }
+    friend bool operator<(CountedFloat a, CountedFloat b) { count(FLOAT_CMP); return a.v < b.v; }
+    friend bool operator>(CountedFloat a, CountedFloat b) { count(FLOAT_CMP); return a.v > b.v; }
+
+    friend CountedFloat sqrt(CountedFloat a) { count(FLOAT_SQRT); return CountedFloat(sqrtf(a.v)); }
+
+  private:
+
+    float v;
+};
+
+
+// The AVR type of a host arithmetic operand: int and everything narrower
+// is the 16-bit int, long is 32 bits.
+template <typename T>
+struct AvrType {
+  typedef typename std::conditional<(sizeof(T) < sizeof(int)) || std::is_same<T, int>::value, int16_t,
+    typename std::conditional<std::is_same<T, unsigned>::value, uint16_t,
+    typename std::conditional<std::is_signed<T>::value, int32_t, uint32_t>::type>::type>::type type;
+};
+
+// Usual arithmetic conversions with a 16-bit int
+template <typename A, typename B>
+struct Promote {
+  static const bool wide = sizeof(A) == 4 || sizeof(B) == 4;
+  static const bool isUnsigned = wide ? (std::is_same<A, uint32_t>::value || std::is_same<B, uint32_t>::value)
+                                      : (std::is_same<A, uint16_t>::value || std::is_same<B, uint16_t>::value);
+  typedef typename std::conditional<wide, typename std::conditional<isUnsigned, uint32_t, int32_t>::type,
+    typename std::conditional<isUnsigned, uint16_t, int16_t>::type>::type type;
+};
+
+template <typename T>
+class Int {
+
+  public:
+
+    T v;
+    bool narrow;                                // a 32-bit value widened from 16 bits, for MUL16_32
+
+    Int() : v(0), narrow(sizeof(T) == 2) {}
+
+    template <typename U, typename = typename std::enable_if<std::is_arithmetic<U>::value>::type>
+    Int(U x) : v((T)x), narrow(sizeof(T) == 2 || ((double)x >= -32768 && (double)x <= 65535)) {}
+
+    template <typename U>
+    Int(const Int<U>& x) : v((T)x.v), narrow(sizeof(T) == 2 || sizeof(U) == 2 || x.narrow) {}
+
+    template <typename U, typename = typename std::enable_if<std::is_arithmetic<U>::value>::type>
+    explicit operator U() const { return (U)v; }
+
+    Int operator-() const { count(sizeof(T) == 4 ? ADD32 : ADD16); return Int((T)(0 - v), false); }
+
+    template <typename U> Int& operator+=(const U& o) { return *this = *this + o; }
+    template <typename U> Int& operator-=(const U& o) { return *this = *this - o; }
+    template <typename U> Int& operator*=(const U& o) { return *this = *this * o; }
+    Int& operator>>=(int n) { return *this = *this >> n; }
+    Int& operator<<=(int n) { return *this = *this << n; }
+
+    Int operator>>(int n) const { shiftCost(n); return Int((T)(v >> n), false); }
+    Int operator<<(int n) const { shiftCost(n); return Int((T)((typename std::make_unsigned<T>::type)v << n), false); }
+
+    Int(T x, bool n) : v(x), narrow(n) {}
+
+  private:
+
+    void shiftCost(int n) const {
+      count(sizeof(T) == 4 ? SHIFT32 : SHIFT16, n % 8 + (n >= 8 ? 1 : 0));
+    }
+};
+
+template <typename T> struct IsInt { static const bool value = false; };
+template <typename T> struct IsInt<Int<T> > { static const bool value = true; typedef T type; };
+
+// Either operand may be a stand-in or a plain host number
+template <typename X> struct Operand { typedef typename AvrType<X>::type type; };
+template <typename T> struct Operand<Int<T> > { typedef T type; };
+
+template <typename T>
+Int<T> operand(const Int<T>& x) { return x; }
+
+template <typename X>
+Int<typename AvrType<X>::type> operand(const X& x) {
+  typedef typename AvrType<X>::type A;
+  if ((long long)(A)x != (long long)x) {
+    fprintf(stderr, "avr_ops: %lld does not fit its AVR type\n", (long long)x);
+    abort();
+  }
+  return Int<A>(x);
+}
+
+template <typename A, typename B>
+struct Result {
+  typedef Int<typename Promote<typename Operand<A>::type, typename Operand<B>::type>::type> type;
+};
+
+#define AVR_OPS_BINARY(OP, COST16, COST32, EXPR)                                                      \
+  template <typename A, typename B,                                                                   \
+    typename = typename std::enable_if<IsInt<A>::value || IsInt<B>::value>::type>                     \
+  typename Result<A, B>::type operator OP(const A& a, const B& b) {                                   \
+    typedef typename Result<A, B>::type R;                                                            \
+    R x = operand(a), y = operand(b);                                                                 \
+    count(sizeof(x.v) == 4 ? (COST32) : (COST16));                                                    \
+    return R(EXPR, false);                                                                            \
+  }
+
+#define AVR_OPS_COMPARE(OP)                                                                           \
+  template <typename A, typename B,                                                                   \
+    typename = typename std::enable_if<IsInt<A>::value || IsInt<B>::value>::type>                     \
+  bool operator OP(const A& a, const B& b) {                                                          \
+    typedef typename Result<A, B>::type R;                                                            \
+    R x = operand(a), y = operand(b);                                                                 \
+    count(sizeof(x.v) == 4 ? ADD32 : ADD16);                                                          \
+    return x.v OP y.v;                                                                                \
+  }
+
+AVR_OPS_BINARY(+, ADD16, ADD32, (decltype(x.v))(x.v + y.v))
+AVR_OPS_BINARY(-, ADD16, ADD32, (decltype(x.v))(x.v - y.v))
+AVR_OPS_BINARY(&, ADD16, ADD32, (decltype(x.v))(x.v & y.v))
+AVR_OPS_BINARY(|, ADD16, ADD32, (decltype(x.v))(x.v | y.v))
+AVR_OPS_BINARY(*, MUL16, (x.narrow && y.narrow ? MUL16_32 : MUL32),
+  (decltype(x.v))((typename std::make_unsigned<decltype(x.v)>::type)x.v * (typename std::make_unsigned<decltype(x.v)>::type)y.v))
+
+AVR_OPS_COMPARE(==)
+AVR_OPS_COMPARE(!=)
+AVR_OPS_COMPARE(<)
+AVR_OPS_COMPARE(<=)
+AVR_OPS_COMPARE(>)
+AVR_OPS_COMPARE(>=)
+
+#undef AVR_OPS_BINARY
+#undef AVR_OPS_COMPARE
+
+typedef Int<int16_t> CountedInt16;
+typedef Int<uint16_t> CountedUint16;
+typedef Int<int32_t> CountedInt32;
+typedef Int<uint32_t> CountedUint32;
+
+} // namespace avr
+
+#endif // AVR_OPS_H_
@@ -0,0 +1,257 @@
+// fusion_lanes.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// The float orientation filters (quaternionFilters.cpp) for the host, several
+// at a time: each lane of a FilterLanes is a filter with its own quaternion
+// and gains, and every update feeds the same sample to all of them, which
+// is what a gain sweep over a log does. The lanes are GCC vector types, so
+// each operation of the update is one SIMD instruction for all of them:
+// eight with AVX, four, in SSE registers, without.
+//
+// The updates repeat the library's arithmetic operation for operation, so
+// lane i gives bit for bit the quaternion an OrientationFilter<float,
+// Algorithm> with the same gains gives updating one sample at a time,
+// provided this is compiled without floating-point contraction
+// (-ffp-contract=off), as the library is for the board. The accelerometer
+// and magnetometer are normalised once, not per lane, since every lane
+// would get the same.
+//
+//   FilterLanes<Mahony> lanes;
+//   for (int i = 0; i < FilterLanes<Mahony>::WIDTH; i++) lanes.setGains(i, kp[i], ki[i]);
+//   lanes.update(sample);
+//   float w = lanes.q(0)[i];           // lane i's w
+
+#ifndef FUSION_LANES_H_
+#define FUSION_LANES_H_
+
+#include <OrientationFilter.h>
+#include <math.h>
+
+#ifdef __AVX__
+#define FUSION_LANES 8
+#else
+#define FUSION_LANES 4
+#endif
+
+// A float per lane
+typedef float FusionLane __attribute__((vector_size(FUSION_LANES * sizeof(float))));
+
+struct FusionLaneState {
+  FusionLane q[4];
+  FusionLane eInt[3];
+  FusionLane beta, kp, ki;
+};
+
+// A sample's accelerometer and magnetometer normalised, as every lane uses
+// them; false if either is zero, when the filters skip the sample.
+inline bool normaliseMeasurements(QuaternionSample& r) {
+  float norm = sqrt(r.ax * r.ax + r.ay * r.ay + r.az * r.az);
+  if (norm == 0.0f) return false;
+  norm = 1.0f / norm;
+  r.ax *= norm;
+  r.ay *= norm;
+  r.az *= norm;
+  norm = sqrt(r.mx * r.mx + r.my * r.my + r.mz * r.mz);
+  if (norm == 0.0f) return false;
+  norm = 1.0f / norm;
+  r.mx *= norm;
+  r.my *= norm;
+  r.mz *= norm;
+  return true;
+}
+
+inline FusionLane laneSqrt(FusionLane v) {
+  FusionLane r;
+  for (int i = 0; i < FUSION_LANES; i++) r[i] = sqrtf(v[i]);
+  return r;
+}
+
+// One update per algorithm, with r already through normaliseMeasurements(),
+// leaving q to be normalised
+template <typename Algorithm> struct LaneStep;
+
+template <> struct LaneStep<Madgwick> {
+  static void step(FusionLaneState& f, const QuaternionSample& r) {
+    const float ax = r.ax, ay = r.ay, az = r.az, gx = r.gx, gy = r.gy, gz = r.gz, mx = r.mx, my = r.my, mz = r.mz;
+    const float deltat = r.deltat;
+    const FusionLane beta = f.beta;
+    FusionLane q1 = f.q[0], q2 = f.q[1], q3 = f.q[2], q4 = f.q[3];
+    FusionLane norm;
+    FusionLane hx, hy, _2bx, _2bz;
+    FusionLane s1, s2, s3, s4;
+    FusionLane qDot1, qDot2, qDot3, qDot4;
+
+    FusionLane _2q1mx, _2q1my, _2q1mz, _2q2mx, _4bx, _4bz;
+    FusionLane _2q1 = 2.0f * q1;
+    FusionLane _2q2 = 2.0f * q2;
+    FusionLane _2q3 = 2.0f * q3;
+    FusionLane _2q4 = 2.0f * q4;
+    FusionLane _2q1q3 = 2.0f * q1 * q3;
+    FusionLane _2q3q4 = 2.0f * q3 * q4;
+    FusionLane q1q1 = q1 * q1;
+    FusionLane q1q2 = q1 * q2;
+    FusionLane q1q3 = q1 * q3;
+    FusionLane q1q4 = q1 * q4;
+    FusionLane q2q2 = q2 * q2;
+    FusionLane q2q3 = q2 * q3;
+    FusionLane q2q4 = q2 * q4;
+    FusionLane q3q3 = q3 * q3;
+    FusionLane q3q4 = q3 * q4;
+    FusionLane q4q4 = q4 * q4;
+
+    _2q1mx = 2.0f * q1 * mx;
+    _2q1my = 2.0f * q1 * my;
+    _2q1mz = 2.0f * q1 * mz;
+    _2q2mx = 2.0f * q2 * mx;
+    hx = mx * q1q1 - _2q1my * q4 + _2q1mz * q3 + mx * q2q2 + _2q2 * my * q3 +
+         _2q2 * mz * q4 - mx * q3q3 - mx * q4q4;
+    hy = _2q1mx * q4 + my * q1q1 - _2q1mz * q2 + _2q2mx * q3 - my * q2q2 + my * q3q3 + _2q3 * mz * q4 - my * q4q4;
+    _2bx = laneSqrt(hx * hx + hy * hy);
+    _2bz = -_2q1mx * q3 + _2q1my * q2 + mz * q1q1 + _2q2mx * q4 - mz * q2q2 + _2q3 * my * q4 - mz * q3q3 + mz * q4q4;
+    _4bx = 2.0f * _2bx;
+    _4bz = 2.0f * _2bz;
+
+    s1 = -_2q3 * (2.0f * q2q4 - _2q1q3 - ax) + _2q2 * (2.0f * q1q2 + _2q3q4 - ay) - _2bz * q3 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (-_2bx * q4 + _2bz * q2) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + _2bx * q3 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+    s2 = _2q4 * (2.0f * q2q4 - _2q1q3 - ax) + _2q1 * (2.0f * q1q2 + _2q3q4 - ay) - 4.0f * q2 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - az) + _2bz * q4 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (_2bx * q3 + _2bz * q1) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + (_2bx * q4 - _4bz * q2) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+    s3 = -_2q1 * (2.0f * q2q4 - _2q1q3 - ax) + _2q4 * (2.0f * q1q2 + _2q3q4 - ay) - 4.0f * q3 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - az) + (-_4bx * q3 - _2bz * q1) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (_2bx * q2 + _2bz * q4) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + (_2bx * q1 - _4bz * q3) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+    s4 = _2q2 * (2.0f * q2q4 - _2q1q3 - ax) + _2q3 * (2.0f * q1q2 + _2q3q4 - ay) + (-_4bx * q4 + _2bz * q2) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (-_2bx * q1 + _2bz * q3) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + _2bx * q2 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+    norm = laneSqrt(s1 * s1 + s2 * s2 + s3 * s3 + s4 * s4);
+    norm = 1.0f / norm;
+    s1 *= norm;
+    s2 *= norm;
+    s3 *= norm;
+    s4 *= norm;
+
+    qDot1 = 0.5f * (-q2 * gx - q3 * gy - q4 * gz) - beta * s1;
+    qDot2 = 0.5f * (q1 * gx + q3 * gz - q4 * gy) - beta * s2;
+    qDot3 = 0.5f * (q1 * gy - q2 * gz + q4 * gx) - beta * s3;
+    qDot4 = 0.5f * (q1 * gz + q2 * gy - q3 * gx) - beta * s4;
+
+    f.q[0] = q1 + qDot1 * deltat;
+    f.q[1] = q2 + qDot2 * deltat;
+    f.q[2] = q3 + qDot3 * deltat;
+    f.q[3] = q4 + qDot4 * deltat;
+  }
+};
+
+template <> struct LaneStep<Mahony> {
+  static void step(FusionLaneState& f, const QuaternionSample& r) {
+    const float ax = r.ax, ay = r.ay, az = r.az, mx = r.mx, my = r.my, mz = r.mz;
+    const float deltat = r.deltat;
+    FusionLane* eInt = f.eInt;
+    FusionLane q1 = f.q[0], q2 = f.q[1], q3 = f.q[2], q4 = f.q[3];
+    FusionLane hx, hy, bx, bz;
+    FusionLane vx, vy, vz, wx, wy, wz;
+    FusionLane ex, ey, ez;
+    FusionLane gx, gy, gz;
+    FusionLane pa, pb, pc;
+
+    FusionLane q1q1 = q1 * q1;
+    FusionLane q1q2 = q1 * q2;
+    FusionLane q1q3 = q1 * q3;
+    FusionLane q1q4 = q1 * q4;
+    FusionLane q2q2 = q2 * q2;
+    FusionLane q2q3 = q2 * q3;
+    FusionLane q2q4 = q2 * q4;
+    FusionLane q3q3 = q3 * q3;
+    FusionLane q3q4 = q3 * q4;
+    FusionLane q4q4 = q4 * q4;
+
+    hx = 2.0f * mx * (0.5f - q3q3 - q4q4) + 2.0f * my * (q2q3 - q1q4) + 2.0f * mz * (q2q4 + q1q3);
+    hy = 2.0f * mx * (q2q3 + q1q4) + 2.0f * my * (0.5f - q2q2 - q4q4) + 2.0f * mz * (q3q4 - q1q2);
+    bx = laneSqrt((hx * hx) + (hy * hy));
+    bz = 2.0f * mx * (q2q4 - q1q3) + 2.0f * my * (q3q4 + q1q2) + 2.0f * mz * (0.5f - q2q2 - q3q3);
+
+    vx = 2.0f * (q2q4 - q1q3);
+    vy = 2.0f * (q1q2 + q3q4);
+    vz = q1q1 - q2q2 - q3q3 + q4q4;
+    wx = 2.0f * bx * (0.5f - q3q3 - q4q4) + 2.0f * bz * (q2q4 - q1q3);
+    wy = 2.0f * bx * (q2q3 - q1q4) + 2.0f * bz * (q1q2 + q3q4);
+    wz = 2.0f * bx * (q1q3 + q2q4) + 2.0f * bz * (0.5f - q2q2 - q3q3);
+
+    ex = (ay * vz - az * vy) + (my * wz - mz * wy);
+    ey = (az * vx - ax * vz) + (mz * wx - mx * wz);
+    ez = (ax * vy - ay * vx) + (mx * wy - my * wx);
+
+    // The lanes with an integral gain accumulate, the others hold zero
+    const FusionLane zero = {};
+    eInt[0] = f.ki > 0.0f ? eInt[0] + ex : zero;
+    eInt[1] = f.ki > 0.0f ? eInt[1] + ey : zero;
+    eInt[2] = f.ki > 0.0f ? eInt[2] + ez : zero;
+
+    gx = r.gx + f.kp * ex + f.ki * eInt[0];
+    gy = r.gy + f.kp * ey + f.ki * eInt[1];
+    gz = r.gz + f.kp * ez + f.ki * eInt[2];
+
+    pa = q2;
+    pb = q3;
+    pc = q4;
+    q1 = q1 + (-q2 * gx - q3 * gy - q4 * gz) * (0.5f * deltat);
+    q2 = pa + (q1 * gx + pb * gz - pc * gy) * (0.5f * deltat);
+    q3 = pb + (q1 * gy - pa * gz + pc * gx) * (0.5f * deltat);
+    q4 = pc + (q1 * gz + pa * gy - pb * gx) * (0.5f * deltat);
+
+    f.q[0] = q1;
+    f.q[1] = q2;
+    f.q[2] = q3;
+    f.q[3] = q4;
+  }
+};
+
+template <typename Algorithm>
+class FilterLanes {
+
+  public:
+
+    static const int WIDTH = FUSION_LANES;
+
+    // Identity orientation and the default gains in every lane
+    FilterLanes() {
+      QuaternionFilterState defaults;
+      QuaternionFilterInit(defaults);
+      for (int i = 0; i < WIDTH; i++) {
+        setBeta(i, defaults.beta);
+        setGains(i, defaults.kp, defaults.ki);
+      }
+      reset();
+    }
+
+    // Every lane back to the identity orientation, keeping the gains
+    void reset() {
+      const FusionLane zero = {};
+      _state.q[0] = zero + 1.0f;
+      _state.q[1] = _state.q[2] = _state.q[3] = zero;
+      _state.eInt[0] = _state.eInt[1] = _state.eInt[2] = zero;
+    }
+
+    void setBeta(int lane, float beta) { _state.beta[lane] = beta; }
+    void setGains(int lane, float kp, float ki) {
+      _state.kp[lane] = kp;
+      _state.ki[lane] = ki;
+    }
+
+    // Every lane, as OrientationFilter::update(s)
+    void update(QuaternionSample s) {
+      if (!normaliseMeasurements(s)) return;
+      LaneStep<Algorithm>::step(_state, s);
+
+      FusionLane* q = _state.q;
+      FusionLane norm = laneSqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+      norm = 1.0f / norm;
+      q[0] *= norm;
+      q[1] *= norm;
+      q[2] *= norm;
+      q[3] *= norm;
+    }
+
+    // Component i (w, x, y, z) of every lane's quaternion
+    const FusionLane& q(int i) const { return _state.q[i]; }
+
+  private:
+
+    FusionLaneState _state;
+};
+
+#endif // FUSION_LANES_H_
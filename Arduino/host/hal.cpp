@@ -0,0 +1,258 @@
+// hal.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Arduino core API on top of the simulator.
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <chrono>
+#include <stdio.h>
+#include "sim.h"
+
+
+volatile uint8_t TCCR1B = 0;
+
+HostSREG SREG;
+
+HardwareSerial Serial;
+
+SPIClass SPI;
+
+
+unsigned long millis() {
+  return (uint32_t)(sim::now() / 1000ULL);
+}
+
+
+unsigned long micros() {
+  return (uint32_t)sim::now();
+}
+
+
+uint32_t hostNanos() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void delay(unsigned long ms) {
+  sim::advance(ms * 1000ULL);
+}
+
+
+void delayMicroseconds(unsigned int us) {
+  sim::advance(us);
+}
+
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  sim::setPinMode(pin, mode);
+}
+
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  sim::setPin(pin, val ? HIGH : LOW);
+}
+
+
+int digitalRead(uint8_t pin) {
+  return sim::pinLevel(pin);
+}
+
+
+void analogWrite(uint8_t pin, int val) {
+  sim::setPwm(pin, val < 0 ? 0 : (val > 255 ? 255 : val));
+}
+
+
+int analogRead(uint8_t pin) {
+  return sim::pinLevel(pin) ? 1023 : 0;
+}
+
+
+void attachInterrupt(uint8_t interruptNum, void (*isr)(void), int mode) {
+  sim::attach(interruptNum, isr, mode);
+}
+
+
+void detachInterrupt(uint8_t interruptNum) {
+  sim::detach(interruptNum);
+}
+
+
+void noInterrupts() {
+  sim::setInterruptsEnabled(false);
+}
+
+
+void interrupts() {
+  sim::setInterruptsEnabled(true);
+}
+
+
+HostSREG::operator uint8_t() const {
+  return sim::interruptsEnabled() ? 0x80 : 0x00;
+}
+
+
+HostSREG& HostSREG::operator=(uint8_t v) {
+  sim::setInterruptsEnabled((v & 0x80) != 0);
+  return *this;
+}
+
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration) {
+  sim::ToneEvent e = { sim::now(), pin, frequency, duration };
+  sim::recordTone(e);
+}
+
+
+void noTone(uint8_t pin) {
+  sim::ToneEvent e = { sim::now(), pin, 0, 0 };
+  sim::recordTone(e);
+}
+
+
+// ---- Print -----------------------------------------------------------------
+
+size_t Print::write(const uint8_t* buf, size_t n) {
+  size_t i = 0;
+  while (i < n && write(buf[i])) i++;
+  return i;
+}
+
+
+size_t Print::print(const __FlashStringHelper* s) {
+  return write(reinterpret_cast<const char*>(s));
+}
+
+
+size_t Print::print(const String& s) {
+  return write(s.c_str());
+}
+
+
+size_t Print::print(const char* s) {
+  return write(s);
+}
+
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+
+size_t Print::print(unsigned char n, int base) {
+  return printNumber(n, base);
+}
+
+
+size_t Print::print(int n, int base) {
+  return print((long)n, base);
+}
+
+
+size_t Print::print(unsigned int n, int base) {
+  return printNumber(n, base);
+}
+
+
+size_t Print::print(long n, int base) {
+  if (base == DEC && n < 0) return print('-') + printNumber((unsigned long)-n, base);
+  return printNumber((unsigned long)n, base);
+}
+
+
+size_t Print::print(unsigned long n, int base) {
+  return printNumber(n, base);
+}
+
+
+size_t Print::print(double n, int digits) {
+  char buf[40];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write(buf);
+}
+
+
+size_t Print::printNumber(unsigned long n, int base) {
+  char buf[8 * sizeof(long) + 1];
+  char* p = &buf[sizeof(buf) - 1];
+  *p = '\0';
+  if (base < 2) base = 10;
+  do {
+    int d = n % base;
+    *--p = d < 10 ? '0' + d : 'A' + d - 10;
+    n /= base;
+  } while (n);
+  return write(p);
+}
+
+
+size_t Print::println(const __FlashStringHelper* s) { return print(s) + println(); }
+size_t Print::println(const String& s) { return print(s) + println(); }
+size_t Print::println(const char* s) { return print(s) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char n, int base) { return print(n, base) + println(); }
+size_t Print::println(int n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned int n, int base) { return print(n, base) + println(); }
+size_t Print::println(long n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned long n, int base) { return print(n, base) + println(); }
+size_t Print::println(double n, int digits) { return print(n, digits) + println(); }
+size_t Print::println() { return write("\r\n"); }
+
+
+// ---- HardwareSerial ----------------------------------------------------------
+
+namespace {
+
+const int SERIAL_TX_BUFFER_SIZE = 64;
+
+uint64_t _txBusyUntil = 0;                      // when the last queued character leaves the UART
+
+
+uint64_t charTimeUs(unsigned long baud) {
+  return (10ULL * 1000000ULL + baud - 1) / baud;  // start + 8 data + stop
+}
+
+
+int queued(unsigned long baud) {
+  uint64_t now = sim::now();
+  if (_txBusyUntil <= now) return 0;
+  uint64_t ct = charTimeUs(baud);
+  return (int)((_txBusyUntil - now + ct - 1) / ct);
+}
+
+} // namespace
+
+
+int HardwareSerial::availableForWrite() {
+  if (!_baud) return SERIAL_TX_BUFFER_SIZE - 1;
+  return SERIAL_TX_BUFFER_SIZE - 1 - queued(_baud);
+}
+
+
+void HardwareSerial::flush() {
+  if (_baud && _txBusyUntil > sim::now()) {
+    sim::addSerialStall(_txBusyUntil - sim::now());
+    sim::advanceTo(_txBusyUntil);
+  }
+}
+
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (!_baud) return 1;
+  uint64_t ct = charTimeUs(_baud);
+  if (queued(_baud) >= SERIAL_TX_BUFFER_SIZE - 1) {
+    // the AVR core spins until the UDRE interrupt frees a slot
+    uint64_t until = _txBusyUntil - (uint64_t)(SERIAL_TX_BUFFER_SIZE - 2) * ct;
+    sim::addSerialStall(until - sim::now());
+    sim::advanceTo(until);
+  }
+  uint64_t start = _txBusyUntil > sim::now() ? _txBusyUntil : sim::now();
+  _txBusyUntil = start + ct;
+  if (sim::echoSerial && c != '\r') fputc(c, stdout);
+  return 1;
+}
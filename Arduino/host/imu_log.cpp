@@ -0,0 +1,158 @@
+// imu_log.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#include "imu_log.h"
+#include <math.h>
+#include <stdio.h>
+
+namespace sim {
+
+const char* const IMU_MOTION_NAMES[MOTION_COUNT] = { "level", "driving", "tumbling", "tilted start" };
+
+namespace {
+
+const double ACCEL_LSB_PER_G = 16393;           // LSM6 at +-2 g
+const double GYRO_RAD_PER_LSB = 35e-3 * M_PI / 180;   // LSM6 at 1000 dps
+const double MAG_LSB_PER_GAUSS = 6842;          // LIS3MDL at +-4 gauss
+const double EARTH_FIELD[3] = { 0.22, 0, -0.42 };   // gauss, earth frame
+
+struct Quat {
+  double w, x, y, z;
+
+  Quat operator*(const Quat& o) const {
+    return { w * o.w - x * o.x - y * o.y - z * o.z, w * o.x + x * o.w + y * o.z - z * o.y,
+             w * o.y - x * o.z + y * o.w + z * o.x, w * o.z + x * o.y - y * o.x + z * o.w };
+  }
+
+  Quat conj() const { return { w, -x, -y, -z }; }
+
+  Quat normalized() const {
+    double n = sqrt(w * w + x * x + y * y + z * z);
+    return { w / n, x / n, y / n, z / n };
+  }
+
+  // Earth-frame vector v in the body frame
+  void toBody(const double v[3], double out[3]) const {
+    Quat r = conj() * Quat{ 0, v[0], v[1], v[2] } * *this;
+    out[0] = r.x; out[1] = r.y; out[2] = r.z;
+  }
+};
+
+// Deterministic noise, so runs compare
+struct Noise {
+  uint32_t s;
+
+  double uniform() {
+    s = s * 1664525u + 1013904223u;
+    return (s >> 8) / 16777216.0;
+  }
+
+  double gauss(double sigma) {
+    double u = uniform() + 1e-12, v = uniform();
+    return sigma * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+  }
+};
+
+int16_t clamp16(double v) {
+  v = floor(v + 0.5);
+  return (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+}
+
+// Body rate (rad/s) and body acceleration other than gravity (g) at t
+void motionAt(ImuMotion kind, double t, double w[3], double a[3]) {
+  w[0] = w[1] = w[2] = 0;
+  a[0] = a[1] = a[2] = 0;
+  switch (kind) {
+    case MOTION_DRIVING:
+      w[0] = 0.15 * sin(2 * M_PI * 1.3 * t);
+      w[1] = 0.1 * sin(2 * M_PI * 0.9 * t + 1);
+      w[2] = 2.5 * sin(2 * M_PI * 0.2 * t);
+      a[0] = 0.1 * sin(2 * M_PI * 0.5 * t);
+      a[1] = 0.2 * sin(2 * M_PI * 0.2 * t);
+      break;
+    case MOTION_TUMBLING:
+      w[0] = 3 * sin(2 * M_PI * 0.13 * t);
+      w[1] = 2 * cos(2 * M_PI * 0.07 * t);
+      w[2] = 1.5 * sin(2 * M_PI * 0.11 * t + 2);
+      break;
+    default:
+      break;
+  }
+}
+
+} // namespace
+
+
+ImuLog generateImuLog(ImuMotion kind, double seconds, double rateHz, uint32_t seed) {
+  ImuLog log;
+  Noise noise = { seed };
+  const uint16_t dtUs = (uint16_t)(1e6 / rateHz + 0.5);
+  const double dt = dtUs * 1e-6;
+  const double bias[3] = { 0.01, -0.007, 0.004 };
+  Quat q = { 1, 0, 0, 0 };
+  if (kind == MOTION_TILTED) q = { cos(M_PI / 12), sin(M_PI / 12), 0, 0 };
+  const double up[3] = { 0, 0, 1 };
+
+  for (double t = 0; t < seconds; t += dt) {
+    double w[3], lin[3], g[3], m[3];
+    motionAt(kind, t, w, lin);
+
+    // q' = q * (0, w) / 2, in small steps
+    for (int k = 0; k < 8; k++) {
+      double h = dt / 8 / 2;
+      Quat r = q * Quat{ 0, w[0], w[1], w[2] };
+      q = Quat{ q.w + h * r.w, q.x + h * r.x, q.y + h * r.y, q.z + h * r.z }.normalized();
+    }
+
+    ImuLogSample s;
+    s.dtUs = dtUs;
+    q.toBody(up, g);
+    q.toBody(EARTH_FIELD, m);
+    for (int i = 0; i < 3; i++) {
+      s.a[i] = clamp16((g[i] + lin[i] + noise.gauss(0.004)) * ACCEL_LSB_PER_G);
+      s.m[i] = clamp16((m[i] + noise.gauss(0.002)) * MAG_LSB_PER_GAUSS);
+      int16_t counts = clamp16((w[i] + bias[i] + noise.gauss(0.003)) / GYRO_RAD_PER_LSB);
+      s.g[i] = counts * GYRO_RAD_PER_LSB;
+    }
+    s.truth[0] = q.w; s.truth[1] = q.x; s.truth[2] = q.y; s.truth[3] = q.z;
+    log.push_back(s);
+  }
+  return log;
+}
+
+
+bool loadImuLog(const char* path, ImuLog& log) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char line[256];
+  while (fgets(line, sizeof line, f)) {
+    if (line[0] == '#') continue;
+    unsigned dt;
+    int a[3], m[3];
+    ImuLogSample s;
+    int n = sscanf(line, "%u %d %d %d %lf %lf %lf %d %d %d %lf %lf %lf %lf", &dt, &a[0], &a[1], &a[2], &s.g[0],
+                   &s.g[1], &s.g[2], &m[0], &m[1], &m[2], &s.truth[0], &s.truth[1], &s.truth[2], &s.truth[3]);
+    if (n != 10 && n != 14) continue;
+    if (n == 10) s.truth[0] = 0;
+    s.dtUs = (uint16_t)dt;
+    for (int i = 0; i < 3; i++) {
+      s.a[i] = (int16_t)a[i];
+      s.m[i] = (int16_t)m[i];
+    }
+    log.push_back(s);
+  }
+  fclose(f);
+  return true;
+}
+
+
+double quaternionAngleDeg(const double a[4], const double b[4]) {
+  double na = sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2] + a[3] * a[3]);
+  double nb = sqrt(b[0] * b[0] + b[1] * b[1] + b[2] * b[2] + b[3] * b[3]);
+  double d = fabs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]) / (na * nb);
+  return 2 * acos(d > 1 ? 1 : d) * 180 / M_PI;
+}
+
+} // namespace sim
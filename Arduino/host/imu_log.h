@@ -0,0 +1,51 @@
+// imu_log.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// IMU logs for replaying through the orientation filters: generated runs
+// of a MinIMU-9 on the robot, with the LSM6's and LIS3MDL's scales, gyro
+// bias and noise and the true orientation, or recordings read from a file.
+//
+// A recording has one sample per line,
+//
+//   dt_us ax ay az gx gy gz mx my mz [qw qx qy qz]
+//
+// with accelerometer and magnetometer in counts, gyro in rad/s and, when it
+// is known, the true orientation; # starts a comment.
+
+#ifndef IMU_LOG_H_
+#define IMU_LOG_H_
+
+#include <stdint.h>
+#include <vector>
+
+namespace sim {
+
+struct ImuLogSample {
+  uint16_t dtUs;
+  int16_t a[3], m[3];                           // counts
+  double g[3];                                  // rad/s
+  double truth[4];                              // or truth[0] = 0 when unknown
+};
+
+typedef std::vector<ImuLogSample> ImuLog;
+
+enum ImuMotion { MOTION_LEVEL, MOTION_DRIVING, MOTION_TUMBLING, MOTION_TILTED, MOTION_COUNT };
+
+extern const char* const IMU_MOTION_NAMES[MOTION_COUNT];
+
+// Sitting level; driving with turns and bumps; tumbling; sitting tilted
+// 30°, which filters starting from level have to converge from. The noise
+// comes from seed, so the same arguments give the same log.
+ImuLog generateImuLog(ImuMotion motion, double seconds, double rateHz, uint32_t seed);
+
+// Appends the samples in path; false if it can't be read
+bool loadImuLog(const char* path, ImuLog& log);
+
+// Angle between two orientation quaternions (w, x, y, z, any length), degrees
+double quaternionAngleDeg(const double a[4], const double b[4]);
+
+} // namespace sim
+
+#endif // IMU_LOG_H_
@@ -0,0 +1,304 @@
+// imu_sim.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#include <Arduino.h>
+#include "imu_sim.h"
+
+namespace sim {
+
+namespace {
+
+// LSM6DS33 registers the model implements
+const uint8_t FIFO_CTRL1 = 0x06;
+const uint8_t FIFO_CTRL2 = 0x07;
+const uint8_t FIFO_CTRL3 = 0x08;
+const uint8_t FIFO_CTRL4 = 0x09;
+const uint8_t FIFO_CTRL5 = 0x0A;
+const uint8_t INT1_CTRL = 0x0D;
+const uint8_t WHO_AM_I = 0x0F;
+const uint8_t CTRL1_XL = 0x10;
+const uint8_t CTRL3_C = 0x12;
+const uint8_t OUT_TEMP_L = 0x20;
+const uint8_t OUTZ_H_XL = 0x2D;
+const uint8_t FIFO_STATUS1 = 0x3A;
+const uint8_t FIFO_STATUS2 = 0x3B;
+const uint8_t FIFO_STATUS3 = 0x3C;
+const uint8_t FIFO_STATUS4 = 0x3D;
+const uint8_t FIFO_DATA_OUT_L = 0x3E;
+const uint8_t FIFO_DATA_OUT_H = 0x3F;
+const uint8_t TIMESTAMP0_REG = 0x40;
+const uint8_t TIMESTAMP2_REG = 0x42;
+const uint8_t TAP_CFG = 0x58;
+const uint8_t WAKE_UP_DUR = 0x5C;
+
+const uint8_t IF_INC = 0x04;
+const uint8_t INT1_DRDY = 0x03;                 // INT1_DRDY_XL | INT1_DRDY_G
+const uint8_t INT1_FTH = 0x08;
+const uint8_t INT1_FIFO_OVR = 0x10;
+const uint8_t FIFO_MODE_CONTINUOUS = 0x06;
+const size_t FIFO_SIZE = 4096;                  // words
+const int WORDS_PER_SAMPLE = 6;
+const int WORDS_PER_SAMPLE_TS = 9;
+
+// FIFO_CTRL3 DEC_FIFO_XL codes 1-7
+const unsigned DECIMATION[] = { 0, 1, 2, 3, 4, 8, 16, 32 };
+
+// Output data rates for CTRL1_XL ODR_XL 1-10, in Hz
+const double ODR_HZ[] = { 0, 12.5, 26, 52, 104, 208, 416, 833, 1660, 3330, 6660 };
+
+// LIS3MDL registers the model implements
+const uint8_t MAG_WHO_AM_I = 0x0F;
+const uint8_t MAG_CTRL_REG1 = 0x20;
+const uint8_t MAG_CTRL_REG3 = 0x22;
+const uint8_t MAG_OUT_X_L = 0x28;
+const uint8_t MAG_OUT_Z_H = 0x2D;
+
+const uint8_t MAG_AUTO_INC = 0x80;              // address MSB
+
+// CTRL_REG1 DO codes 0-7, in Hz
+const double MAG_ODR_HZ[] = { 0.625, 1.25, 2.5, 5, 10, 20, 40, 80 };
+
+const uint64_t POWER_DOWN_POLL_US = 1000;       // how often a powered-down part checks for an ODR
+
+} // namespace
+
+
+LSM6Device::LSM6Device(uint8_t address) :
+  RegisterDevice(address),
+  _tsZero(0),
+  _fifoLast(0),
+  _pattern(0),
+  _overrun(false),
+  _int1Pin(-1),
+  _drdy(false)
+{
+  _regs[WHO_AM_I] = 0x69;
+  _regs[CTRL3_C] = IF_INC;                      // power-on value
+}
+
+
+uint64_t LSM6Device::periodUs() const {
+  uint8_t odr = _regs[CTRL1_XL] >> 4;
+  if (odr == 0 || odr > 10) return 0;
+  return (uint64_t)(1e6 / ODR_HZ[odr] + 0.5);
+}
+
+
+uint64_t LSM6Device::sampleIndex() const {
+  uint64_t period = periodUs();
+  return period ? now() / period : 0;
+}
+
+
+int16_t LSM6Device::value(uint64_t n, int channel) {
+  return (int16_t)(((n & 0x0FFF) << 3) | (uint16_t)channel);
+}
+
+
+uint64_t LSM6Device::timestampUs() const {
+  return (_regs[WAKE_UP_DUR] & 0x10) ? 25 : 6400;
+}
+
+
+uint32_t LSM6Device::timestampAt(uint64_t t) const {
+  if (!(_regs[TAP_CFG] & 0x80)) return 0;
+  return (uint32_t)((t - _tsZero) / timestampUs()) & 0xFFFFFF;
+}
+
+
+void LSM6Device::setTimestamp(uint32_t raw) {
+  _tsZero = now() - (uint64_t)raw * timestampUs();
+}
+
+
+int LSM6Device::fifoSampleWords() const {
+  bool ts = (_regs[FIFO_CTRL2] & 0x80) && (_regs[FIFO_CTRL4] & 0x38);
+  return ts ? WORDS_PER_SAMPLE_TS : WORDS_PER_SAMPLE;
+}
+
+
+uint64_t LSM6Device::fifoPeriodUs() const {
+  uint8_t odr = (_regs[FIFO_CTRL5] >> 3) & 0x0F;
+  unsigned dec = DECIMATION[_regs[FIFO_CTRL3] & 0x07];
+  if ((_regs[FIFO_CTRL5] & 0x07) != FIFO_MODE_CONTINUOUS || odr == 0 || odr > 10 || dec == 0) return 0;
+  return (uint64_t)(1e6 / ODR_HZ[odr] + 0.5) * dec;
+}
+
+
+void LSM6Device::fillFifo() {
+  uint64_t period = fifoPeriodUs();
+  if (period == 0 || periodUs() == 0) return;
+  uint64_t k = now() / period;
+  for (; _fifoLast < k; _fifoLast++) {
+    uint64_t t = (_fifoLast + 1) * period;
+    uint64_t n = t / periodUs();
+    for (int ch = GX; ch <= AZ; ch++) _fifo.push_back((uint16_t)value(n, ch));
+    if (fifoSampleWords() == WORDS_PER_SAMPLE_TS) {
+      // TIMESTAMP[15:8], TIMESTAMP[23:16], -, TIMESTAMP[7:0], STEP_COUNTER
+      uint32_t ts = timestampAt(t);
+      _fifo.push_back((uint16_t)(ts >> 8));
+      _fifo.push_back((uint16_t)((ts & 0xFF) << 8));
+      _fifo.push_back(0);
+    }
+    while (_fifo.size() > FIFO_SIZE) {
+      _fifo.pop_front();
+      _pattern++;
+      _overrun = true;
+    }
+  }
+}
+
+
+void LSM6Device::connectInt1(uint8_t pin) {
+  _int1Pin = pin;
+  updateInt1();
+  scheduleSample();
+}
+
+
+void LSM6Device::scheduleSample() {
+  uint64_t period = periodUs();
+  uint64_t step = period ? period : POWER_DOWN_POLL_US;
+  at((now() / step + 1) * step, [this, period]() {
+    if (period && period == periodUs()) {
+      fillFifo();
+      _drdy = true;
+    }
+    updateInt1();
+    scheduleSample();
+  });
+}
+
+
+void LSM6Device::updateInt1() {
+  if (_int1Pin < 0) return;
+  uint8_t sources = _regs[INT1_CTRL];
+  uint16_t fth = (uint16_t)(_regs[FIFO_CTRL2] & 0x0F) << 8 | _regs[FIFO_CTRL1];
+  bool level = ((sources & INT1_DRDY) && _drdy) ||
+    ((sources & INT1_FTH) && fth && _fifo.size() >= fth) ||
+    ((sources & INT1_FIFO_OVR) && _overrun);
+  setPin((uint8_t)_int1Pin, level ? HIGH : LOW);
+}
+
+
+void LSM6Device::clearFifo() {
+  _fifo.clear();
+  _pattern = 0;
+  _overrun = false;
+  uint64_t period = fifoPeriodUs();
+  _fifoLast = period ? now() / period : 0;
+}
+
+
+uint8_t LSM6Device::readReg(uint8_t r) {
+  fillFifo();
+  size_t words = _fifo.size();
+  uint16_t fth = (uint16_t)(_regs[FIFO_CTRL2] & 0x0F) << 8 | _regs[FIFO_CTRL1];
+  switch (r) {
+    case FIFO_STATUS1:
+      return words & 0xFF;
+    case FIFO_STATUS2:
+      return ((words >> 8) & 0x0F) | (words >= fth && fth ? 0x80 : 0) | (_overrun ? 0x40 : 0) |
+        (words >= FIFO_SIZE ? 0x20 : 0) | (words == 0 ? 0x10 : 0);
+    case FIFO_STATUS3:
+      return (_pattern % fifoSampleWords()) & 0xFF;
+    case FIFO_STATUS4:
+      return 0;
+    case FIFO_DATA_OUT_L:
+      return words ? _fifo.front() & 0xFF : 0;
+    case FIFO_DATA_OUT_H:
+      if (words == 0) return 0;
+      {
+        uint8_t h = _fifo.front() >> 8;
+        _fifo.pop_front();
+        _pattern++;
+        updateInt1();
+        return h;
+      }
+  }
+  if (r >= TIMESTAMP0_REG && r <= TIMESTAMP2_REG) return (timestampAt(now()) >> (8 * (r - TIMESTAMP0_REG))) & 0xFF;
+  if (r < OUT_TEMP_L || r > OUTZ_H_XL) return _regs[r];
+  if (periodUs() == 0) return 0;
+  if (_drdy) {
+    _drdy = false;
+    updateInt1();
+  }
+  uint16_t v = (uint16_t)value(sampleIndex(), (r - OUT_TEMP_L) / 2);
+  return (r & 1) ? v >> 8 : v & 0xFF;
+}
+
+
+void LSM6Device::writeReg(uint8_t r, uint8_t v) {
+  fillFifo();
+  if (r == TIMESTAMP2_REG) {
+    if (v == 0xAA) _tsZero = now();             // counter reset
+    return;
+  }
+  _regs[r] = v;
+  if (r == FIFO_CTRL5) clearFifo();             // a mode change restarts the FIFO
+  updateInt1();
+}
+
+
+// FIFO_DATA_OUT rolls back to its low byte, so a burst keeps popping words.
+uint8_t LSM6Device::nextReg(uint8_t r) {
+  if (!(_regs[CTRL3_C] & IF_INC)) return r;
+  return r == FIFO_DATA_OUT_H ? FIFO_DATA_OUT_L : r + 1;
+}
+
+
+LIS3MDLDevice::LIS3MDLDevice(uint8_t address) :
+  RegisterDevice(address),
+  _drdyPin(-1)
+{
+  _regs[MAG_WHO_AM_I] = 0x3D;
+  _regs[MAG_CTRL_REG1] = 0x10;                  // power-on value: 10 Hz
+  _regs[MAG_CTRL_REG3] = 0x03;                  // power-on value: power down
+}
+
+
+uint64_t LIS3MDLDevice::periodUs() const {
+  if (_regs[MAG_CTRL_REG3] & 0x02) return 0;    // MD = 1x, power down
+  return (uint64_t)(1e6 / MAG_ODR_HZ[(_regs[MAG_CTRL_REG1] >> 2) & 0x07] + 0.5);
+}
+
+
+uint64_t LIS3MDLDevice::sampleIndex() const {
+  uint64_t period = periodUs();
+  return period ? now() / period : 0;
+}
+
+
+void LIS3MDLDevice::connectDrdy(uint8_t pin) {
+  _drdyPin = pin;
+  scheduleSample();
+}
+
+
+void LIS3MDLDevice::scheduleSample() {
+  uint64_t period = periodUs();
+  uint64_t step = period ? period : POWER_DOWN_POLL_US;
+  at((now() / step + 1) * step, [this, period]() {
+    if (period && period == periodUs()) setPin((uint8_t)_drdyPin, HIGH);
+    scheduleSample();
+  });
+}
+
+
+uint8_t LIS3MDLDevice::readReg(uint8_t r) {
+  r &= ~MAG_AUTO_INC;
+  if (r < MAG_OUT_X_L || r > MAG_OUT_Z_H) return _regs[r];
+  if (_drdyPin >= 0) setPin((uint8_t)_drdyPin, LOW);
+  if (periodUs() == 0) return 0;
+  uint16_t v = (uint16_t)LSM6Device::value(sampleIndex(), (r - MAG_OUT_X_L) / 2);
+  return (r & 1) ? v >> 8 : v & 0xFF;
+}
+
+
+uint8_t LIS3MDLDevice::nextReg(uint8_t r) {
+  return (r & MAG_AUTO_INC) ? (uint8_t)(((r + 1) & ~MAG_AUTO_INC) | MAG_AUTO_INC) : r;
+}
+
+} // namespace sim
@@ -0,0 +1,116 @@
+// imu_sim.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Simulated MinIMU-9 v5 parts for the host I2C bus.
+
+#ifndef IMU_SIM_H_
+#define IMU_SIM_H_
+
+#include <deque>
+#include "sim.h"
+
+namespace sim {
+
+// LSM6DS33 accelerometer and gyro. The outputs hold sample n = now / period
+// at the accelerometer ODR set in CTRL1_XL, and every output word of a
+// sample is value(n, channel), so a reader can tell which sample a word
+// came from and whether two words came from the same one. Register address
+// auto-increment follows IF_INC in CTRL3_C.
+//
+// The FIFO supports continuous mode with gyro and accelerometer at the same
+// decimation: each FIFO sample is the 6 words gyro x, y, z, accelerometer
+// x, y, z of the output sample current at that time, followed by the
+// timestamp data set when it is enabled. Samples are added lazily whenever
+// the master touches the device.
+//
+// The timestamp counter (TIMER_EN, TIMER_HR) counts simulated time since it
+// was last reset.
+//
+// Once connectInt1() is called the INT1 sources in INT1_CTRL drive a pin:
+// data ready (latched until an output register is read), FIFO threshold
+// and FIFO overrun.
+class LSM6Device : public RegisterDevice {
+
+  public:
+
+    enum Channel { TEMP, GX, GY, GZ, AX, AY, AZ };
+
+    explicit LSM6Device(uint8_t address = 0x6B);
+
+    uint64_t periodUs() const;                  // output data period, 0 when powered down
+    uint64_t sampleIndex() const;               // sample in the output registers now
+
+    size_t fifoWords() const { return _fifo.size(); }
+
+    uint32_t timestampAt(uint64_t t) const;     // the 24-bit counter at simulated time t
+    void setTimestamp(uint32_t raw);            // preset the counter, to test its wrap
+    uint64_t timestampUs() const;               // counter LSB
+
+    void connectInt1(uint8_t pin);              // drive pin from INT1
+
+    static int16_t value(uint64_t n, int channel);
+    static unsigned sampleOf(int16_t v) { return ((uint16_t)v >> 3) & 0x0FFF; }   // n modulo 4096
+
+  protected:
+
+    uint8_t readReg(uint8_t r);
+    void writeReg(uint8_t r, uint8_t v);
+    uint8_t nextReg(uint8_t r);
+
+  private:
+
+    uint64_t fifoPeriodUs() const;              // 0 unless streaming in continuous mode
+    void fillFifo();                            // queue the FIFO samples due by now
+    void clearFifo();
+    int fifoSampleWords() const;
+    void scheduleSample();                      // next output sample, for INT1
+    void updateInt1();
+
+    uint64_t _tsZero;                           // now() when the counter read 0
+
+    std::deque<uint16_t> _fifo;
+    uint64_t _fifoLast;                         // index (now / fifoPeriodUs()) of the last FIFO sample queued
+    unsigned _pattern;                          // words popped, the pattern position of the head is this mod 6
+    bool _overrun;
+
+    int _int1Pin;                               // -1 when not connected
+    bool _drdy;                                 // a sample is in the output registers and not yet read
+};
+
+
+// LIS3MDL magnetometer. The outputs hold sample n = now / period at the ODR
+// set in CTRL_REG1, with value(n, channel) in each word as for the LSM6.
+// Register address auto-increment follows the MSB of the address byte.
+//
+// Once connectDrdy() is called a pin follows DRDY: high from each new sample
+// until an output register is read.
+class LIS3MDLDevice : public RegisterDevice {
+
+  public:
+
+    enum Channel { MX, MY, MZ };
+
+    explicit LIS3MDLDevice(uint8_t address = 0x1E);
+
+    uint64_t periodUs() const;
+    uint64_t sampleIndex() const;
+
+    void connectDrdy(uint8_t pin);
+
+  protected:
+
+    uint8_t readReg(uint8_t r);
+    uint8_t nextReg(uint8_t r);
+
+  private:
+
+    void scheduleSample();
+
+    int _drdyPin;                               // -1 when not connected
+};
+
+} // namespace sim
+
+#endif // IMU_SIM_H_
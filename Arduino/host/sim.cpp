@@ -0,0 +1,425 @@
+// sim.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <chrono>
+#include <math.h>
+#include "sim.h"
+
+namespace sim {
+
+namespace {
+
+const uint64_t STEP_US = 100;                   // plant integration step
+
+struct Attached {
+  void (*isr)(void);
+  int mode;
+  bool pending;
+};
+
+uint64_t _now = 0;
+bool _advancing = false;
+std::multimap<uint64_t, std::function<void()> > _events;
+
+int _levels[NUM_DIGITAL_PINS];
+int _modes[NUM_DIGITAL_PINS];
+int _pwm[NUM_DIGITAL_PINS];
+
+std::map<uint8_t, Attached> _attached;
+bool _irqEnabled = true;
+int _isrDepth = 0;
+std::map<std::string, IsrStats> _isrStats;
+
+std::vector<Motor*> _motors;
+std::vector<ToneEvent> _tones;
+uint64_t _serialStallUs = 0;
+
+std::vector<I2CDevice*> _devices;
+I2CStats _i2cStats;
+uint32_t _i2cHz = 100000;
+
+
+void runPending() {
+  bool ran = true;
+  while (ran && _irqEnabled && _isrDepth == 0) {
+    ran = false;
+    for (std::map<uint8_t, Attached>::iterator it = _attached.begin(); it != _attached.end(); ++it) {
+      if (it->second.pending && it->second.isr) {
+        it->second.pending = false;
+        runIsr("INT pin " + std::to_string(it->first), it->second.isr);
+        ran = true;
+      }
+    }
+  }
+}
+
+
+void pinChanged(uint8_t pin, int oldLevel, int newLevel) {
+  std::map<uint8_t, Attached>::iterator it = _attached.find(pin);
+  if (it == _attached.end() || !it->second.isr) return;
+  int mode = it->second.mode;
+  bool fire = mode == CHANGE ||
+    (mode == RISING && oldLevel == LOW && newLevel == HIGH) ||
+    (mode == FALLING && oldLevel == HIGH && newLevel == LOW);
+  if (!fire) return;
+  if (_irqEnabled && _isrDepth == 0) {
+    runIsr("INT pin " + std::to_string(pin), it->second.isr);
+  } else {
+    it->second.pending = true;                  // one latched flag per vector, as on the AVR
+  }
+}
+
+} // namespace
+
+
+// ---- clock -----------------------------------------------------------------
+
+uint64_t now() {
+  return _now;
+}
+
+
+void advance(uint64_t us) {
+  advanceTo(_now + us);
+}
+
+
+void advanceTo(uint64_t t) {
+  if (_advancing || _isrDepth > 0) {
+    // time spent inside a handler or a scheduled action: no nested playback
+    if (t > _now) _now = t;
+    return;
+  }
+  _advancing = true;
+  while (_now < t) {
+    uint64_t next = t < _now + STEP_US ? t : _now + STEP_US;
+    if (!_events.empty() && _events.begin()->first < next) {
+      next = _events.begin()->first > _now ? _events.begin()->first : _now;
+    }
+    double dt = (double)(next - _now);
+    if (dt > 0) {
+      uint64_t start = _now;
+      for (size_t i = 0; i < _motors.size(); i++) {
+        _now = start;
+        _motors[i]->step(dt);
+      }
+    }
+    _now = next;
+    while (!_events.empty() && _events.begin()->first <= _now) {
+      std::function<void()> fn = _events.begin()->second;
+      _events.erase(_events.begin());
+      fn();
+    }
+  }
+  _advancing = false;
+}
+
+
+void at(uint64_t t, std::function<void()> fn) {
+  _events.insert(std::make_pair(t, fn));
+}
+
+
+// ---- pins ------------------------------------------------------------------
+
+int pinLevel(uint8_t pin) {
+  return pin < NUM_DIGITAL_PINS ? _levels[pin] : LOW;
+}
+
+
+void setPin(uint8_t pin, int level) {
+  if (pin >= NUM_DIGITAL_PINS) return;
+  int old = _levels[pin];
+  _levels[pin] = level;
+  if (old != level) pinChanged(pin, old, level);
+}
+
+
+int pinMode(uint8_t pin) {
+  return pin < NUM_DIGITAL_PINS ? _modes[pin] : INPUT;
+}
+
+
+void setPinMode(uint8_t pin, int mode) {
+  if (pin >= NUM_DIGITAL_PINS) return;
+  _modes[pin] = mode;
+  if (mode == INPUT_PULLUP) _levels[pin] = HIGH;
+}
+
+
+int pwm(uint8_t pin) {
+  return pin < NUM_DIGITAL_PINS ? _pwm[pin] : 0;
+}
+
+
+void setPwm(uint8_t pin, int val) {
+  if (pin >= NUM_DIGITAL_PINS) return;
+  _pwm[pin] = val;
+}
+
+
+void pressButton(uint8_t pin, uint64_t t, uint64_t holdUs) {
+  at(t, [pin]() { setPin(pin, LOW); });
+  at(t + holdUs, [pin]() { setPin(pin, HIGH); });
+}
+
+
+// ---- interrupts ------------------------------------------------------------
+
+bool interruptsEnabled() {
+  return _irqEnabled;
+}
+
+
+void setInterruptsEnabled(bool enabled) {
+  _irqEnabled = enabled;
+  if (enabled) runPending();
+}
+
+
+bool inIsr() {
+  return _isrDepth > 0;
+}
+
+
+void attach(uint8_t num, void (*isr)(void), int mode) {
+  Attached a;
+  a.isr = isr;
+  a.mode = mode;
+  a.pending = false;
+  _attached[num] = a;
+}
+
+
+void detach(uint8_t num) {
+  _attached.erase(num);
+}
+
+
+void runIsr(const std::string& name, void (*isr)(void)) {
+  runIsr(name, std::function<void()>(isr));
+}
+
+
+void runIsr(const std::string& name, const std::function<void()>& isr) {
+  bool saved = _irqEnabled;
+  _irqEnabled = false;
+  _isrDepth++;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  isr();
+  uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - t0).count();
+  _isrDepth--;
+  _irqEnabled = saved;
+
+  IsrStats& s = _isrStats[name];
+  s.calls++;
+  s.totalNs += ns;
+  if (ns > s.maxNs) s.maxNs = ns;
+
+  runPending();
+}
+
+
+const std::map<std::string, IsrStats>& isrStats() {
+  return _isrStats;
+}
+
+
+// ---- motor / encoder plant ---------------------------------------------------
+
+Motor::Motor(const std::string& label, uint8_t pwmPin, uint8_t inaPin, uint8_t inbPin, uint8_t encPin,
+  const MotorParams& params) :
+  _label(label),
+  _pwmPin(pwmPin),
+  _inaPin(inaPin),
+  _inbPin(inbPin),
+  _encPin(encPin),
+  _encBPin(0xFF),
+  _params(params),
+  _speed(0.0),
+  _pos(0.0),
+  _lastEdge(0),
+  _lastEdgeB(-1),
+  _edges(0),
+  _lastDt(0.0),
+  _lastTau(0.0),
+  _alpha(0.0)
+{
+}
+
+
+void Motor::step(double dtUs) {
+  // TB6612FNG: L/H forward, H/L reverse, H/H short brake, L/L stop (high
+  // impedance). PWM low while driven is also a short brake.
+  int a = pinLevel(_inaPin);
+  int b = pinLevel(_inbPin);
+  int duty = pwm(_pwmPin);
+  double driven = duty <= _params.deadband ? 0.0 :
+    _params.maxEdgesPerSec * _params.gain * (duty - _params.deadband) / (255.0 - _params.deadband);
+
+  double target = 0.0;
+  double tau = _params.coastTauMs;
+  if (a == LOW && b == HIGH) {
+    target = driven;
+    tau = duty > 0 ? _params.tauMs : _params.brakeTauMs;
+  } else if (a == HIGH && b == LOW) {
+    target = -driven;
+    tau = duty > 0 ? _params.tauMs : _params.brakeTauMs;
+  } else if (a == HIGH && b == HIGH) {
+    tau = _params.brakeTauMs;
+  }
+
+  if (dtUs != _lastDt || tau != _lastTau) {
+    _lastDt = dtUs;
+    _lastTau = tau;
+    _alpha = 1.0 - exp(-dtUs / (tau * 1000.0));
+  }
+  double v0 = _speed;
+  _speed += (target - _speed) * _alpha;
+  double p0 = _pos;
+  _pos += (v0 + _speed) * 0.5 * dtUs / 1e6;
+
+  // Each edge is delivered at its interpolated time within the step, so
+  // micros() in the encoder ISR is exact even with a coarse step. Channel
+  // A's edges are at whole positions, channel B's half way between, and
+  // they are played back in the order the motor crosses them.
+  long edge = (long)floor(_pos);
+  long edgeB = _encBPin == 0xFF ? _lastEdgeB : (long)floor(_pos - 0.5);
+  uint64_t start = _now;
+  while (edge != _lastEdge || edgeB != _lastEdgeB) {
+    double crossing = edge == _lastEdge ? 0 : edge > _lastEdge ? _lastEdge + 1 : _lastEdge;
+    double crossingB = edgeB == _lastEdgeB ? 0 : (edgeB > _lastEdgeB ? _lastEdgeB + 1 : _lastEdgeB) + 0.5;
+    bool a = edgeB == _lastEdgeB ||
+             (edge != _lastEdge && (crossing - p0) / (_pos - p0) <= (crossingB - p0) / (_pos - p0));
+    double f = ((a ? crossing : crossingB) - p0) / (_pos - p0);
+    if (f < 0.0) f = 0.0;
+    if (f > 1.0) f = 1.0;
+    _now = start + (uint64_t)(f * dtUs);
+    if (a) {
+      _lastEdge += edge > _lastEdge ? 1 : -1;
+      _edges++;
+      setPin(_encPin, pinLevel(_encPin) == HIGH ? LOW : HIGH);
+    } else {
+      _lastEdgeB += edgeB > _lastEdgeB ? 1 : -1;
+      setPin(_encBPin, pinLevel(_encBPin) == HIGH ? LOW : HIGH);
+    }
+  }
+}
+
+
+// Channel B starts high: position 0 is half way through one of its pulses.
+void Motor::setQuadrature(uint8_t encBPin) {
+  _encBPin = encBPin;
+  _lastEdgeB = (long)floor(_pos - 0.5);
+  setPin(_encBPin, (_lastEdgeB & 1) ? HIGH : LOW);
+}
+
+
+Motor& addMotor(const std::string& label, uint8_t pwmPin, uint8_t inaPin, uint8_t inbPin, uint8_t encPin,
+  const MotorParams& params) {
+  Motor* m = new Motor(label, pwmPin, inaPin, inbPin, encPin, params);
+  _motors.push_back(m);
+  return *m;
+}
+
+
+std::vector<Motor*>& motors() {
+  return _motors;
+}
+
+
+// ---- tones -----------------------------------------------------------------
+
+const std::vector<ToneEvent>& tones() {
+  return _tones;
+}
+
+
+void recordTone(const ToneEvent& e) {
+  _tones.push_back(e);
+}
+
+
+// ---- serial ----------------------------------------------------------------
+
+bool echoSerial = false;
+
+
+uint64_t serialStallUs() {
+  return _serialStallUs;
+}
+
+
+void addSerialStall(uint64_t us) {
+  _serialStallUs += us;
+}
+
+
+// ---- I2C -------------------------------------------------------------------
+
+void RegisterDevice::receive(const uint8_t* data, size_t n) {
+  if (n == 0) return;
+  _ptr = data[0];
+  for (size_t i = 1; i < n; i++) {
+    writeReg(_ptr, data[i]);
+    _ptr = nextReg(_ptr);
+  }
+}
+
+
+size_t RegisterDevice::request(uint8_t* buf, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    buf[i] = readReg(_ptr);
+    _ptr = nextReg(_ptr);
+  }
+  return n;
+}
+
+
+void addI2CDevice(I2CDevice* dev) {
+  _devices.push_back(dev);
+}
+
+
+I2CDevice* findI2CDevice(uint8_t address) {
+  for (size_t i = 0; i < _devices.size(); i++) {
+    if (_devices[i]->address() == address) return _devices[i];
+  }
+  return 0;
+}
+
+
+I2CStats& i2cStats() {
+  return _i2cStats;
+}
+
+
+uint64_t i2cBusTimeUs(size_t bytes) {
+  // start + address/ack + 9 bits per byte + stop
+  uint64_t bits = 1 + 9 * (1 + bytes) + 1;
+  return (bits * 1000000ULL + _i2cHz - 1) / _i2cHz;
+}
+
+
+void i2cClock(uint32_t hz) {
+  _i2cHz = hz;
+}
+
+
+bool i2cMasterWrite(uint8_t address, const uint8_t* data, size_t n) {
+  if (Wire.slaveAddress() == 0 || Wire.slaveAddress() != address) return false;
+  return Wire.slaveReceive(data, n);
+}
+
+
+size_t i2cMasterRead(uint8_t address, uint8_t* buf, size_t n) {
+  if (Wire.slaveAddress() == 0 || Wire.slaveAddress() != address) return 0;
+  return Wire.slaveRequest(buf, n);
+}
+
+} // namespace sim
@@ -0,0 +1,200 @@
+// sim.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+// Simulation core behind the host HAL. Owns the virtual clock, pin levels,
+// attached interrupts, scheduled events, the DC motor / encoder plant and
+// the I2C bus. Time only moves when the sketch calls delay() (or blocks on
+// Serial or Wire) and when the driver program advances it between loop()
+// calls; everything that would happen during that time -- encoder edges,
+// master I2C transactions, button presses -- is played back in order.
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+// ---- clock -----------------------------------------------------------------
+
+uint64_t now();                                 // simulated microseconds since reset
+void advance(uint64_t us);                      // run the world forward by us microseconds
+void advanceTo(uint64_t t);
+
+void at(uint64_t t, std::function<void()> fn);  // schedule fn at simulated time t
+
+// ---- pins ------------------------------------------------------------------
+
+int pinLevel(uint8_t pin);
+void setPin(uint8_t pin, int level);            // drive an input pin from outside (fires interrupts)
+int pinMode(uint8_t pin);
+void setPinMode(uint8_t pin, int mode);
+int pwm(uint8_t pin);                           // last analogWrite() value
+void setPwm(uint8_t pin, int val);
+
+void pressButton(uint8_t pin, uint64_t t, uint64_t holdUs);  // active-low button press at t
+
+// ---- interrupts ------------------------------------------------------------
+
+struct IsrStats {
+  uint64_t calls;
+  uint64_t totalNs;                             // host time spent inside the handler
+  uint64_t maxNs;
+
+  IsrStats() : calls(0), totalNs(0), maxNs(0) {}
+};
+
+bool interruptsEnabled();
+void setInterruptsEnabled(bool enabled);        // re-enabling runs latched handlers
+bool inIsr();
+void attach(uint8_t num, void (*isr)(void), int mode);
+void detach(uint8_t num);
+void runIsr(const std::string& name, void (*isr)(void));     // run a handler in interrupt context
+void runIsr(const std::string& name, const std::function<void()>& isr);
+const std::map<std::string, IsrStats>& isrStats();
+
+// ---- motor / encoder plant ---------------------------------------------------
+
+// First-order DC motor behind a TB6612FNG channel with a single-channel
+// encoder. Speed is in encoder edges per second (what a CHANGE interrupt sees).
+// setQuadrature() adds a second channel a quarter cycle behind: at each
+// edge of the first, the two differ when the motor turns forward and match
+// when it turns backward.
+struct MotorParams {
+  double maxEdgesPerSec;                        // no-load speed at PWM 255
+  int deadband;                                 // PWM below which the motor does not turn
+  double tauMs;                                 // mechanical time constant while driven
+  double brakeTauMs;                            // time constant under short brake
+  double coastTauMs;                            // time constant while coasting
+  double gain;                                  // per-motor mismatch multiplier
+
+  MotorParams() : maxEdgesPerSec(1200.0), deadband(40), tauMs(80.0),
+    brakeTauMs(15.0), coastTauMs(250.0), gain(1.0) {}
+};
+
+class Motor {
+
+  public:
+
+    Motor(const std::string& label, uint8_t pwmPin, uint8_t inaPin, uint8_t inbPin, uint8_t encPin,
+      const MotorParams& params);
+
+    void step(double dtUs);                     // integrate, toggling the encoder pins on every edge
+    void setQuadrature(uint8_t encBPin);        // drive a second encoder channel on encBPin
+    double speed() const { return _speed; }     // signed edges per second
+    double position() const { return _pos; }    // signed edges since reset
+    uint64_t edges() const { return _edges; }   // total encoder edges produced
+    const std::string& label() const { return _label; }
+    MotorParams& params() { return _params; }
+
+  private:
+
+    std::string _label;
+    uint8_t _pwmPin;
+    uint8_t _inaPin;
+    uint8_t _inbPin;
+    uint8_t _encPin;
+    uint8_t _encBPin;                           // 0xFF for a single channel
+    MotorParams _params;
+    double _speed;
+    double _pos;
+    long _lastEdge;
+    long _lastEdgeB;                            // channel B edges sit half way between channel A's
+    uint64_t _edges;
+    double _lastDt;
+    double _lastTau;
+    double _alpha;                              // cached smoothing factor for _lastDt / _lastTau
+};
+
+Motor& addMotor(const std::string& label, uint8_t pwmPin, uint8_t inaPin, uint8_t inbPin, uint8_t encPin,
+  const MotorParams& params = MotorParams());
+std::vector<Motor*>& motors();
+
+// ---- tones -----------------------------------------------------------------
+
+struct ToneEvent {
+  uint64_t t;
+  uint8_t pin;
+  unsigned int frequency;                       // 0 for noTone()
+  unsigned long duration;
+};
+
+const std::vector<ToneEvent>& tones();
+void recordTone(const ToneEvent& e);
+
+// ---- serial ----------------------------------------------------------------
+
+extern bool echoSerial;                         // copy sketch Serial output to stdout
+uint64_t serialStallUs();                       // time the sketch spent blocked on a full TX buffer
+void addSerialStall(uint64_t us);
+
+// ---- I2C -------------------------------------------------------------------
+
+// A device on the bus the sketch masters (IMU, magnetometer, ...).
+class I2CDevice {
+
+  public:
+
+    virtual ~I2CDevice() {}
+    virtual uint8_t address() const = 0;
+    virtual void receive(const uint8_t* data, size_t n) = 0;     // master write
+    virtual size_t request(uint8_t* buf, size_t n) = 0;          // master read
+};
+
+// Register-file device: the first byte of a write selects the register,
+// following bytes are stored with auto-increment, reads continue from the
+// selected register.
+class RegisterDevice : public I2CDevice {
+
+  public:
+
+    RegisterDevice(uint8_t address) : _address(address), _ptr(0) { memset(_regs, 0, sizeof(_regs)); }
+
+    uint8_t address() const { return _address; }
+    void receive(const uint8_t* data, size_t n);
+    size_t request(uint8_t* buf, size_t n);
+
+    uint8_t& reg(uint8_t r) { return _regs[r]; }
+
+  protected:
+
+    virtual uint8_t readReg(uint8_t r) { return _regs[r]; }
+    virtual void writeReg(uint8_t r, uint8_t v) { _regs[r] = v; }
+    virtual uint8_t nextReg(uint8_t r) { return r + 1; }
+
+    uint8_t _address;
+    uint8_t _ptr;
+    uint8_t _regs[256];
+};
+
+struct I2CStats {
+  uint64_t transactions;
+  uint64_t bytes;
+  uint64_t busUs;                               // bus time the sketch spent waiting as master
+  uint64_t asyncUs;                             // bus time of I2CAsync transactions, run by the TWI interrupt
+
+  I2CStats() : transactions(0), bytes(0), busUs(0), asyncUs(0) {}
+};
+
+void addI2CDevice(I2CDevice* dev);
+I2CDevice* findI2CDevice(uint8_t address);
+I2CStats& i2cStats();
+uint64_t i2cBusTimeUs(size_t bytes);            // address + bytes at the configured bus clock
+void i2cClock(uint32_t hz);
+
+// Master-side access to the sketch when it is the I2C slave. Both run the
+// sketch's Wire callbacks in interrupt context.
+bool i2cMasterWrite(uint8_t address, const uint8_t* data, size_t n);
+size_t i2cMasterRead(uint8_t address, uint8_t* buf, size_t n);
+
+} // namespace sim
+
+#endif // SIM_H_
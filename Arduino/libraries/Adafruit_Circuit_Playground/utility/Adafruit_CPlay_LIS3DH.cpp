@@ -190,6 +190,53 @@ void Adafruit_CPlay_LIS3DH::read(void) {
 
 }
 
+#ifdef I2C_ASYNC
+/**************************************************************************/
+/*!
+    @brief  read x, y, and z axis data without waiting for the bus. The read
+            is queued on AsyncWire (I2C mode only) and the raw x, y and z are
+            updated when it completes, in interrupt context; x_g, y_g and z_g
+            are left alone, scale by getRange() to get them.
+    @param callback called in interrupt context once x, y and z are updated
+    @param context passed to callback
+    @return false if the previous readAsync() is still in progress or the
+            sensor is on SPI
+*/
+/**************************************************************************/
+bool Adafruit_CPlay_LIS3DH::readAsync(void (*callback)(void *context), void *context) {
+  if (_cs != -1 || _async.status == I2C_ASYNC_PENDING)
+    return false;
+
+  _asyncCallback = callback;
+  _asyncContext = context;
+  _async.address = _i2caddr;
+  _async.reg = LIS3DH_REG_OUT_X_L | 0x80; // 0x80 for autoincrement
+  _async.length = 6;
+  _async.dest = _asyncBuf;
+  _async.done = asyncDone;
+  _async.context = this;
+  return AsyncWire.submit(&_async);
+}
+
+/**************************************************************************/
+/*!
+    @brief  completion of readAsync(), called by AsyncWire in interrupt context
+    @param t the finished transaction
+*/
+/**************************************************************************/
+void Adafruit_CPlay_LIS3DH::asyncDone(I2CTransaction *t) {
+  Adafruit_CPlay_LIS3DH *lis = (Adafruit_CPlay_LIS3DH *)t->context;
+  if (t->status == I2C_ASYNC_OK) {
+    const uint8_t *b = lis->_asyncBuf;
+    lis->x = b[0]; lis->x |= ((uint16_t)b[1]) << 8;
+    lis->y = b[2]; lis->y |= ((uint16_t)b[3]) << 8;
+    lis->z = b[4]; lis->z |= ((uint16_t)b[5]) << 8;
+  }
+  if (lis->_asyncCallback)
+    lis->_asyncCallback(lis->_asyncContext);
+}
+#endif
+
 /**************************************************************************/
 /*!
     @brief  Read the auxilary ADC
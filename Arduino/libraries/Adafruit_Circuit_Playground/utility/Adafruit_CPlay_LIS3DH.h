@@ -25,6 +25,9 @@
 #endif
 
 #include <Wire.h>
+#ifdef I2C_ASYNC
+#include <I2CAsync.h>
+#endif
 #ifndef __AVR_ATtiny85__
   #include <SPI.h>
 #endif
@@ -141,6 +144,9 @@ class Adafruit_CPlay_LIS3DH : public Adafruit_Sensor {
   bool       begin(uint8_t addr = LIS3DH_DEFAULT_ADDRESS);
 
   void read();
+#ifdef I2C_ASYNC
+  bool readAsync(void (*callback)(void *context), void *context = 0);
+#endif
   int16_t readADC(uint8_t a);
 
   void setRange(lis3dh_range_t range);
@@ -178,6 +184,9 @@ class Adafruit_CPlay_LIS3DH : public Adafruit_Sensor {
   uint8_t readRegister8(uint8_t reg);
   void writeRegister8(uint8_t reg, uint8_t value);
   uint8_t spixfer(uint8_t x = 0xFF);
+#ifdef I2C_ASYNC
+  static void asyncDone(I2CTransaction *t);
+#endif
 
 
   int32_t _sensorID;
@@ -185,6 +194,14 @@ class Adafruit_CPlay_LIS3DH : public Adafruit_Sensor {
 
   // SPI
   int8_t _cs, _mosi, _miso, _sck;
+
+#ifdef I2C_ASYNC
+  // readAsync()
+  I2CTransaction _async;
+  uint8_t _asyncBuf[6];
+  void (*_asyncCallback)(void *context);
+  void *_asyncContext;
+#endif
 };
 
 #endif
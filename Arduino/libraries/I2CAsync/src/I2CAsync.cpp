@@ -0,0 +1,149 @@
+// I2CAsync.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#include "I2CAsync.h"
+
+I2CAsync AsyncWire;
+
+
+void I2CAsync::begin(uint32_t hz) {
+  portBegin(hz);
+}
+
+
+boolean I2CAsync::submit(I2CTransaction *t) {
+  if (t->status == I2C_ASYNC_PENDING || t->length == 0) return false;
+  t->status = I2C_ASYNC_PENDING;
+  t->next = 0;
+  // the TWI interrupt takes transactions off the head, and callbacks may
+  // submit from it, so the queue is only changed with interrupts off
+  uint8_t sreg = SREG;
+  cli();
+  if (_head) {
+    _tail->next = t;
+    _tail = t;
+  } else {
+    _head = _tail = t;
+    _index = 0;
+    portStart();
+  }
+  SREG = sreg;
+  return true;
+}
+
+
+I2CTransaction *I2CAsync::finish(uint8_t status) {
+  I2CTransaction *t = _head;
+  _head = t->next;
+  _index = 0;
+  _completed++;
+  if (status != I2C_ASYNC_OK) _errors++;
+  t->status = status;
+  if (t->done) t->done(t);              // may queue more behind _head
+  return _head;
+}
+
+
+#if defined(HOST_SIM)
+
+// The host build supplies portBegin(), portStart() and isr() on top of the
+// simulated bus (host/I2CAsync_sim.cpp).
+
+#elif defined(__AVR__) && defined(TWCR)
+
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+#define TWCR_ON (_BV(TWEN) | _BV(TWIE) | _BV(TWINT))
+
+ISR(TWI_vect)
+{
+  AsyncWire.isr();
+}
+
+
+void I2CAsync::portBegin(uint32_t hz) {
+  // internal pull-ups on SDA and SCL, as Wire does
+  digitalWrite(SDA, HIGH);
+  digitalWrite(SCL, HIGH);
+  TWSR = 0;                             // prescaler 1
+  TWBR = ((F_CPU / hz) - 16) / 2;
+  TWCR = _BV(TWEN) | _BV(TWIE);
+}
+
+
+void I2CAsync::portStart() {
+  TWCR = TWCR_ON | _BV(TWSTA);
+}
+
+
+// One call per bus event, TW_STATUS says which. The register address goes
+// out as a write, then a repeated start turns the bus around for the read,
+// which ACKs every byte but the last. At the end the STOP and the START of
+// the next queued transaction are issued together.
+void I2CAsync::isr() {
+  I2CTransaction *t = _head;
+  uint8_t status;
+  switch (TW_STATUS)
+  {
+    case TW_START:
+      TWDR = t->address << 1 | TW_WRITE;
+      TWCR = TWCR_ON;
+      return;
+    case TW_MT_SLA_ACK:
+      TWDR = t->reg;
+      TWCR = TWCR_ON;
+      return;
+    case TW_MT_DATA_ACK:
+      TWCR = TWCR_ON | _BV(TWSTA);
+      return;
+    case TW_REP_START:
+      TWDR = t->address << 1 | TW_READ;
+      TWCR = TWCR_ON;
+      return;
+    case TW_MR_DATA_ACK:
+      t->dest[_index++] = TWDR;
+      // fall through
+    case TW_MR_SLA_ACK:
+      TWCR = TWCR_ON | (_index + 1 < t->length ? _BV(TWEA) : 0);
+      return;
+    case TW_MR_DATA_NACK:
+      t->dest[_index++] = TWDR;
+      status = I2C_ASYNC_OK;
+      break;
+    case TW_MT_SLA_NACK:
+    case TW_MT_DATA_NACK:
+    case TW_MR_SLA_NACK:
+      status = I2C_ASYNC_NACK;
+      break;
+    case TW_MT_ARB_LOST:                // == TW_MR_ARB_LOST: the bus is someone else's, no STOP
+      TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT);
+      if (finish(I2C_ASYNC_BUS_ERROR)) portStart();
+      return;
+    default:                            // TW_BUS_ERROR
+      status = I2C_ASYNC_BUS_ERROR;
+      break;
+  }
+  TWCR = TWCR_ON | _BV(TWSTO) | (finish(status) ? _BV(TWSTA) : 0);
+}
+
+#else
+
+// No TWI: every transaction fails as soon as it is submitted.
+
+void I2CAsync::portBegin(uint32_t hz) {
+  (void)hz;
+}
+
+
+void I2CAsync::portStart() {
+  while (_head) finish(I2C_ASYNC_UNSUPPORTED);
+}
+
+
+void I2CAsync::isr() {
+}
+
+#endif
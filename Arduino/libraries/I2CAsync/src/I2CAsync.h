@@ -0,0 +1,108 @@
+// I2CAsync.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#ifndef I2CAsync_H_
+#define I2CAsync_H_
+
+#include <Arduino.h>
+
+// Interrupt-driven I2C master. A driver fills in an I2CTransaction -- device,
+// register, length, destination and completion callback -- and submits it;
+// the TWI interrupt writes the register, reads the bytes back after a
+// repeated start and calls the callback, then starts the next queued
+// transaction straight away. Nothing waits on the bus, so a sensor read
+// costs loop() only the submit.
+//
+// No allocation: transactions are owned by the caller and linked into the
+// queue through their next field. A transaction must stay untouched from
+// submit() until its callback has run; status is I2C_ASYNC_PENDING until
+// then. The callback runs in interrupt context and may submit again.
+//
+// On the AVR this owns the TWI interrupt vector, as Wire's twi.c does, so a
+// sketch uses either this or Wire as bus master. The host build runs the
+// transactions against the simulated bus.
+//
+// The drivers' readAsync() members (LSM6, LIS3MDL, LIS3DH, MPU9250's
+// readBytesAsync()) are opt-in: they, and their include of this header,
+// exist only when I2C_ASYNC is defined. A sketch's own #define does not
+// reach the libraries, so build everything with -DI2C_ASYNC (the board's
+// compiler.cpp.extra_flags, say); without it the drivers use Wire alone and
+// this library is not linked.
+
+// I2CTransaction status
+#define I2C_ASYNC_OK          0
+#define I2C_ASYNC_NACK        2       // address or register not acknowledged, as Wire.endTransmission()
+#define I2C_ASYNC_BUS_ERROR   4       // arbitration lost or an illegal start/stop
+#define I2C_ASYNC_UNSUPPORTED 5       // no TWI on this board
+#define I2C_ASYNC_PENDING     0xFF    // queued or on the bus
+
+
+struct I2CTransaction {
+  uint8_t address;                    // 7-bit device address
+  uint8_t reg;                        // register written before the read
+  uint8_t length;                     // bytes to read into dest
+  uint8_t *dest;
+  void (*done)(I2CTransaction *t);    // optional, called in interrupt context
+  void *context;                      // for the callback's use
+  volatile uint8_t status;            // I2C_ASYNC_*
+  I2CTransaction *next;               // queue link, owned by I2CAsync
+
+  I2CTransaction() : address(0), reg(0), length(0), dest(0), done(0), context(0), status(I2C_ASYNC_OK), next(0) {}
+};
+
+
+class I2CAsync {
+
+  public:
+
+    I2CAsync() : _head(0), _tail(0), _index(0), _completed(0), _errors(0) {}
+
+    void begin(uint32_t hz = 400000);
+
+    // Queues t behind any transaction already queued. Returns false, and
+    // leaves t alone, if it is still pending from an earlier submit or has
+    // nothing to read. May be called from loop() or an interrupt handler.
+    boolean submit(I2CTransaction *t);
+
+    boolean busy() { return _head != 0; }
+
+    unsigned long completed() { return atomicRead(_completed); }   // transactions finished, any status
+    unsigned long errors() { return atomicRead(_errors); }         // of those, the ones that did not end I2C_ASYNC_OK
+
+    // TWI interrupt handler: moves the transaction at the head of the queue
+    // along by one bus event
+    void isr();
+
+  private:
+
+    static unsigned long atomicRead(volatile unsigned long &v) {
+      unsigned long a, b;
+      do {
+        a = v;
+        b = v;
+      } while (a != b);
+      return a;
+    }
+
+    // Ends the transaction on the bus with status, runs its callback and
+    // returns the next one, or 0 if the queue is now empty. Interrupt
+    // context.
+    I2CTransaction *finish(uint8_t status);
+
+    // Hardware side: set the clock, and put the START for the transaction
+    // at the head of the queue on the bus.
+    void portBegin(uint32_t hz);
+    void portStart();
+
+    I2CTransaction *volatile _head;     // on the bus
+    I2CTransaction *_tail;
+    uint8_t _index;                     // next byte of _head->dest
+    volatile unsigned long _completed;
+    volatile unsigned long _errors;
+};
+
+extern I2CAsync AsyncWire;
+
+#endif
@@ -21,6 +21,11 @@ LIS3MDL::LIS3MDL(void)
 
   io_timeout = 0;  // 0 = no timeout
   did_timeout = false;
+
+#ifdef I2C_ASYNC
+  async_callback = 0;
+  async_context = 0;
+#endif
 }
 
 // Public Methods //////////////////////////////////////////////////////////////
@@ -171,6 +176,30 @@ void LIS3MDL::read()
   m.z = (int16_t)(zhm << 8 | zlm);
 }
 
+#ifdef I2C_ASYNC
+/*
+Same as read(), without waiting: the read is queued on AsyncWire and this
+returns at once. When it completes, m and last_status are updated and
+callback is called with context, both in interrupt context, so copy the
+readings out in the callback. Returns false without queueing anything if
+the previous readAsync() has not completed yet.
+*/
+bool LIS3MDL::readAsync(void (*callback)(void *context), void *context)
+{
+  if (async_xfer.status == I2C_ASYNC_PENDING) { return false; }
+  async_callback = callback;
+  async_context = context;
+  async_xfer.address = address;
+  // assert MSB to enable subaddress updating
+  async_xfer.reg = OUT_X_L | 0x80;
+  async_xfer.length = 6;
+  async_xfer.dest = async_buf;
+  async_xfer.done = asyncDone;
+  async_xfer.context = this;
+  return AsyncWire.submit(&async_xfer);
+}
+#endif
+
 void LIS3MDL::vector_normalize(vector<float> *a)
 {
   float mag = sqrt(vector_dot(a, a));
@@ -199,4 +228,21 @@ int16_t LIS3MDL::testReg(uint8_t address, regAddr reg)
   {
     return TEST_REG_ERROR;
   }
-}
\ No newline at end of file
+}
+
+#ifdef I2C_ASYNC
+// Completion of readAsync(), called by AsyncWire in interrupt context
+void LIS3MDL::asyncDone(I2CTransaction *t)
+{
+  LIS3MDL *mag = (LIS3MDL *)t->context;
+  if (t->status == I2C_ASYNC_OK)
+  {
+    const uint8_t *b = mag->async_buf;
+    mag->m.x = (int16_t)(b[1] << 8 | b[0]);
+    mag->m.y = (int16_t)(b[3] << 8 | b[2]);
+    mag->m.z = (int16_t)(b[5] << 8 | b[4]);
+  }
+  mag->last_status = t->status;
+  if (mag->async_callback) { mag->async_callback(mag->async_context); }
+}
+#endif
@@ -2,6 +2,9 @@
 #define LIS3MDL_h
 
 #include <Arduino.h>
+#ifdef I2C_ASYNC
+#include <I2CAsync.h>
+#endif
 
 class LIS3MDL
 {
@@ -55,6 +58,9 @@ class LIS3MDL
     uint8_t readReg(uint8_t reg);
 
     void read(void);
+#ifdef I2C_ASYNC
+    bool readAsync(void (*callback)(void *context), void *context = 0);
+#endif
 
     void setTimeout(uint16_t timeout);
     uint16_t getTimeout(void);
@@ -72,7 +78,17 @@ class LIS3MDL
     uint16_t io_timeout;
     bool did_timeout;
 
+#ifdef I2C_ASYNC
+    I2CTransaction async_xfer;
+    uint8_t async_buf[6];
+    void (*async_callback)(void *context);
+    void *async_context;
+#endif
+
     int16_t testReg(uint8_t address, regAddr reg);
+#ifdef I2C_ASYNC
+    static void asyncDone(I2CTransaction *t);
+#endif
 };
 
 template <typename Ta, typename Tb, typename To> void LIS3MDL::vector_cross(const vector<Ta> *a, const vector<Tb> *b, vector<To> *out)
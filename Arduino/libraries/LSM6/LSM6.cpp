@@ -13,6 +13,24 @@
 
 #define DS33_WHO_ID    0x69
 
+// FIFO
+#define FIFO_WORDS_PER_SAMPLE 6   // gyro x, y, z then accelerometer x, y, z
+#define FIFO_WORDS_PER_SAMPLE_TS 9  // followed by the timestamp and step counter
+#define FIFO_MAX_WORDS        4096
+#define FIFO_CHUNK_BYTES      30  // largest whole number of words that fits the 32-byte AVR Wire buffer
+#define FIFO_STATUS2_OVER_RUN 0x40
+#define FIFO_STATUS2_FULL     0x20
+#define FIFO_MODE_BYPASS      0x00
+#define FIFO_MODE_CONTINUOUS  0x06
+
+#define TIMESTAMP_US          25  // timestamp LSB with TIMER_HR set
+
+// INT1_CTRL
+#define INT1_DRDY_XL          0x01
+#define INT1_DRDY_G           0x02
+#define INT1_FTH              0x08
+#define INT1_FIFO_OVR         0x10
+
 // Constructors ////////////////////////////////////////////////////////////////
 
 LSM6::LSM6(void)
@@ -21,6 +39,20 @@ LSM6::LSM6(void)
 
   io_timeout = 0;  // 0 = no timeout
   did_timeout = false;
+
+  fifo_overrun = false;
+  fifo_words = FIFO_WORDS_PER_SAMPLE;
+
+  ts_enabled = false;
+  ts_last = 0;
+  timestamp = 0;
+
+  temperature = 0;
+
+#ifdef I2C_ASYNC
+  async_callback = 0;
+  async_context = 0;
+#endif
 }
 
 // Public Methods //////////////////////////////////////////////////////////////
@@ -92,6 +124,8 @@ Enables the LSM6's accelerometer and gyro. Also:
   and 1.66 kHz (high performance) ODR for gyro. (These are the ODR settings for
   which the electrical characteristics are specified in the datasheet.)
 - Enables automatic increment of register address during multiple byte access
+- Enables block data update, so a burst read gets the gyro and accelerometer
+  outputs from the same sample
 Note that this function will also reset other settings controlled by
 the registers it writes to.
 */
@@ -113,9 +147,10 @@ void LSM6::enableDefault(void)
 
     // Common
 
-    // 0x04 = 0b00000100
+    // 0x44 = 0b01000100
+    // BDU = 1 (output registers not updated until MSB and LSB have been read)
     // IF_INC = 1 (automatically increment register address)
-    writeReg(CTRL3_C, 0x04);
+    writeReg(CTRL3_C, 0x44);
   }
 }
 
@@ -203,11 +238,244 @@ void LSM6::readGyro(void)
   g.z = (int16_t)(zhg << 8 | zlg);
 }
 
-// Reads all 6 channels of the LSM6 and stores them in the object variables
+// Reads all 6 channels of the LSM6 and stores them in the object variables.
+// The gyro (OUTX_L_G) and accelerometer (OUTX_L_XL) outputs are contiguous,
+// so both come back in one 12-byte burst: half the transactions of
+// readAcc() followed by readGyro(), and with BDU (see enableDefault()) both
+// vectors are from the same sample.
 void LSM6::read(void)
 {
-  readAcc();
-  readGyro();
+  uint8_t buf[12];
+  if (readBlock(OUTX_L_G, buf, 12))
+  {
+    decodeGyroAcc(buf);
+    readTimestamp();
+  }
+}
+
+// Same as read(), with the temperature (OUT_TEMP_L) in the same burst
+void LSM6::readWithTemp(void)
+{
+  uint8_t buf[14];
+  if (readBlock(OUT_TEMP_L, buf, 14))
+  {
+    temperature = (int16_t)(buf[1] << 8 | buf[0]);
+    decodeGyroAcc(buf + 2);
+    readTimestamp();
+  }
+}
+
+#ifdef I2C_ASYNC
+/*
+Same as read(), without waiting: the 12-byte burst (and the timestamp, if
+enabled) is queued on AsyncWire and this returns at once. When the read
+completes, g, a, timestamp and last_status are updated and callback is
+called with context, both in interrupt context, so copy the readings out in
+the callback. Returns false without queueing anything if the previous
+readAsync() has not completed yet.
+*/
+bool LSM6::readAsync(void (*callback)(void *context), void *context)
+{
+  if (async_xfer[0].status == I2C_ASYNC_PENDING || async_xfer[1].status == I2C_ASYNC_PENDING)
+  {
+    return false;
+  }
+  async_callback = callback;
+  async_context = context;
+
+  I2CTransaction *t = &async_xfer[0];
+  t->address = address;
+  t->reg = OUTX_L_G;
+  t->length = 12;
+  t->dest = async_buf;
+  t->done = ts_enabled ? 0 : asyncDone;
+  t->context = this;
+  AsyncWire.submit(t);
+
+  if (ts_enabled)
+  {
+    // the engine runs the two back to back
+    t = &async_xfer[1];
+    t->address = address;
+    t->reg = TIMESTAMP0_REG;
+    t->length = 3;
+    t->dest = async_buf + 12;
+    t->done = asyncDone;
+    t->context = this;
+    AsyncWire.submit(t);
+  }
+  return true;
+}
+#endif
+
+/*
+Streams gyro and accelerometer samples through the 8 KB FIFO in continuous
+mode, so none are lost between reads:
+- Both sensors go in at the same decimation, giving a repeating pattern of
+  6 words per sample: gyro x, y, z, then accelerometer x, y, z
+- With enableTimestamp() called first, the timestamp goes in as the fourth
+  data set at the same decimation, adding 3 words to each sample
+- FIFO ODR = 1.66 kHz, the ODR enableDefault() selects, divided by the
+  decimation (1, 2, 3, 4, 8, 16 or 32; anything else is taken as 1)
+- The watermark (FIFO_STATUS2 WaterM, which can also drive INT1) is set at
+  watermark samples
+Call after enableDefault().
+*/
+void LSM6::enableFifo(uint16_t watermark, uint8_t decimation)
+{
+  uint8_t dec;
+  switch (decimation)
+  {
+    case 2:  dec = 2; break;
+    case 3:  dec = 3; break;
+    case 4:  dec = 4; break;
+    case 8:  dec = 5; break;
+    case 16: dec = 6; break;
+    case 32: dec = 7; break;
+    default: dec = 1; break;
+  }
+
+  fifo_words = ts_enabled ? FIFO_WORDS_PER_SAMPLE_TS : FIFO_WORDS_PER_SAMPLE;
+  uint16_t fth = watermark * fifo_words;
+  if (fth >= FIFO_MAX_WORDS) { fth = FIFO_MAX_WORDS - 1; }
+
+  // bypass mode first: empties the FIFO and clears the overrun
+  writeReg(FIFO_CTRL5, FIFO_MODE_BYPASS);
+  writeReg(FIFO_CTRL1, fth & 0xFF);
+  // TIMER_PEDO_FIFO_EN = timestamps on; FTH[11:8]
+  writeReg(FIFO_CTRL2, (ts_enabled ? 0x80 : 0x00) | fth >> 8);
+  // DEC_FIFO_GYRO, DEC_FIFO_XL
+  writeReg(FIFO_CTRL3, dec << 3 | dec);
+  // DEC_DS4_FIFO (timestamp and step counter)
+  writeReg(FIFO_CTRL4, ts_enabled ? dec << 3 : 0x00);
+  // ODR_FIFO = 1000 (1.66 kHz); FIFO_MODE = 110 (continuous)
+  writeReg(FIFO_CTRL5, 0x08 << 3 | FIFO_MODE_CONTINUOUS);
+  fifo_overrun = false;
+}
+
+// Stops streaming and empties the FIFO
+void LSM6::disableFifo(void)
+{
+  writeReg(FIFO_CTRL5, FIFO_MODE_BYPASS);
+}
+
+// Returns the number of unread 16-bit words in the FIFO
+uint16_t LSM6::fifoWords(void)
+{
+  uint16_t pattern;
+  return readFifoStatus(&pattern);
+}
+
+/*
+Drains up to buf->capacity whole samples from the FIFO into buf and returns
+how many were stored. FIFO_DATA_OUT rolls back from 0x3F to 0x3E, so each
+read pulls as many words as the Wire buffer holds (FIFO_CHUNK_BYTES, about
+2.5 samples on an AVR) instead of one sample per transaction. If the FIFO
+is part way through a sample (after an overrun, for example) the words up
+to the next gyro x are skipped.
+
+With timestamps in the FIFO, each sample's time (see timestamp) goes to
+buf->t if it is set, and timestamp is left at the time of the last sample.
+*/
+uint16_t LSM6::readFifo(fifoBuffer *buf)
+{
+  uint16_t pattern;
+  uint16_t words = readFifoStatus(&pattern);
+  uint16_t skip = (fifo_words - pattern % fifo_words) % fifo_words;
+  if (words <= skip) { return 0; }
+
+  uint16_t samples = (words - skip) / fifo_words;
+  if (samples > buf->capacity) { samples = buf->capacity; }
+  if (samples == 0) { return 0; }
+
+  int16_t *dst[FIFO_WORDS_PER_SAMPLE] = { buf->gx, buf->gy, buf->gz, buf->ax, buf->ay, buf->az };
+  uint8_t ts[6];  // the fourth data set: TIMESTAMP[15:8], TIMESTAMP[23:16], -, TIMESTAMP[7:0], STEP_COUNTER
+  uint16_t remaining = (skip + samples * fifo_words) * 2;
+  uint16_t sample = 0;
+  uint8_t word = 0;
+  uint8_t chunk[FIFO_CHUNK_BYTES];
+  while (remaining > 0)
+  {
+    uint8_t n = remaining > FIFO_CHUNK_BYTES ? FIFO_CHUNK_BYTES : remaining;
+    if (!readBlock(FIFO_DATA_OUT_L, chunk, n)) { return sample; }
+    remaining -= n;
+    for (uint8_t i = 0; i < n; i += 2)
+    {
+      if (skip > 0) { skip--; continue; }
+      if (word < FIFO_WORDS_PER_SAMPLE)
+      {
+        dst[word][sample] = (int16_t)(chunk[i + 1] << 8 | chunk[i]);
+      }
+      else
+      {
+        ts[(word - FIFO_WORDS_PER_SAMPLE) * 2] = chunk[i];
+        ts[(word - FIFO_WORDS_PER_SAMPLE) * 2 + 1] = chunk[i + 1];
+      }
+      if (++word == fifo_words)
+      {
+        if (fifo_words == FIFO_WORDS_PER_SAMPLE_TS)
+        {
+          extendTimestamp((uint32_t)ts[1] << 16 | (uint32_t)ts[0] << 8 | ts[3]);
+          if (buf->t) { buf->t[sample] = timestamp; }
+        }
+        word = 0;
+        sample++;
+      }
+    }
+  }
+  return sample;
+}
+
+/*
+Starts the on-chip timestamp counter at 25 us resolution (TIMER_HR) and
+resets it to 0. From then on read() and readWithTemp() also read it, and
+readFifo() takes it from the FIFO with each sample; either way timestamp
+holds it extended to 64 bits in microseconds. The 24-bit counter wraps
+every 419 s, so a read at least that often is needed to follow the wraps.
+
+The time read() attaches is when the registers were read, at most one
+output data period after the sample was taken; the FIFO times are exact.
+Call enableFifo() after this to get timestamps in the FIFO.
+*/
+void LSM6::enableTimestamp(void)
+{
+  // TIMER_HR = 1 (25 us per LSB)
+  writeReg(WAKE_UP_DUR, readReg(WAKE_UP_DUR) | 0x10);
+  // TIMER_EN = 1
+  writeReg(TAP_CFG, readReg(TAP_CFG) | 0x80);
+  // writing 0xAA to TIMESTAMP2_REG resets the counter
+  writeReg(TIMESTAMP2_REG, 0xAA);
+  ts_enabled = true;
+  ts_last = 0;
+  timestamp = 0;
+}
+
+/*
+Drives INT1 high when a new gyro or accelerometer sample is in the output
+registers. The line is latched: it stays high until the sample is read with
+read() or readWithTemp(), so one rising edge is one sample to collect and an
+MCU interrupt on that edge replaces polling. Replaces any sources set by
+enableFifoInterrupt().
+*/
+void LSM6::enableDataReadyInterrupt(void)
+{
+  writeReg(INT1_CTRL, INT1_DRDY_G | INT1_DRDY_XL);
+}
+
+/*
+Drives INT1 high while the FIFO holds at least the watermark set by
+enableFifo(), or has overrun; it drops once readFifo() has drained it below
+the watermark. Replaces any sources set by enableDataReadyInterrupt().
+*/
+void LSM6::enableFifoInterrupt(void)
+{
+  writeReg(INT1_CTRL, INT1_FTH | INT1_FIFO_OVR);
+}
+
+// Stops driving INT1
+void LSM6::disableInterrupts(void)
+{
+  writeReg(INT1_CTRL, 0x00);
 }
 
 void LSM6::vector_normalize(vector<float> *a)
@@ -238,4 +506,98 @@ int16_t LSM6::testReg(uint8_t address, regAddr reg)
   {
     return TEST_REG_ERROR;
   }
-}
\ No newline at end of file
+}
+
+// Reads n consecutive registers starting at reg in one transaction.
+// Returns false if they did not all arrive before the timeout.
+bool LSM6::readBlock(uint8_t reg, uint8_t *buf, uint8_t n)
+{
+  Wire.beginTransmission(address);
+  // automatic increment of register address is enabled by default (IF_INC in CTRL3_C)
+  Wire.write(reg);
+  last_status = Wire.endTransmission();
+  Wire.requestFrom(address, n);
+
+  uint16_t millis_start = millis();
+  while (Wire.available() < n) {
+    if (io_timeout > 0 && ((uint16_t)millis() - millis_start) > io_timeout)
+    {
+      did_timeout = true;
+      return false;
+    }
+  }
+
+  for (uint8_t i = 0; i < n; i++) { buf[i] = Wire.read(); }
+  return true;
+}
+
+// Reads FIFO_STATUS1 through FIFO_STATUS4 in one burst. Returns the number
+// of unread words and stores the position in the sample pattern of the next
+// one (0 = gyro x). Latches fifo_overrun.
+uint16_t LSM6::readFifoStatus(uint16_t *pattern)
+{
+  uint8_t status[4];
+  if (!readBlock(FIFO_STATUS1, status, 4))
+  {
+    *pattern = 0;
+    return 0;
+  }
+  if (status[1] & FIFO_STATUS2_OVER_RUN) { fifo_overrun = true; }
+  *pattern = (uint16_t)(status[3] & 0x03) << 8 | status[2];
+  uint16_t words = (uint16_t)(status[1] & 0x0F) << 8 | status[0];
+  // DIFF_FIFO is 12 bits, so a full FIFO reads as 0 words
+  if (words == 0 && (status[1] & FIFO_STATUS2_FULL)) { words = FIFO_MAX_WORDS; }
+  return words;
+}
+
+// Reads TIMESTAMP0_REG through TIMESTAMP2_REG into timestamp, if enabled
+void LSM6::readTimestamp(void)
+{
+  uint8_t buf[3];
+  if (ts_enabled && readBlock(TIMESTAMP0_REG, buf, 3))
+  {
+    extendTimestamp((uint32_t)buf[2] << 16 | (uint32_t)buf[1] << 8 | buf[0]);
+  }
+}
+
+// Adds the ticks since the last reading of the 24-bit counter to timestamp
+void LSM6::extendTimestamp(uint32_t raw)
+{
+  timestamp += (uint64_t)((raw - ts_last) & 0xFFFFFF) * TIMESTAMP_US;
+  ts_last = raw;
+}
+
+#ifdef I2C_ASYNC
+// Completion of readAsync(), called by AsyncWire in interrupt context
+void LSM6::asyncDone(I2CTransaction *t)
+{
+  LSM6 *imu = (LSM6 *)t->context;
+  uint8_t status = imu->async_xfer[0].status;
+  if (status == I2C_ASYNC_OK)
+  {
+    imu->decodeGyroAcc(imu->async_buf);
+    if (imu->ts_enabled)
+    {
+      status = t->status;
+      if (status == I2C_ASYNC_OK)
+      {
+        const uint8_t *ts = imu->async_buf + 12;
+        imu->extendTimestamp((uint32_t)ts[2] << 16 | (uint32_t)ts[1] << 8 | ts[0]);
+      }
+    }
+  }
+  imu->last_status = status;
+  if (imu->async_callback) { imu->async_callback(imu->async_context); }
+}
+#endif
+
+// Combines the 12 bytes from OUTX_L_G through OUTZ_H_XL into g and a
+void LSM6::decodeGyroAcc(const uint8_t *buf)
+{
+  g.x = (int16_t)(buf[1] << 8 | buf[0]);
+  g.y = (int16_t)(buf[3] << 8 | buf[2]);
+  g.z = (int16_t)(buf[5] << 8 | buf[4]);
+  a.x = (int16_t)(buf[7] << 8 | buf[6]);
+  a.y = (int16_t)(buf[9] << 8 | buf[8]);
+  a.z = (int16_t)(buf[11] << 8 | buf[10]);
+}
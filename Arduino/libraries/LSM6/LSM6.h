@@ -2,6 +2,9 @@
 #define LSM6_h
 
 #include <Arduino.h>
+#ifdef I2C_ASYNC
+#include <I2CAsync.h>
+#endif
 
 class LSM6
 {
@@ -11,6 +14,18 @@ class LSM6
       T x, y, z;
     };
 
+    // Struct-of-arrays destination for readFifo(): sample i is
+    // (gx[i], gy[i], gz[i]) and (ax[i], ay[i], az[i]), taken at time t[i]
+    // (see timestamp), each array holding capacity samples. t may be left
+    // null.
+    struct fifoBuffer
+    {
+      int16_t *gx, *gy, *gz;
+      int16_t *ax, *ay, *az;
+      uint16_t capacity;
+      uint64_t *t;
+    };
+
     enum deviceType { device_DS33, device_auto };
     enum sa0State { sa0_low, sa0_high, sa0_auto };
 
@@ -89,8 +104,11 @@ class LSM6
 
     vector<int16_t> a; // accelerometer readings
     vector<int16_t> g; // gyro readings
+    int16_t temperature; // raw temperature reading, 16 LSB/deg C, 0 at 25 deg C
 
     uint8_t last_status; // status of last I2C transmission
+    bool fifo_overrun; // set when the FIFO filled and dropped samples, cleared by enableFifo()
+    uint64_t timestamp; // hardware time of the last sample in us, since enableTimestamp()
 
     LSM6(void);
 
@@ -106,6 +124,21 @@ class LSM6
     void readAcc(void);
     void readGyro(void);
     void read(void);
+    void readWithTemp(void);
+#ifdef I2C_ASYNC
+    bool readAsync(void (*callback)(void *context), void *context = 0);
+#endif
+
+    void enableFifo(uint16_t watermark, uint8_t decimation = 1);
+    void disableFifo(void);
+    uint16_t fifoWords(void);
+    uint16_t readFifo(fifoBuffer *buf);
+
+    void enableTimestamp(void);
+
+    void enableDataReadyInterrupt(void);
+    void enableFifoInterrupt(void);
+    void disableInterrupts(void);
 
     void setTimeout(uint16_t timeout);
     uint16_t getTimeout(void);
@@ -123,7 +156,26 @@ class LSM6
     uint16_t io_timeout;
     bool did_timeout;
 
+    uint8_t fifo_words; // words per FIFO sample
+    bool ts_enabled;
+    uint32_t ts_last; // last raw 24-bit timestamp
+
+#ifdef I2C_ASYNC
+    I2CTransaction async_xfer[2]; // outputs, then the timestamp
+    uint8_t async_buf[15];
+    void (*async_callback)(void *context);
+    void *async_context;
+#endif
+
     int16_t testReg(uint8_t address, regAddr reg);
+    bool readBlock(uint8_t reg, uint8_t *buf, uint8_t n);
+    uint16_t readFifoStatus(uint16_t *pattern);
+    void decodeGyroAcc(const uint8_t *buf);
+    void readTimestamp(void);
+    void extendTimestamp(uint32_t raw);
+#ifdef I2C_ASYNC
+    static void asyncDone(I2CTransaction *t);
+#endif
 };
 
 
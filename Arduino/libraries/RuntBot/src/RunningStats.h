@@ -0,0 +1,85 @@
+// RunningStats.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#ifndef RunningStats_H_
+#define RunningStats_H_
+
+#include <Arduino.h>
+
+// Moving average over the last N samples, N a power of two. add() replaces
+// the oldest sample and adjusts a running sum, so it costs the same at any
+// N, and mean() is one divide. Until N samples have been added the mean is
+// over the ones there are; count() says how many.
+//
+// The sum is kept in T, so N times the largest sample must fit in it: bound
+// the samples (a wheel drops tick intervals past its stall timeout) or use a
+// wider T.
+//
+// With median set, each sample is replaced by the median of it and the two
+// raw samples before it, so one wild sample -- a bounced encoder edge, a
+// missed one -- never reaches the average. The average then lags by one
+// more sample.
+//
+// Nothing here is volatile. When add() runs in an interrupt handler, read
+// sum() and count() together with interrupts off and divide afterwards.
+
+template <typename T, uint8_t N>
+class RunningStats {
+
+  static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0, "RunningStats N must be a power of two <= 128");
+
+  public:
+
+    RunningStats(boolean median = false) : _median(median) { reset(); }
+
+    void reset() {
+      for (uint8_t i = 0; i < N; i++) _buf[i] = 0;
+      _sum = 0;
+      _next = 0;
+      _count = 0;
+      _prev[0] = _prev[1] = 0;
+      _raw = 0;
+    }
+
+    void add(T x) {
+      if (_median) {
+        T a = _prev[0], b = _prev[1];
+        _prev[0] = b;
+        _prev[1] = x;
+        if (_raw < 2) {
+          _raw++;
+        } else {
+          x = median(a, b, x);
+        }
+      }
+      _sum -= _buf[_next];
+      _buf[_next] = x;
+      _sum += x;
+      _next = (_next + 1) & (N - 1);
+      if (_count < N) _count++;
+    }
+
+    uint8_t count() { return _count; }          // samples in the window
+    T sum() { return _sum; }
+    T mean() { return _count ? _sum / _count : 0; }
+    T last() { return _buf[(_next - 1) & (N - 1)]; }   // as added, after the median
+
+  private:
+
+    T _buf[N];
+    T _sum;
+    T _prev[2];                                 // the last two raw samples, for the median
+    uint8_t _next;                              // where the next sample goes
+    uint8_t _count;
+    uint8_t _raw;                               // raw samples since reset, up to 2
+    boolean _median;
+
+    static T median(T a, T b, T c) {
+      if (a > b) { T t = a; a = b; b = t; }
+      return c < a ? a : (c > b ? b : c);
+    }
+};
+
+#endif
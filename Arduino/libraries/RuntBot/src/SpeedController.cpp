@@ -0,0 +1,30 @@
+// SpeedController.cpp
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#include "SpeedController.h"
+
+const int32_t PWM_MAX_Q = 255L << SpeedController::GAIN_SHIFT;
+
+
+uint8_t SpeedController::update(uint16_t target, uint16_t measured, uint8_t feedForward) {
+  int32_t e = (int32_t)target - (int32_t)measured;
+  int32_t integral = _integral + _ki * e;
+  if (integral > PWM_MAX_Q) integral = PWM_MAX_Q;
+  else if (integral < -PWM_MAX_Q) integral = -PWM_MAX_Q;
+
+  int32_t u = ((int32_t)feedForward << GAIN_SHIFT) + _kp * e + integral;
+  if (u > PWM_MAX_Q) {
+    u = PWM_MAX_Q;
+    if (e < 0) _integral = integral;            // only integrate back out of saturation
+  } else if (u < 0) {
+    u = 0;
+    if (e > 0) _integral = integral;
+  } else {
+    _integral = integral;
+  }
+
+  _pwm = (uint8_t)((u + (1L << (GAIN_SHIFT - 1))) >> GAIN_SHIFT);
+  return _pwm;
+}
@@ -0,0 +1,48 @@
+// SpeedController.h
+// Author: Ron Smith
+// Created: 2026-10-17
+// Copyright ©2026 That Ain't Working, All Rights Reserved
+
+#ifndef SpeedController_H_
+#define SpeedController_H_
+
+#include <Arduino.h>
+
+// Fixed-point PI wheel speed controller. Call update() at a fixed rate with
+// the target and measured speed (any unit, typically encoder ticks per
+// second) and a feed-forward PWM for the target; it returns the PWM to
+// drive, 0-255. The sign of the motion is handled by the caller.
+//
+// Gains are Q8: kp is PWM/256 per unit of speed error, ki is PWM/256 added
+// to the integral per unit of error each update. The integral only moves
+// while the output is not saturated in the direction of the error, so it
+// cannot wind up while the motor is stalled or at full power.
+
+class SpeedController {
+
+  public:
+
+    static const uint8_t GAIN_SHIFT = 8;
+
+    SpeedController(int16_t kp, int16_t ki) : _kp(kp), _ki(ki), _integral(0), _pwm(0) {}
+
+    uint8_t update(uint16_t target, uint16_t measured, uint8_t feedForward);
+
+    void reset() { _integral = 0; _pwm = 0; }  // call when the wheel is stopped or driven open loop
+
+    void setGains(int16_t kp, int16_t ki) { _kp = kp; _ki = ki; }
+    int16_t getKp() { return _kp; }
+    int16_t getKi() { return _ki; }
+
+    uint8_t pwm() { return _pwm; }              // the last output
+    int32_t integral() { return _integral; }    // the integral term, Q8 PWM
+
+  private:
+
+    int16_t _kp;
+    int16_t _ki;
+    int32_t _integral;
+    uint8_t _pwm;
+};
+
+#endif
@@ -472,3 +472,22 @@ void MPU9250::readBytes(uint8_t address, uint8_t subAddress, uint8_t count,
   while (Wire.available()) {
     dest[i++] = Wire.read(); }         // Put read results in the Rx buffer
 }
+
+#ifdef I2C_ASYNC
+// Same as readBytes(), queued on AsyncWire: returns at once and calls done
+// (in interrupt context) with t once dest holds the count bytes, or with
+// t->status set if the read failed. t belongs to the caller and must not be
+// reused until then; returns false if it is still in use.
+bool MPU9250::readBytesAsync(I2CTransaction * t, uint8_t address,
+                             uint8_t subAddress, uint8_t count, uint8_t * dest,
+                             void (*done)(I2CTransaction *))
+{
+  if (t->status == I2C_ASYNC_PENDING) return false;
+  t->address = address;
+  t->reg = subAddress;
+  t->length = count;
+  t->dest = dest;
+  t->done = done;
+  return AsyncWire.submit(t);
+}
+#endif
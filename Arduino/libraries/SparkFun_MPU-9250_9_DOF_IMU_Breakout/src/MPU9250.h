@@ -10,6 +10,9 @@
 
 #include <SPI.h>
 #include <Wire.h>
+#ifdef I2C_ASYNC
+#include <I2CAsync.h>
+#endif
 
 // See also MPU-9250 Register Map and Descriptions, Revision 4.0,
 // RM-MPU-9250A-00, Rev. 1.4, 9/9/2013 for registers not listed in above
@@ -249,6 +252,10 @@ class MPU9250
     void writeByte(uint8_t, uint8_t, uint8_t);
     uint8_t readByte(uint8_t, uint8_t);
     void readBytes(uint8_t, uint8_t, uint8_t, uint8_t *);
+#ifdef I2C_ASYNC
+    bool readBytesAsync(I2CTransaction *, uint8_t, uint8_t, uint8_t, uint8_t *,
+                        void (*)(I2CTransaction *) = 0);
+#endif
 };  // class MPU9250
 
 #endif // _MPU9250_H_
@@ -0,0 +1,114 @@
+#ifndef _ORIENTATIONFILTER_H_
+#define _ORIENTATIONFILTER_H_
+
+#include <Arduino.h>
+#include "quaternionFilters.h"
+#include "quaternionFiltersFixed.h"
+
+// Orientation filters as objects, each with its own quaternion and gains,
+// so several can run at once: one per IMU, or Madgwick and Mahony side by
+// side while tuning.
+//
+//   OrientationFilter<float, Madgwick> ahrs;
+//   ahrs.setBeta(0.1f);
+//   ahrs.update(samples, n);          // a FIFO burst
+//   const float *q = ahrs.getQ();
+//
+// Scalar is float for the float filters, or int16_t for the fixed-point
+// ones, whose samples are raw counts with the gyro as Q11 rad/s and whose
+// quaternion is Q30 (see quaternionFiltersFixed.h). Gains are given in
+// floating point either way and converted when set.
+
+// Algorithms
+struct Madgwick
+{
+  static void update(QuaternionFilterState &f, const QuaternionSample *s, size_t n)
+  {
+    MadgwickQuaternionUpdate(f, s, n);
+  }
+  static void update(QuaternionFilterStateFixed &f, const QuaternionSampleFixed *s, size_t n)
+  {
+    MadgwickQuaternionUpdateFixed(f, s, n);
+  }
+};
+
+struct Mahony
+{
+  static void update(QuaternionFilterState &f, const QuaternionSample *s, size_t n)
+  {
+    MahonyQuaternionUpdate(f, s, n);
+  }
+  static void update(QuaternionFilterStateFixed &f, const QuaternionSampleFixed *s, size_t n)
+  {
+    MahonyQuaternionUpdateFixed(f, s, n);
+  }
+};
+
+// The state, sample and quaternion types for each Scalar
+template <typename Scalar> struct OrientationFilterTypes;
+
+template <> struct OrientationFilterTypes<float>
+{
+  typedef QuaternionFilterState State;
+  typedef QuaternionSample Sample;
+  typedef float Component;
+
+  static void init(State &f) { QuaternionFilterInit(f); }
+  static void reset(State &f) { QuaternionFilterReset(f); }
+  static void setBeta(State &f, float beta) { f.beta = beta; }
+  static void setGains(State &f, float kp, float ki) { f.kp = kp; f.ki = ki; }
+};
+
+template <> struct OrientationFilterTypes<int16_t>
+{
+  typedef QuaternionFilterStateFixed State;
+  typedef QuaternionSampleFixed Sample;
+  typedef int32_t Component;
+
+  static void init(State &f) { QuaternionFilterInitFixed(f); }
+  static void reset(State &f) { QuaternionFilterResetFixed(f); }
+  static void setBeta(State &f, float beta) { f.beta = gain(beta, 32768.0f); }
+  static void setGains(State &f, float kp, float ki) { f.kp = gain(kp, 256.0f); f.ki = gain(ki, 32768.0f); }
+
+  // A non-negative gain in fixed point, saturating
+  static int16_t gain(float g, float one)
+  {
+    float v = g * one + 0.5f;
+    return v >= 32767.0f ? 32767 : v <= 0.0f ? 0 : (int16_t)v;
+  }
+};
+
+template <typename Scalar, typename Algorithm>
+class OrientationFilter
+{
+  public:
+
+    typedef OrientationFilterTypes<Scalar> Types;
+    typedef typename Types::Sample Sample;
+    typedef typename Types::Component Component;
+
+    // Identity orientation and the default gains
+    OrientationFilter() { Types::init(_state); }
+
+    // Back to the identity orientation, keeping the gains
+    void reset() { Types::reset(_state); }
+
+    // Madgwick gain, rad/s
+    void setBeta(float beta) { Types::setBeta(_state, beta); }
+    // Mahony proportional and integral gains
+    void setGains(float kp, float ki) { Types::setGains(_state, kp, ki); }
+
+    void update(const Sample &s) { Algorithm::update(_state, &s, 1); }
+    // n samples in order, as read from a FIFO: one call, and for float only
+    // one exact renormalisation
+    void update(const Sample *s, size_t n) { Algorithm::update(_state, s, n); }
+
+    // w, x, y, z
+    const Component *getQ() const { return _state.q; }
+
+  private:
+
+    typename Types::State _state;
+};
+
+#endif // _ORIENTATIONFILTER_H_
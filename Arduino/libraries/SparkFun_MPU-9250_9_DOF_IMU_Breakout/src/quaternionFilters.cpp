@@ -13,12 +13,11 @@
 
 // These are the free parameters in the Mahony filter and fusion scheme, Kp
 // for proportional feedback, Ki for integral
+// (the defaults; each QuaternionFilterState has its own)
 #define Kp 2.0f * 5.0f
 #define Ki 0.0f
 
 static float GyroMeasError = PI * (40.0f / 180.0f);
-// gyroscope measurement drift in rad/s/s (start at 0.0 deg/s/s)
-static float GyroMeasDrift = PI * (0.0f  / 180.0f);
 // There is a tradeoff in the beta parameter between accuracy and response
 // speed. In the original Madgwick study, beta of 0.041 (corresponding to
 // GyroMeasError of 2.7 degrees/s) was found to give optimal accuracy.
@@ -33,19 +32,57 @@ static float GyroMeasDrift = PI * (0.0f  / 180.0f);
 // In any case, this is the free parameter in the Madgwick filtering and
 // fusion scheme.
 static float beta = sqrt(3.0f / 4.0f) * GyroMeasError;   // Compute beta
-// Compute zeta, the other free parameter in the Madgwick scheme usually
-// set to a small or zero value
-static float zeta = sqrt(3.0f / 4.0f) * GyroMeasDrift;
+// zeta, the other free parameter in the Madgwick scheme, is for gyro
+// drift, which these updates don't estimate.
 
-// Vector to hold integral error for Mahony method
-static float eInt[3] = {0.0f, 0.0f, 0.0f};
-// Vector to hold quaternion
-static float q[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+// The filter the functions without a state argument share
+static QuaternionFilterState shared = {{1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, beta, Kp, Ki};
 
-void MadgwickQuaternionUpdate(float ax, float ay, float az, float gx, float gy, float gz, float mx, float my, float mz, float deltat)
+void QuaternionFilterInit(QuaternionFilterState &f)
+{
+  f.beta = beta;
+  f.kp = Kp;
+  f.ki = Ki;
+  QuaternionFilterReset(f);
+}
+
+void QuaternionFilterReset(QuaternionFilterState &f)
+{
+  f.q[0] = 1.0f;
+  f.q[1] = f.q[2] = f.q[3] = 0.0f;
+  f.eInt[0] = f.eInt[1] = f.eInt[2] = 0.0f;
+}
+
+// Normalise quaternion
+static void normalise(float *q)
 {
+  float norm = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  norm = 1.0f / norm;
+  q[0] *= norm;
+  q[1] *= norm;
+  q[2] *= norm;
+  q[3] *= norm;
+}
+
+static void normaliseFirstOrder(float *q)
+{
+  float k = 1.5f - 0.5f * (q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  q[0] *= k;
+  q[1] *= k;
+  q[2] *= k;
+  q[3] *= k;
+}
+
+// One update of f, leaving its quaternion to be normalised. Returns false,
+// with f unchanged, if a measurement is zero.
+static bool madgwickStep(QuaternionFilterState &f, const QuaternionSample &r)
+{
+  float ax = r.ax, ay = r.ay, az = r.az, gx = r.gx, gy = r.gy, gz = r.gz, mx = r.mx, my = r.my, mz = r.mz;
+  float deltat = r.deltat;
+  float beta = f.beta;
+
   // short name local variable for readability
-  float q1 = q[0], q2 = q[1], q3 = q[2], q4 = q[3];
+  float q1 = f.q[0], q2 = f.q[1], q3 = f.q[2], q4 = f.q[3];
   float norm;
   float hx, hy, _2bx, _2bz;
   float s1, s2, s3, s4;
@@ -77,7 +114,7 @@ void MadgwickQuaternionUpdate(float ax, float ay, float az, float gx, float gy,
 
   // Normalise accelerometer measurement
   norm = sqrt(ax * ax + ay * ay + az * az);
-  if (norm == 0.0f) return; // handle NaN
+  if (norm == 0.0f) return false; // handle NaN
   norm = 1.0f/norm;
   ax *= norm;
   ay *= norm;
@@ -85,7 +122,7 @@ void MadgwickQuaternionUpdate(float ax, float ay, float az, float gx, float gy,
 
   // Normalise magnetometer measurement
   norm = sqrt(mx * mx + my * my + mz * mz);
-  if (norm == 0.0f) return; // handle NaN
+  if (norm == 0.0f) return false; // handle NaN
   norm = 1.0f/norm;
   mx *= norm;
   my *= norm;
@@ -127,22 +164,25 @@ void MadgwickQuaternionUpdate(float ax, float ay, float az, float gx, float gy,
   q2 += qDot2 * deltat;
   q3 += qDot3 * deltat;
   q4 += qDot4 * deltat;
-  norm = sqrt(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);    // normalise quaternion
-  norm = 1.0f/norm;
-  q[0] = q1 * norm;
-  q[1] = q2 * norm;
-  q[2] = q3 * norm;
-  q[3] = q4 * norm;
+  f.q[0] = q1;
+  f.q[1] = q2;
+  f.q[2] = q3;
+  f.q[3] = q4;
+  return true;
 }
 
 
 
 // Similar to Madgwick scheme but uses proportional and integral filtering on
 // the error between estimated reference vectors and measured ones.
-void MahonyQuaternionUpdate(float ax, float ay, float az, float gx, float gy, float gz, float mx, float my, float mz, float deltat)
+static bool mahonyStep(QuaternionFilterState &f, const QuaternionSample &r)
 {
+  float ax = r.ax, ay = r.ay, az = r.az, gx = r.gx, gy = r.gy, gz = r.gz, mx = r.mx, my = r.my, mz = r.mz;
+  float deltat = r.deltat;
+  float *eInt = f.eInt;
+
   // short name local variable for readability
-  float q1 = q[0], q2 = q[1], q3 = q[2], q4 = q[3];
+  float q1 = f.q[0], q2 = f.q[1], q3 = f.q[2], q4 = f.q[3];
   float norm;
   float hx, hy, bx, bz;
   float vx, vy, vz, wx, wy, wz;
@@ -163,7 +203,7 @@ void MahonyQuaternionUpdate(float ax, float ay, float az, float gx, float gy, fl
 
   // Normalise accelerometer measurement
   norm = sqrt(ax * ax + ay * ay + az * az);
-  if (norm == 0.0f) return; // Handle NaN
+  if (norm == 0.0f) return false; // Handle NaN
   norm = 1.0f / norm;       // Use reciprocal for division
   ax *= norm;
   ay *= norm;
@@ -171,7 +211,7 @@ void MahonyQuaternionUpdate(float ax, float ay, float az, float gx, float gy, fl
 
   // Normalise magnetometer measurement
   norm = sqrt(mx * mx + my * my + mz * mz);
-  if (norm == 0.0f) return; // Handle NaN
+  if (norm == 0.0f) return false; // Handle NaN
   norm = 1.0f / norm;       // Use reciprocal for division
   mx *= norm;
   my *= norm;
@@ -195,7 +235,7 @@ void MahonyQuaternionUpdate(float ax, float ay, float az, float gx, float gy, fl
   ex = (ay * vz - az * vy) + (my * wz - mz * wy);
   ey = (az * vx - ax * vz) + (mz * wx - mx * wz);
   ez = (ax * vy - ay * vx) + (mx * wy - my * wx);
-  if (Ki > 0.0f)
+  if (f.ki > 0.0f)
   {
     eInt[0] += ex;      // accumulate integral error
     eInt[1] += ey;
@@ -209,9 +249,9 @@ void MahonyQuaternionUpdate(float ax, float ay, float az, float gx, float gy, fl
   }
 
   // Apply feedback terms
-  gx = gx + Kp * ex + Ki * eInt[0];
-  gy = gy + Kp * ey + Ki * eInt[1];
-  gz = gz + Kp * ez + Ki * eInt[2];
+  gx = gx + f.kp * ex + f.ki * eInt[0];
+  gy = gy + f.kp * ey + f.ki * eInt[1];
+  gz = gz + f.kp * ez + f.ki * eInt[2];
  
   // Integrate rate of change of quaternion
   pa = q2;
@@ -222,13 +262,50 @@ void MahonyQuaternionUpdate(float ax, float ay, float az, float gx, float gy, fl
   q3 = pb + (q1 * gy - pa * gz + pc * gx) * (0.5f * deltat);
   q4 = pc + (q1 * gz + pa * gy - pb * gx) * (0.5f * deltat);
 
-  // Normalise quaternion
-  norm = sqrt(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);
-  norm = 1.0f / norm;
-  q[0] = q1 * norm;
-  q[1] = q2 * norm;
-  q[2] = q3 * norm;
-  q[3] = q4 * norm;
+  f.q[0] = q1;
+  f.q[1] = q2;
+  f.q[2] = q3;
+  f.q[3] = q4;
+  return true;
+}
+
+// Within a burst q is renormalised after every sample, since |q| drifting
+// would bias the next update, but only to first order, q * (3 - |q|^2) / 2,
+// which is enough for the small drift of one sample. Exactly after the last.
+void MadgwickQuaternionUpdate(QuaternionFilterState &f, const QuaternionSample *s, size_t n)
+{
+  bool moved = false;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (!madgwickStep(f, s[i])) continue;
+    moved = true;
+    if (i + 1 < n) normaliseFirstOrder(f.q);
+  }
+  if (moved) normalise(f.q);
+}
+
+void MahonyQuaternionUpdate(QuaternionFilterState &f, const QuaternionSample *s, size_t n)
+{
+  bool moved = false;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (!mahonyStep(f, s[i])) continue;
+    moved = true;
+    if (i + 1 < n) normaliseFirstOrder(f.q);
+  }
+  if (moved) normalise(f.q);
+}
+
+void MadgwickQuaternionUpdate(float ax, float ay, float az, float gx, float gy, float gz, float mx, float my, float mz, float deltat)
+{
+  QuaternionSample s = {ax, ay, az, gx, gy, gz, mx, my, mz, deltat};
+  MadgwickQuaternionUpdate(shared, &s, 1);
+}
+
+void MahonyQuaternionUpdate(float ax, float ay, float az, float gx, float gy, float gz, float mx, float my, float mz, float deltat)
+{
+  QuaternionSample s = {ax, ay, az, gx, gy, gz, mx, my, mz, deltat};
+  MahonyQuaternionUpdate(shared, &s, 1);
 }
 
-const float * getQ () { return q; }
+const float * getQ () { return shared.q; }
@@ -3,6 +3,29 @@
 
 #include <Arduino.h>
 
+// One filter's orientation and gains. The functions without a state
+// argument share a single one; give each filter its own to run several
+// (see OrientationFilter.h).
+struct QuaternionFilterState
+{
+  float q[4];           // orientation quaternion
+  float eInt[3];        // Mahony integral error
+  float beta;           // Madgwick gain, rad/s
+  float kp, ki;         // Mahony proportional and integral gains
+};
+
+// One reading: a and m in any units, g in rad/s, deltat in seconds
+struct QuaternionSample
+{
+  float ax, ay, az, gx, gy, gz, mx, my, mz;
+  float deltat;
+};
+
+// Identity orientation, zero integral error, default gains
+void QuaternionFilterInit(QuaternionFilterState &f);
+// Identity orientation and zero integral error, gains kept
+void QuaternionFilterReset(QuaternionFilterState &f);
+
 void MadgwickQuaternionUpdate(float ax, float ay, float az, float gx, float gy,
                               float gz, float mx, float my, float mz,
                               float deltat);
@@ -11,4 +34,12 @@ void MahonyQuaternionUpdate(float ax, float ay, float az, float gx, float gy,
                             float deltat);
 const float * getQ();
 
+// Updates f with n readings in order, such as a FIFO burst. Between them
+// the quaternion is only renormalised to first order, which saves the
+// square root and divide; after the last it is exact.
+void MadgwickQuaternionUpdate(QuaternionFilterState &f,
+                              const QuaternionSample *s, size_t n);
+void MahonyQuaternionUpdate(QuaternionFilterState &f,
+                            const QuaternionSample *s, size_t n);
+
 #endif // _QUATERNIONFILTERS_H_
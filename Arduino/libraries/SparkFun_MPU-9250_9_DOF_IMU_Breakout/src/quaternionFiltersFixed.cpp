@@ -0,0 +1,377 @@
+// Fixed-point port of the Madgwick and Mahony updates in quaternionFilters.cpp.
+// The equations, gains and order of operations are the same as the float
+// versions; only the number formats differ:
+//
+//   Q13 (int16, +-4)    normalised measurements, quaternion products,
+//                       reference directions and errors
+//   Q24 (int32)         gradient sums, before the step is normalised
+//   Q26 (int32)         quaternion rate
+//   Q30 (int32)         the quaternion itself, so slow rotations still move it
+//
+// Every multiply is 16x16 -> 32 bits. The three normalisations and the
+// field magnitude use invSqrtQ14(), a 13-entry table with linear
+// interpolation and one Newton step, good to about 2e-5. Vectors of 32-bit
+// values are shifted into 16 bits (a shared exponent) before they are
+// normalised.
+//
+// On the AVR int is 16 bits, so every product that needs 32 bits is
+// widened before the multiply, never after.
+
+#include "quaternionFiltersFixed.h"
+
+// Same default free parameters as quaternionFilters.cpp: Kp = 10 (Q8),
+// Ki = 0, and beta = sqrt(3/4) * 40 deg/s in rad/s = 0.6046 (Q15)
+#define KP_Q8       2560
+#define KI_Q15      0
+#define BETA_Q15    19812
+
+// Bound on the Mahony integral error, so it can't overflow
+#define EINT_LIMIT  (1L << 28)
+
+// 1/sqrt(u) for u = 4/16 .. 16/16, as Q14
+static const uint16_t INV_SQRT_Q14[13] PROGMEM = {
+  32768, 29309, 26755, 24770, 23170, 21845, 20724, 19760, 18919, 18176, 17515, 16921, 16384
+};
+
+// The filter the functions without a state argument share
+static QuaternionFilterStateFixed shared = {{QF_Q_ONE, 0, 0, 0}, {0, 0, 0}, BETA_Q15, KP_Q8, KI_Q15};
+
+void QuaternionFilterInitFixed(QuaternionFilterStateFixed &f)
+{
+  f.beta = BETA_Q15;
+  f.kp = KP_Q8;
+  f.ki = KI_Q15;
+  QuaternionFilterResetFixed(f);
+}
+
+void QuaternionFilterResetFixed(QuaternionFilterStateFixed &f)
+{
+  f.q[0] = QF_Q_ONE;
+  f.q[1] = f.q[2] = f.q[3] = 0;
+  f.eInt[0] = f.eInt[1] = f.eInt[2] = 0;
+}
+
+static inline int32_t mul(int16_t a, int16_t b)
+{
+  return (int32_t)a * b;
+}
+
+static inline int16_t mulQ13(int16_t a, int16_t b)
+{
+  return (int16_t)(((int32_t)a * b) >> 13);
+}
+
+// Q13 x Q13 as Q24, leaving headroom to sum six terms of up to 12
+static inline int32_t mulQ24(int16_t a, int16_t b)
+{
+  return ((int32_t)a * b) >> 2;
+}
+
+// (a * b) >> 16 from two 16x16 products
+static inline int32_t mul32x16(int32_t a, uint16_t b)
+{
+  int16_t hi = (int16_t)(a >> 16);
+  uint16_t lo = (uint16_t)a;
+  return (int32_t)hi * b + (int32_t)(((uint32_t)lo * b) >> 16);
+}
+
+// (a * b) >> 15 from two 16x16 products
+static inline int32_t mul16x32(int16_t a, int32_t b)
+{
+  int16_t hi = (int16_t)(b >> 16);
+  uint16_t lo = (uint16_t)b;
+  return ((int32_t)a * hi << 1) + (((int32_t)a * lo) >> 15);
+}
+
+// 1/sqrt(x) for x > 0, returned as y in Q14 with 1/sqrt(x) = y * 2^(e/2 - 29).
+// x is first shifted by an even e into [2^28, 2^30), and u is its top
+// 16 bits, u / 2^16 in [1/4, 1).
+static uint16_t invSqrtQ14(uint32_t x, int8_t &e, uint16_t &u)
+{
+  e = 0;
+  while (x >= (1UL << 30)) { x >>= 2; e -= 2; }
+  while (x < (1UL << 28)) { x <<= 2; e += 2; }
+  u = (uint16_t)(x >> 14);
+
+  uint8_t i = (uint8_t)(u >> 12) - 4;
+  uint16_t frac = u & 0x0FFF;
+  uint16_t y0 = pgm_read_word(&INV_SQRT_Q14[i]);
+  uint16_t y1 = pgm_read_word(&INV_SQRT_Q14[i + 1]);
+  uint16_t y = y0 - (uint16_t)(((uint32_t)(y0 - y1) * frac) >> 12);
+
+  // Newton: y = y * (3 - u * y^2) / 2
+  uint16_t ySq = (uint16_t)(((uint32_t)y * y) >> 15);           // Q13
+  uint32_t t = (3UL << 29) - (uint32_t)u * ySq;                   // Q29
+  return (uint16_t)(((uint32_t)y * (uint16_t)(t >> 15)) >> 15);
+}
+
+// Scales v[0..n) to unit length as Q13 (q = 13) or Q14 (q = 14) in out.
+// The squares of v must sum to less than 2^32. Returns false if v is zero.
+static bool unitVector(const int16_t *v, uint8_t n, int16_t *out, uint8_t q)
+{
+  uint32_t s = 0;
+  for (uint8_t i = 0; i < n; i++) s += (uint32_t)mul(v[i], v[i]);
+  if (s == 0) return false;
+  int8_t e;
+  uint16_t u;
+  uint16_t y = invSqrtQ14(s, e, u);
+  uint8_t shift = 29 - q - e / 2;
+  for (uint8_t i = 0; i < n; i++) out[i] = (int16_t)(((int32_t)v[i] * y) >> shift);
+  return true;
+}
+
+// sqrt(a^2 + b^2) of two Q13 values, as Q13
+static int16_t magnitudeQ13(int16_t a, int16_t b)
+{
+  uint32_t s = (uint32_t)mul(a, a) + (uint32_t)mul(b, b);
+  if (s == 0) return 0;
+  int8_t e;
+  uint16_t u;
+  uint16_t y = invSqrtQ14(s, e, u);
+  // sqrt(s) = sqrt(u) * 2^(15 - e/2), and sqrt(u) = u * y
+  uint16_t r = (uint16_t)(((uint32_t)u * y) >> 16);              // Q14
+  int8_t shift = e / 2 - 1;
+  return (int16_t)(shift >= 0 ? r >> shift : r << -shift);
+}
+
+static inline int16_t toQ13(int32_t q)
+{
+  return (int16_t)((q + (1L << 16)) >> 17);
+}
+
+static inline int16_t toQ15(int32_t q)
+{
+  int32_t r = (q + (1L << 14)) >> 15;
+  if (r > 32767) return 32767;
+  if (r < -32767) return -32767;
+  return (int16_t)r;
+}
+
+// Integrates q' = q * (0, w) / 2 - beta * step over deltatUs, with w the Q11
+// rate and step a Q14 unit vector (or null), leaving q to be normalised.
+static void integrate(QuaternionFilterStateFixed &f, const int16_t *w, const int16_t *step, uint16_t deltatUs)
+{
+  int32_t *qf = f.q;
+  int16_t q1 = toQ15(qf[0]), q2 = toQ15(qf[1]), q3 = toQ15(qf[2]), q4 = toQ15(qf[3]);
+  int32_t qDot[4];
+
+  // Rate of change of quaternion, Q15 x Q11 = Q26
+  qDot[0] = (-mul(q2, w[0]) - mul(q3, w[1]) - mul(q4, w[2])) >> 1;
+  qDot[1] = (mul(q1, w[0]) + mul(q3, w[2]) - mul(q4, w[1])) >> 1;
+  qDot[2] = (mul(q1, w[1]) - mul(q2, w[2]) + mul(q4, w[0])) >> 1;
+  qDot[3] = (mul(q1, w[2]) + mul(q2, w[1]) - mul(q3, w[0])) >> 1;
+  if (step)
+  {
+    for (uint8_t i = 0; i < 4; i++) qDot[i] -= mul(f.beta, step[i]) >> 3;
+  }
+
+  // deltat as Q20 seconds: us * 1.048576
+  if (deltatUs > 62499U) deltatUs = 62499U;
+  uint16_t dt = deltatUs + (uint16_t)(((uint32_t)deltatUs * 3184) >> 16);
+  for (uint8_t i = 0; i < 4; i++) qf[i] += mul32x16(qDot[i], dt);   // Q26 x Q20 >> 16 = Q30
+}
+
+// Normalise quaternion: q stays close to unit length, so one first-order
+// step q * (1 + (1 - |q|^2) / 2) is enough. Q14 here, not Q15, so a
+// component just over 1 doesn't saturate and hide the excess.
+static void normalise(int32_t *qf)
+{
+  int16_t qs[4];
+  uint32_t n2 = 0;
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    qs[i] = (int16_t)((qf[i] + (1L << 15)) >> 16);
+    n2 += (uint32_t)mul(qs[i], qs[i]);                          // Q28
+  }
+  int32_t e = (int32_t)((1L << 28) - n2);
+  for (uint8_t i = 0; i < 4; i++) qf[i] += mul16x32(qs[i], e) << 2;   // Q14 x Q28 >> 15 = Q27, halved to Q30
+}
+
+// One update of f, leaving its quaternion to be normalised. Returns false,
+// with f unchanged, if a measurement is zero.
+static bool madgwickStep(QuaternionFilterStateFixed &f, const QuaternionSampleFixed &r)
+{
+  int16_t a[3] = {r.ax, r.ay, r.az}, m[3] = {r.mx, r.my, r.mz};
+  const int32_t *qf = f.q;
+
+  // Normalise accelerometer and magnetometer measurements
+  if (!unitVector(a, 3, a, 13)) return false;
+  if (!unitVector(m, 3, m, 13)) return false;
+  int16_t ax = a[0], ay = a[1], az = a[2];
+  int16_t mx = m[0], my = m[1], mz = m[2];
+
+  // short name local variable for readability
+  int16_t q1 = toQ13(qf[0]), q2 = toQ13(qf[1]), q3 = toQ13(qf[2]), q4 = toQ13(qf[3]);
+
+  // Auxiliary variables to avoid repeated arithmetic
+  int16_t _2q1 = q1 << 1;
+  int16_t _2q2 = q2 << 1;
+  int16_t _2q3 = q3 << 1;
+  int16_t _2q4 = q4 << 1;
+  int16_t q1q1 = mulQ13(q1, q1);
+  int16_t q1q2 = mulQ13(q1, q2);
+  int16_t q1q3 = mulQ13(q1, q3);
+  int16_t q1q4 = mulQ13(q1, q4);
+  int16_t q2q2 = mulQ13(q2, q2);
+  int16_t q2q3 = mulQ13(q2, q3);
+  int16_t q2q4 = mulQ13(q2, q4);
+  int16_t q3q3 = mulQ13(q3, q3);
+  int16_t q3q4 = mulQ13(q3, q4);
+  int16_t q4q4 = mulQ13(q4, q4);
+
+  // Reference direction of Earth's magnetic field
+  int16_t _2q1mx = mulQ13(_2q1, mx);
+  int16_t _2q1my = mulQ13(_2q1, my);
+  int16_t _2q1mz = mulQ13(_2q1, mz);
+  int16_t _2q2mx = mulQ13(_2q2, mx);
+  int16_t hx = (mul(mx, q1q1) - mul(_2q1my, q4) + mul(_2q1mz, q3) + mul(mx, q2q2) + mul(mulQ13(_2q2, my), q3) +
+                mul(mulQ13(_2q2, mz), q4) - mul(mx, q3q3) - mul(mx, q4q4)) >> 13;
+  int16_t hy = (mul(_2q1mx, q4) + mul(my, q1q1) - mul(_2q1mz, q2) + mul(_2q2mx, q3) - mul(my, q2q2) + mul(my, q3q3) +
+                mul(mulQ13(_2q3, mz), q4) - mul(my, q4q4)) >> 13;
+  int16_t _2bx = magnitudeQ13(hx, hy);
+  int16_t _2bz = (-mul(_2q1mx, q3) + mul(_2q1my, q2) + mul(mz, q1q1) + mul(_2q2mx, q4) - mul(mz, q2q2) +
+                  mul(mulQ13(_2q3, my), q4) - mul(mz, q3q3) + mul(mz, q4q4)) >> 13;
+  int16_t _4bx = _2bx << 1;
+  int16_t _4bz = _2bz << 1;
+
+  // Objective function: estimated minus measured gravity and field
+  int16_t f1 = ((q2q4 - q1q3) << 1) - ax;
+  int16_t f2 = ((q1q2 + q3q4) << 1) - ay;
+  int16_t f3 = 8192 - (q2q2 << 1) - (q3q3 << 1) - az;
+  int16_t f4 = ((mul(_2bx, 4096 - q3q3 - q4q4) + mul(_2bz, q2q4 - q1q3)) >> 13) - mx;
+  int16_t f5 = ((mul(_2bx, q2q3 - q1q4) + mul(_2bz, q1q2 + q3q4)) >> 13) - my;
+  int16_t f6 = ((mul(_2bx, q1q3 + q2q4) + mul(_2bz, 4096 - q2q2 - q3q3)) >> 13) - mz;
+
+  // Gradient decent algorithm corrective step, Q24
+  int32_t s[4];
+  s[0] = -mulQ24(_2q3, f1) + mulQ24(_2q2, f2) - mulQ24(mulQ13(_2bz, q3), f4) +
+         mulQ24(mulQ13(_2bz, q2) - mulQ13(_2bx, q4), f5) + mulQ24(mulQ13(_2bx, q3), f6);
+  s[1] = mulQ24(_2q4, f1) + mulQ24(_2q1, f2) - (mulQ24(_2q2, f3) << 1) + mulQ24(mulQ13(_2bz, q4), f4) +
+         mulQ24(mulQ13(_2bx, q3) + mulQ13(_2bz, q1), f5) + mulQ24(mulQ13(_2bx, q4) - mulQ13(_4bz, q2), f6);
+  s[2] = -mulQ24(_2q1, f1) + mulQ24(_2q4, f2) - (mulQ24(_2q3, f3) << 1) +
+         mulQ24(-mulQ13(_4bx, q3) - mulQ13(_2bz, q1), f4) + mulQ24(mulQ13(_2bx, q2) + mulQ13(_2bz, q4), f5) +
+         mulQ24(mulQ13(_2bx, q1) - mulQ13(_4bz, q3), f6);
+  s[3] = mulQ24(_2q2, f1) + mulQ24(_2q3, f2) + mulQ24(mulQ13(_2bz, q2) - mulQ13(_4bx, q4), f4) +
+         mulQ24(mulQ13(_2bz, q3) - mulQ13(_2bx, q1), f5) + mulQ24(mulQ13(_2bx, q2), f6);
+
+  // Normalise step magnitude: shift into 15 bits, then to a Q14 unit vector
+  int32_t big = 0;
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    int32_t v = s[i] < 0 ? -s[i] : s[i];
+    if (v > big) big = v;
+  }
+  uint8_t shift = 0;
+  while ((big >> shift) > 16383) shift++;
+  int16_t step[4];
+  for (uint8_t i = 0; i < 4; i++) step[i] = (int16_t)(s[i] >> shift);
+  bool moved = unitVector(step, 4, step, 14);
+
+  int16_t w[3] = {r.gx, r.gy, r.gz};
+  integrate(f, w, moved ? step : 0, r.deltatUs);
+  return true;
+}
+
+// Similar to Madgwick scheme but uses proportional and integral feedback on
+// the error between estimated reference vectors and measured ones.
+static bool mahonyStep(QuaternionFilterStateFixed &f, const QuaternionSampleFixed &r)
+{
+  int16_t a[3] = {r.ax, r.ay, r.az}, m[3] = {r.mx, r.my, r.mz};
+  const int32_t *qf = f.q;
+
+  // Normalise accelerometer and magnetometer measurements
+  if (!unitVector(a, 3, a, 13)) return false;
+  if (!unitVector(m, 3, m, 13)) return false;
+  int16_t ax = a[0], ay = a[1], az = a[2];
+  int16_t mx = m[0], my = m[1], mz = m[2];
+
+  int16_t q1 = toQ13(qf[0]), q2 = toQ13(qf[1]), q3 = toQ13(qf[2]), q4 = toQ13(qf[3]);
+
+  // Auxiliary variables to avoid repeated arithmetic
+  int16_t q1q1 = mulQ13(q1, q1);
+  int16_t q1q2 = mulQ13(q1, q2);
+  int16_t q1q3 = mulQ13(q1, q3);
+  int16_t q1q4 = mulQ13(q1, q4);
+  int16_t q2q2 = mulQ13(q2, q2);
+  int16_t q2q3 = mulQ13(q2, q3);
+  int16_t q2q4 = mulQ13(q2, q4);
+  int16_t q3q3 = mulQ13(q3, q3);
+  int16_t q3q4 = mulQ13(q3, q4);
+  int16_t q4q4 = mulQ13(q4, q4);
+
+  // Reference direction of Earth's magnetic field (the 2x folded into the shift)
+  int16_t hx = (mul(mx, 4096 - q3q3 - q4q4) + mul(my, q2q3 - q1q4) + mul(mz, q2q4 + q1q3)) >> 12;
+  int16_t hy = (mul(mx, q2q3 + q1q4) + mul(my, 4096 - q2q2 - q4q4) + mul(mz, q3q4 - q1q2)) >> 12;
+  int16_t bx = magnitudeQ13(hx, hy);
+  int16_t bz = (mul(mx, q2q4 - q1q3) + mul(my, q3q4 + q1q2) + mul(mz, 4096 - q2q2 - q3q3)) >> 12;
+
+  // Estimated direction of gravity and magnetic field
+  int16_t vx = (q2q4 - q1q3) << 1;
+  int16_t vy = (q1q2 + q3q4) << 1;
+  int16_t vz = q1q1 - q2q2 - q3q3 + q4q4;
+  int16_t wx = (mul(bx, 4096 - q3q3 - q4q4) + mul(bz, q2q4 - q1q3)) >> 12;
+  int16_t wy = (mul(bx, q2q3 - q1q4) + mul(bz, q1q2 + q3q4)) >> 12;
+  int16_t wz = (mul(bx, q1q3 + q2q4) + mul(bz, 4096 - q2q2 - q3q3)) >> 12;
+
+  // Error is cross product between estimated direction and measured direction of gravity
+  int16_t ex = (mul(ay, vz) - mul(az, vy) + mul(my, wz) - mul(mz, wy)) >> 13;
+  int16_t ey = (mul(az, vx) - mul(ax, vz) + mul(mz, wx) - mul(mx, wz)) >> 13;
+  int16_t ez = (mul(ax, vy) - mul(ay, vx) + mul(mx, wy) - mul(my, wx)) >> 13;
+
+  // Apply feedback terms, Q13 error x Q8 gain to Q11 rate, saturating
+  int16_t e[3] = {ex, ey, ez};
+  int16_t g[3] = {r.gx, r.gy, r.gz};
+  int16_t w[3];
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    int32_t fb = (int32_t)g[i] + (mul(e[i], f.kp) >> 10);
+    if (f.ki > 0)
+    {
+      // accumulate integral error, Q13 x Q15 gain >> 15 = Q13, to Q11
+      f.eInt[i] += e[i];
+      if (f.eInt[i] > EINT_LIMIT) f.eInt[i] = EINT_LIMIT;
+      if (f.eInt[i] < -EINT_LIMIT) f.eInt[i] = -EINT_LIMIT;
+      fb += mul16x32(f.ki, f.eInt[i]) >> 2;
+    }
+    else
+    {
+      f.eInt[i] = 0;     // prevent integral wind up
+    }
+    w[i] = fb > 32767 ? (int16_t)32767 : fb < -32767 ? (int16_t)-32767 : (int16_t)fb;
+  }
+
+  integrate(f, w, 0, r.deltatUs);
+  return true;
+}
+
+// normalise() is first order already, and cheap, so a burst is just the
+// samples one at a time without the calls
+void MadgwickQuaternionUpdateFixed(QuaternionFilterStateFixed &f, const QuaternionSampleFixed *s, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    if (madgwickStep(f, s[i])) normalise(f.q);
+  }
+}
+
+void MahonyQuaternionUpdateFixed(QuaternionFilterStateFixed &f, const QuaternionSampleFixed *s, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    if (mahonyStep(f, s[i])) normalise(f.q);
+  }
+}
+
+void MadgwickQuaternionUpdateFixed(int16_t ax, int16_t ay, int16_t az, int16_t gx, int16_t gy, int16_t gz, int16_t mx, int16_t my, int16_t mz, uint16_t deltatUs)
+{
+  QuaternionSampleFixed s = {ax, ay, az, gx, gy, gz, mx, my, mz, deltatUs};
+  MadgwickQuaternionUpdateFixed(shared, &s, 1);
+}
+
+void MahonyQuaternionUpdateFixed(int16_t ax, int16_t ay, int16_t az, int16_t gx, int16_t gy, int16_t gz, int16_t mx, int16_t my, int16_t mz, uint16_t deltatUs)
+{
+  QuaternionSampleFixed s = {ax, ay, az, gx, gy, gz, mx, my, mz, deltatUs};
+  MahonyQuaternionUpdateFixed(shared, &s, 1);
+}
+
+const int32_t * getQFixed () { return shared.q; }
@@ -0,0 +1,58 @@
+#ifndef _QUATERNIONFILTERSFIXED_H_
+#define _QUATERNIONFILTERSFIXED_H_
+
+#include <Arduino.h>
+
+// Fixed-point versions of the filters in quaternionFilters.h, for 8-bit
+// targets without an FPU. The arithmetic is 16x16 -> 32 bit multiplies,
+// which the AVR does in hardware, and one table-driven inverse square
+// root; there is no float, and no 32x32 multiply.
+//
+// Inputs:
+//   ax..az, mx..mz  raw sensor counts in any scale; only their direction is used
+//   gx..gz          rate in rad/s as Q11 (QF_GYRO_ONE = 1 rad/s, saturating at
+//                   +-16 rad/s, about 917 deg/s)
+//   deltatUs        time since the last update in microseconds, at most 62499
+//
+// The quaternion is kept as Q30; getQFixed() returns it.
+
+#define QF_GYRO_ONE  2048L       // Q11: 1 rad/s
+#define QF_Q_ONE     (1L << 30)  // Q30: 1.0
+
+// One filter's orientation and gains, like QuaternionFilterState
+struct QuaternionFilterStateFixed
+{
+  int32_t q[4];         // orientation quaternion, Q30
+  int32_t eInt[3];      // Mahony integral error, Q13
+  int16_t beta;         // Madgwick gain, rad/s as Q15
+  int16_t kp;           // Mahony proportional gain, Q8
+  int16_t ki;           // Mahony integral gain, Q15
+};
+
+// One reading, in the units above
+struct QuaternionSampleFixed
+{
+  int16_t ax, ay, az, gx, gy, gz, mx, my, mz;
+  uint16_t deltatUs;
+};
+
+// Identity orientation, zero integral error, the float filters' default gains
+void QuaternionFilterInitFixed(QuaternionFilterStateFixed &f);
+// Identity orientation and zero integral error, gains kept
+void QuaternionFilterResetFixed(QuaternionFilterStateFixed &f);
+
+void MadgwickQuaternionUpdateFixed(int16_t ax, int16_t ay, int16_t az, int16_t gx,
+                                   int16_t gy, int16_t gz, int16_t mx, int16_t my,
+                                   int16_t mz, uint16_t deltatUs);
+void MahonyQuaternionUpdateFixed(int16_t ax, int16_t ay, int16_t az, int16_t gx,
+                                 int16_t gy, int16_t gz, int16_t mx, int16_t my,
+                                 int16_t mz, uint16_t deltatUs);
+const int32_t * getQFixed();
+
+// Updates f with n readings in order, such as a FIFO burst
+void MadgwickQuaternionUpdateFixed(QuaternionFilterStateFixed &f,
+                                   const QuaternionSampleFixed *s, size_t n);
+void MahonyQuaternionUpdateFixed(QuaternionFilterStateFixed &f,
+                                 const QuaternionSampleFixed *s, size_t n);
+
+#endif // _QUATERNIONFILTERSFIXED_H_